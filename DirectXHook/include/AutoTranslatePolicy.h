@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+struct AutoTranslateOptions
+{
+	// Time between two sampled frames
+	int sampleIntervalMs = 250;
+	// A frame is only sent once it stopped changing for this long, text that is still being typed out waits
+	int stabilityMs = 300;
+	// Least time between two requests
+	int debounceMs = 500;
+	// Requests queued or being sent at most
+	int maxInFlight = 1;
+	// Sustained request rate, bursts of up to one second worth of requests are allowed
+	float maxRequestsPerSecond = 2.0f;
+};
+
+enum class AutoTranslateDecision
+{
+	// The frame shows what was sent last, nothing to do
+	Idle,
+	// The frame differs from what was sent last, but it is still changing or the budget is used up
+	Wait,
+	Submit
+};
+
+// Decides when continuous translation samples a frame and which sampled frames are sent.
+// Time is passed in by the caller, so the policy can be replayed against recorded frame sequences.
+class AutoTranslatePolicy
+{
+public:
+	struct Stats
+	{
+		uint64_t samples = 0;
+		uint64_t submissions = 0;
+		// Frames that would have been sent but waited for the debounce, the in-flight limit or the rate budget
+		uint64_t throttled = 0;
+	};
+
+	explicit AutoTranslatePolicy(const AutoTranslateOptions& options = AutoTranslateOptions()) : options(options)
+	{
+	}
+
+	// True when the next frame should be captured, at most once per sample interval
+	bool ShouldSample(uint64_t nowMs)
+	{
+		if (sampled && nowMs - lastSampleMs < uint64_t(options.sampleIntervalMs))
+		{
+			return false;
+		}
+
+		sampled = true;
+		lastSampleMs = nowMs;
+
+		return true;
+	}
+
+	// Called for every sampled frame. changed: it differs from the previous sample, pending: it differs from
+	// the frame sent last. inFlight: requests still queued or being sent.
+	AutoTranslateDecision Evaluate(uint64_t nowMs, bool changed, bool pending, int inFlight)
+	{
+		stats.samples++;
+		Refill(nowMs);
+
+		if (changed || !seen)
+		{
+			lastChangeMs = nowMs;
+			seen = true;
+		}
+
+		if (!pending)
+		{
+			return AutoTranslateDecision::Idle;
+		}
+
+		if (nowMs - lastChangeMs < uint64_t(options.stabilityMs))
+		{
+			return AutoTranslateDecision::Wait;
+		}
+
+		bool debounced = submitted && nowMs - lastSubmitMs < uint64_t(options.debounceMs);
+
+		if (debounced || inFlight >= options.maxInFlight || tokens < 1.0f)
+		{
+			stats.throttled++;
+			return AutoTranslateDecision::Wait;
+		}
+
+		tokens -= 1.0f;
+		submitted = true;
+		lastSubmitMs = nowMs;
+		stats.submissions++;
+
+		return AutoTranslateDecision::Submit;
+	}
+
+	const Stats& GetStats() const
+	{
+		return stats;
+	}
+
+private:
+	AutoTranslateOptions options;
+	Stats stats;
+	bool sampled = false;
+	bool seen = false;
+	bool submitted = false;
+	uint64_t lastSampleMs = 0;
+	uint64_t lastChangeMs = 0;
+	uint64_t lastSubmitMs = 0;
+	uint64_t lastRefillMs = 0;
+	float tokens = 1.0f;
+
+	// Token bucket of the request rate
+	void Refill(uint64_t nowMs)
+	{
+		float capacity = std::max(1.0f, options.maxRequestsPerSecond);
+
+		tokens = std::min(capacity, tokens + (nowMs - lastRefillMs) * options.maxRequestsPerSecond / 1000.0f);
+		lastRefillMs = nowMs;
+	}
+};
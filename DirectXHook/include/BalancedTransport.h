@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Windows.h>
+#include <memory>
+#include <vector>
+
+#include "Config.h"
+#include "HedgedTransport.h"
+#include "Logger.h"
+#include "SharedMemoryTransport.h"
+#include "WinHttpTransport.h"
+
+// Sends every request to one of the configured servers, see HedgedTransport. Ejected servers are checked
+// on a thread of their own and come back once they answer. Owned by a single worker like WinHttpTransport,
+// only Cancel may be called from other threads.
+class BalancedTransport : public HedgedTransport
+{
+public:
+	BalancedTransport() : HedgedTransport(CreateTransports(), CreateTransports(), ServerBalancing, Hedging)
+	{
+	}
+
+	// Starts the health checks and hedging, called by the worker thread rather than on construction
+	void Start()
+	{
+		if (started)
+		{
+			return;
+		}
+
+		started = true;
+
+		// Also with a single server, which would otherwise never come back once it was ejected
+		CreateThread(0, 0, &BalancedTransport::HealthCheckMain, this, 0, NULL);
+
+		if (HedgeRequests)
+		{
+			StartHedging();
+		}
+	}
+
+protected:
+	void OnRetry(int endpoint) override
+	{
+		logger.Log("Request to %ls:%u failed, trying the next server", Servers[endpoint].address, UINT(Servers[endpoint].port));
+	}
+
+	void OnHedge(int primary, int endpoint) override
+	{
+		logger.Log("No answer from %ls:%u yet, hedging with %ls:%u",
+			Servers[primary].address, UINT(Servers[primary].port), Servers[endpoint].address, UINT(Servers[endpoint].port));
+	}
+
+	void OnEjected(int endpoint) override
+	{
+		logger.Log("Taking %ls:%u out of rotation", Servers[endpoint].address, UINT(Servers[endpoint].port));
+	}
+
+private:
+	// How often the health check thread looks for ejected servers to check
+	static constexpr int HealthCheckPollMs = 250;
+
+	Logger logger{ "BalancedTransport" };
+	bool started = false;
+
+	static std::vector<std::unique_ptr<ITransport>> CreateTransports()
+	{
+		std::vector<std::unique_ptr<ITransport>> transports;
+
+		for (const ServerEndpoint& endpoint : Servers)
+		{
+			transports.push_back(CreateTransport(endpoint));
+		}
+
+		return transports;
+	}
+
+	static std::unique_ptr<ITransport> CreateTransport(const ServerEndpoint& endpoint)
+	{
+		std::unique_ptr<ITransport> transport = std::make_unique<WinHttpTransport>(endpoint);
+
+		if (!endpoint.sharedMemory)
+		{
+			return transport;
+		}
+
+		return std::make_unique<SharedMemoryTransport>(std::move(transport), SharedMemorySlots, SharedMemorySlotBytes, SharedMemoryMinBytes);
+	}
+
+	static DWORD WINAPI HealthCheckMain(LPVOID pTransport)
+	{
+		((BalancedTransport*)pTransport)->CheckHealth();
+
+		return 0;
+	}
+
+	// Asks every ejected server for its capabilities once its time out ended, on connections of its own
+	// with a short time limit, so a dead server does not hold up the check of the others for long
+	void CheckHealth()
+	{
+		std::vector<std::unique_ptr<WinHttpTransport>> probes;
+
+		for (const ServerEndpoint& endpoint : Servers)
+		{
+			probes.push_back(std::make_unique<WinHttpTransport>(endpoint, HealthCheckTimeoutMs));
+		}
+
+		ResponseSink ignore = [](const char* data, size_t size)
+		{
+			return true;
+		};
+
+		while (true)
+		{
+			Sleep(HealthCheckPollMs);
+
+			for (int endpoint : balancer.GetHealthChecksDue(GetTimeMs()))
+			{
+				bool healthy = probes[endpoint]->Send(L"GET", L"/capabilities", L"", nullptr, 0, ignore);
+
+				probes[endpoint]->Close();
+				balancer.ReportHealthCheck(endpoint, GetTimeMs(), healthy);
+
+				if (healthy)
+				{
+					logger.Log("%ls:%u is back in rotation", Servers[endpoint].address, UINT(Servers[endpoint].port));
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// Why a frame was captured. Requests of one kind supersede older requests of the same kind only,
+// a subtitle settling never cancels a scan that was asked for.
+enum class CaptureKind
+{
+	// Requested with the translate button
+	Manual,
+	// Sampled by continuous translation, only sent when the policy agrees
+	Automatic,
+	// The subtitle band, captured every frame and sent once its text settled
+	Subtitle,
+	// A full frame sampled while the subtitle band is being looked for, never sent
+	BandDetection
+};
+
+static constexpr int CaptureKindCount = 4;
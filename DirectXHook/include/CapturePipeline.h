@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Windows.h>
+#include <d3d11.h>
+#include <DirectXTex.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "CaptureKind.h"
+#include "TranslateClient.h"
+#include "TranslateWorker.h"
+#include "FrameDiff.h"
+#include "Preprocess.h"
+#include "ImageEncoder.h"
+#include "AutoTranslatePolicy.h"
+#include "SubtitleBand.h"
+#include "TextDetector.h"
+
+// A back buffer, or a region of it, read back from the GPU. Rows are rowPitch bytes apart.
+struct CapturedFrame
+{
+	uint64_t frame = 0;
+	// Position of the pixels on screen, only a region capture does not start at the origin
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	size_t rowPitch = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+	std::vector<uint8_t> pixels;
+	CaptureKind kind = CaptureKind::Manual;
+};
+
+// Turns captured frames into translation requests on its own thread:
+// change detection, cropping, preprocessing and encoding never run inside Present.
+class CapturePipeline
+{
+public:
+	// Starts the pipeline thread and the worker that sends its requests
+	void Start();
+	// Takes the frame for processing. A frame still waiting in the queue is replaced, the latest one wins.
+	void Submit(CapturedFrame&& frame);
+	// Returns a buffer of at least the given size, reusing the ones of processed frames
+	std::vector<uint8_t> AcquireBuffer(size_t size);
+	// True when continuous translation should capture the current frame
+	bool IsSampleDue();
+	// The subtitle band in a screen of the given size, false while the detector has not found it yet
+	bool GetSubtitleBand(int width, int height, ImageRect* band);
+
+private:
+	Logger logger{ "CapturePipeline" };
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::vector<CapturedFrame> queue;
+	std::vector<std::vector<uint8_t>> bufferPool;
+	bool started = false;
+
+	FrameDiff::Signature lastSignature;
+	// Signature of the previous automatic sample, tells whether the frame is still changing
+	FrameDiff::Signature lastSampleSignature;
+	AutoTranslatePolicy autoPolicy{ AutoTranslate };
+	TextDetector textDetector{ TextDetection };
+	SubtitleBandDetector bandDetector;
+	SubtitleTracker subtitleTracker{ SubtitleStableFrames };
+	// Screen space band the last subtitle request covered, its entries are replaced by the next one
+	ImageRect subtitleRegion;
+	// Published by the pipeline thread once the detector found the band, guarded by the mutex
+	ImageRect detectedBand;
+	TranslateWorker translateWorker;
+
+	static DWORD WINAPI ThreadMain(LPVOID pPipeline);
+	void Run();
+	void Process(CapturedFrame& frame);
+	void ProcessSubtitle(const DirectX::Image* image, const CapturedFrame& frame);
+	void DetectSubtitleBand(const DirectX::Image* image);
+	void RecycleBuffer(std::vector<uint8_t>&& buffer);
+	bool CreateRequest(const DirectX::Image* image, bool automatic, TranslateClient::Request* request, bool* unchanged);
+	void AddTextCrops(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, std::vector<TranslateClient::Crop>* crops);
+	void AddCrop(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, std::vector<TranslateClient::Crop>* crops);
+	bool EncodeCrops(const DirectX::Image* image, int originX, int originY, CaptureFormat format, std::vector<TranslateClient::Crop>& crops, TranslateClient::Request* request);
+	bool ShouldSubmitSample(const FrameDiff::Signature& signature);
+	static uint64_t GetTimeMs();
+	bool LookUpTiles(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, ImageRect* send, std::vector<Tile>* missed);
+	bool EncodeCrop(const DirectX::Image& image, CaptureFormat format, DirectX::Blob* blob, float* scale);
+	bool EncodeWIC(const DirectX::Image& image, CaptureFormat format, DirectX::Blob* blob);
+	bool CopyToBlob(const std::vector<uint8_t>& data, DirectX::Blob* blob);
+	bool GetImageView(const DirectX::Image* image, ImageView* view);
+	bool ConvertImage(const DirectX::Image** image, DirectX::ScratchImage* converted, ImageView* view);
+};
@@ -2,16 +2,142 @@
 
 #include <winuser.h>
 
+#include "ImageEncoder.h"
+#include "ReadbackRing.h"
+#include "TextShadow.h"
+#include "TextLayout.h"
+#include "AutoTranslatePolicy.h"
+#include "SubtitleBand.h"
+#include "TextDetector.h"
+#include "LoadBalancer.h"
+#include "LatencyHistogram.h"
+
 static const char TranslateButton = 'G';
 static const char TranslateButtonMod = 0x07;
 
 static const char HelperButton = 'H';
 static const char HelperButtonMod = 0x07;
 
+// Toggles continuous translation: frames are sampled in the background and sent once their text changed and settled
+static const char AutoTranslateButton = 'J';
+static const char AutoTranslateButtonMod = 0x07;
+static const bool AutoTranslateOnStart = false;
+// Sample interval, stability window and debounce in milliseconds, requests in flight, requests per second
+static const AutoTranslateOptions AutoTranslate = { 250, 300, 500, 1, 2.0f };
+
+// Toggles subtitle mode: only the band where the game shows its dialogue is captured, every frame,
+// and sent once its text stayed the same for SubtitleStableFrames frames
+static const char SubtitleButton = 'K';
+static const char SubtitleButtonMod = 0x07;
+static const bool SubtitleModeOnStart = false;
+// Auto samples full frames until the band is found, see SubtitleBandDetector
+static const SubtitleBandMode SubtitleBandSource = SubtitleBandMode::Auto;
+// Top and bottom of the band as fractions of the screen height, used by SubtitleBandMode::Fixed
+static const float SubtitleBandTop = 0.75f;
+static const float SubtitleBandBottom = 0.95f;
+static const int SubtitleStableFrames = 4;
+
 static const float SubtitleShadowRadius = 5.0f;
+// Number of shadow copies drawn around each label, see TextShadow.h
+static const ShadowQuality SubtitleShadowQuality = ShadowQuality::Medium;
+
+// Translations are wrapped and scaled uniformly into the box of the recognized text, see TextLayout.h.
+// The line height stays between the two limits, text that still does not fit spills as the third value says.
+// Layouts are built by the translate worker when a response is published, balanced line breaking costs the
+// render thread nothing.
+static const TextFitOptions SubtitleTextFit = {
+	TextFitMode::Wrap,
+	LineBreaking::Balanced,
+	TextSpill::Overflow,
+	12.0f,
+	48.0f
+};
+
+// A scan is skipped when no more than FrameDiffMaxChangedBlocks blocks of the frame signature
+// moved by more than FrameDiffTolerance luma levels since the last submitted frame
+static const int FrameDiffBlockSize = 16;
+static const int FrameDiffTolerance = 4;
+static const int FrameDiffMaxChangedBlocks = 0;
+
+// When only part of the frame changed, just the changed regions are sent for recognition
+static const bool SendChangedRegionsOnly = true;
+// Changed regions are split into lines of text, lines recognized before are taken from the cache and not sent again
+static const bool UseTileCache = true;
+// Number of lines the tile cache holds before the least recently used are evicted
+static const size_t TileCacheMaxTiles = 4096;
+
+// Only the lines of text found in a capture are sent, not the whole capture, see TextDetector.h
+static const bool UseTextDetector = true;
+// Edge threshold, edge pixels per cell, gap cells, min and max text height, min fill, threads (0: every core)
+static const TextDetectorOptions TextDetection = { 40, 4, 3, 8, 160, 0.35f, 0 };
+// The crops of a scan are packed into one atlas image and sent in a single request, see CropAtlas.h
+static const bool UseCropAtlas = true;
+// Pixels left between two crops in the atlas, so the recognized lines do not run into each other
+static const int CropAtlasSpacing = 8;
+// Without the atlas, lines are joined into one crop while it is at most this many times larger than the lines themselves
+static const float TextCropMaxWaste = 1.5f;
+
+// Upload format of the captures, falls back to PNG when the server does not list it as supported
+static const CaptureFormat PreferredCaptureFormat = CaptureFormat::Qoi;
+// 0.0 - 1.0, only used for CaptureFormat::Jpeg
+static const float JpegQuality = 0.9f;
+// Unfiltered PNGs are larger but encode several times faster
+static const bool PngFastFilter = true;
+
+// Captures are converted to grayscale before upload
+static const bool PreprocessCaptures = true;
+// Typical text height of the game in pixels at native resolution, 0 when unknown.
+// Captures are area-downscaled so the text stays at least PreprocessTargetTextHeight pixels high.
+static const int GameTextHeight = 0;
+static const int PreprocessTargetTextHeight = 24;
+static const bool PreprocessNormalizeContrast = false;
+
+// Captures are copied into one of ReadbackRingSize staging textures and read ReadbackLatency frames later,
+// so the render thread never waits for the GPU. When all slots are busy the oldest pending capture is dropped.
+static const int ReadbackRingSize = 3;
+static const int ReadbackLatency = 2;
+static const ReadbackDropPolicy ReadbackDrop = ReadbackDropPolicy::DropOldest;
+
+// A new request cancels the request of the same kind still being sent, its response would be outdated anyway.
+// Responses older than the shown translations of their kind are always discarded.
+static const bool CancelSupersededRequests = true;
+// Asks the server for results in the binary format of ResultCodec.h, which is cheaper to decode than JSON
+static const bool PreferBinaryResults = true;
+// Translations are drawn as soon as their part of the response arrived instead of after the whole response
+static const bool ShowPartialResults = true;
+// Translations are remembered on the client. When the server supports it, it only recognizes the text
+// and just the strings missing from the cache are sent for translation.
+static const bool UseTranslationCache = true;
+// Memory the cache may use before the least recently used translations are evicted
+static const size_t TranslationCacheBytes = 8 * 1024 * 1024;
+// Translations are also stored on disk and loaded again in the next session
+static const bool PersistTranslations = true;
+static const wchar_t* TranslationStorePath = L".\\translations.cache";
 
 static const wchar_t* UserAgent = L"InGameTranslator/1.0";
-static const wchar_t* ServerAddress = L"localhost";
-static const INTERNET_PORT ServerPort = 8888;
+// Requests are spread over the servers, see LoadBalancer.h. A server that fails or is much slower than the others
+// is taken out of rotation until a health check finds it working again.
+// A server running natively on this machine can get the frames in shared memory instead of over the connection,
+// { L"localhost", 8888, true }. That does not reach into WSL2, which runs in a virtual machine.
+static const ServerEndpoint Servers[] = {
+	{ L"localhost", 8888 },
+};
+// Policy, latency average weight, failures before ejection, ejection time and its limit in milliseconds,
+// slowness factor, least latency in milliseconds that counts as slow, answered requests before that,
+// half-life in milliseconds of the latency average of an idle server
+static const LoadBalancerOptions ServerBalancing = { LoadBalancing::PeakEwma, 0.3f, 2, 5000, 60000, 3.0f, 500, 3, 10000 };
+// Time limit of a health check of an ejected server
+static const int HealthCheckTimeoutMs = 2000;
+// Frames in shared memory take turns in SharedMemorySlots slots, larger ones and requests smaller than
+// SharedMemoryMinBytes are sent over the connection
+static const int SharedMemorySlots = 2;
+static const size_t SharedMemorySlotBytes = 40 * 1024 * 1024;
+static const size_t SharedMemoryMinBytes = 64 * 1024;
+// A request still unanswered when most requests of its kind were answered is sent a second time to another
+// healthy server, and the first answer is taken. Needs more than one server. See LatencyHistogram.h.
+static const bool HedgeRequests = true;
+// Latency percentile after which a request is hedged, latencies measured before hedging starts,
+// least delay in milliseconds, hedges as a fraction of all requests
+static const HedgeOptions Hedging = { 95.0f, 20, 50, 0.1f };
 
 static const wchar_t* FontPath = L".\\font.spritefont";
\ No newline at end of file
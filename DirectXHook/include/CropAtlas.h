@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "ImageView.h"
+
+// A crop of the frame and where it went in the atlas
+struct AtlasPiece
+{
+	// Screen space rect of the crop
+	ImageRect screen;
+	// Top left corner in the atlas
+	int x = 0;
+	int y = 0;
+};
+
+// Several crops packed into one image, so they cost a single round trip and no pixels between them are sent.
+// Keeps the table that maps positions in the atlas back to the screen.
+struct AtlasLayout
+{
+	int width = 0;
+	int height = 0;
+	std::vector<AtlasPiece> pieces;
+
+	// Fraction of the atlas covered by crops
+	float GetFill() const
+	{
+		uint64_t covered = 0;
+
+		for (const AtlasPiece& piece : pieces)
+		{
+			covered += uint64_t(piece.screen.Area());
+		}
+
+		return width * height > 0 ? float(covered) / (float(width) * height) : 0.0f;
+	}
+
+	// The piece a box in atlas space belongs to: the one holding its center, or the one closest to it.
+	// Null for an empty layout.
+	const AtlasPiece* FindPiece(float x, float y, float w, float h) const
+	{
+		float centerX = x + w / 2;
+		float centerY = y + h / 2;
+		const AtlasPiece* closest = nullptr;
+		float closestDistance = 0.0f;
+
+		for (const AtlasPiece& piece : pieces)
+		{
+			float dx = std::max({ piece.x - centerX, 0.0f, centerX - (piece.x + piece.screen.width) });
+			float dy = std::max({ piece.y - centerY, 0.0f, centerY - (piece.y + piece.screen.height) });
+			float distance = dx * dx + dy * dy;
+
+			if (closest == nullptr || distance < closestDistance)
+			{
+				closest = &piece;
+				closestDistance = distance;
+			}
+		}
+
+		return closest;
+	}
+
+	// Moves a box from atlas into screen space, clipped to its piece so it does not reach into a neighbour
+	bool ToScreen(float* x, float* y, float* w, float* h) const
+	{
+		const AtlasPiece* piece = FindPiece(*x, *y, *w, *h);
+
+		if (piece == nullptr)
+		{
+			return false;
+		}
+
+		float left = std::max(*x, float(piece->x));
+		float top = std::max(*y, float(piece->y));
+		float right = std::min(*x + *w, float(piece->x + piece->screen.width));
+		float bottom = std::min(*y + *h, float(piece->y + piece->screen.height));
+
+		*x = piece->screen.x + (left - piece->x);
+		*y = piece->screen.y + (top - piece->y);
+		*w = std::max(0.0f, right - left);
+		*h = std::max(0.0f, bottom - top);
+
+		return true;
+	}
+};
+
+// Skyline bottom-left packing: crops go tallest first to the lowest spot along the top edge of the crops
+// placed so far, leftmost on ties. A few atlas widths are tried and the smallest atlas is kept.
+namespace AtlasPacker
+{
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	// Lowest y a crop of the given width can be placed at when its left edge is at the start of segment first.
+	// -1 when it does not fit into the width.
+	static int FitSkyline(const std::vector<Segment>& skyline, size_t first, int width, int atlasWidth)
+	{
+		int x = skyline[first].x;
+
+		if (x + width > atlasWidth)
+		{
+			return -1;
+		}
+
+		int y = 0;
+		int remaining = width;
+
+		for (size_t i = first; remaining > 0 && i < skyline.size(); i++)
+		{
+			y = std::max(y, skyline[i].y);
+			remaining -= skyline[i].width;
+		}
+
+		return y;
+	}
+
+	static void PlaceSkyline(std::vector<Segment>& skyline, size_t first, int width, int top)
+	{
+		int x = skyline[first].x;
+		int right = x + width;
+		size_t last = first;
+
+		// Segments covered completely are replaced, one covered partly is shortened from the left
+		while (last < skyline.size() && skyline[last].x + skyline[last].width <= right)
+		{
+			last++;
+		}
+
+		if (last < skyline.size() && skyline[last].x < right)
+		{
+			skyline[last].width -= right - skyline[last].x;
+			skyline[last].x = right;
+		}
+
+		skyline.erase(skyline.begin() + first, skyline.begin() + last);
+		skyline.insert(skyline.begin() + first, { x, top, width });
+
+		// Neighbours at the same height become one segment
+		for (size_t i = 0; i + 1 < skyline.size();)
+		{
+			if (skyline[i].y == skyline[i + 1].y)
+			{
+				skyline[i].width += skyline[i + 1].width;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	// Packs the order given into an atlas of the given width, spacing pixels are left between crops
+	static AtlasLayout PackWidth(const std::vector<ImageRect>& crops, const std::vector<size_t>& order, int atlasWidth, int spacing)
+	{
+		AtlasLayout layout;
+		layout.pieces.resize(crops.size());
+		int right = 0;
+
+		std::vector<Segment> skyline = { { 0, 0, atlasWidth } };
+
+		for (size_t index : order)
+		{
+			const ImageRect& crop = crops[index];
+			int width = std::min(atlasWidth, crop.width + spacing);
+			size_t best = 0;
+			int bestY = -1;
+
+			for (size_t i = 0; i < skyline.size(); i++)
+			{
+				int y = FitSkyline(skyline, i, width, atlasWidth);
+
+				if (y >= 0 && (bestY < 0 || y < bestY))
+				{
+					best = i;
+					bestY = y;
+				}
+			}
+
+			AtlasPiece& piece = layout.pieces[index];
+			piece.screen = crop;
+			piece.x = skyline[best].x;
+			piece.y = bestY;
+
+			PlaceSkyline(skyline, best, width, bestY + crop.height + spacing);
+			layout.height = std::max(layout.height, bestY + crop.height);
+			right = std::max(right, piece.x + crop.width);
+		}
+
+		// Narrower than tried when no row filled the width
+		layout.width = right;
+
+		return layout;
+	}
+
+	static AtlasLayout Pack(const std::vector<ImageRect>& crops, int spacing)
+	{
+		if (crops.empty())
+		{
+			return AtlasLayout();
+		}
+
+		std::vector<size_t> order(crops.size());
+		int widest = 0;
+		double area = 0.0;
+
+		for (size_t i = 0; i < crops.size(); i++)
+		{
+			order[i] = i;
+			widest = std::max(widest, crops[i].width);
+			area += double(crops[i].width + spacing) * (crops[i].height + spacing);
+		}
+
+		std::sort(order.begin(), order.end(), [&crops](size_t a, size_t b)
+		{
+			return crops[a].height != crops[b].height ? crops[a].height > crops[b].height : crops[a].width > crops[b].width;
+		});
+
+		int square = int(std::ceil(std::sqrt(area)));
+		AtlasLayout best;
+
+		for (int width : { widest, square, square * 3 / 2, square * 2 })
+		{
+			width = std::max(width, widest);
+
+			AtlasLayout layout = PackWidth(crops, order, width, spacing);
+
+			if (best.pieces.empty() || int64_t(layout.width) * layout.height < int64_t(best.width) * best.height)
+			{
+				best = std::move(layout);
+			}
+		}
+
+		return best;
+	}
+}
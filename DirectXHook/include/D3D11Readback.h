@@ -0,0 +1,248 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <algorithm>
+#include <vector>
+
+#include "ImageView.h"
+#include "ReadbackRing.h"
+#include "CapturePipeline.h"
+#include "Logger.h"
+
+// Readback slots backed by D3D11 staging textures, an event query per slot tells when the copy landed
+class D3D11ReadbackDevice : public IReadbackDevice
+{
+public:
+	void Init(ID3D11Device* device, ID3D11DeviceContext* context, CapturePipeline* pipeline, int slotCount)
+	{
+		this->device = device;
+		this->context = context;
+		this->pipeline = pipeline;
+		slots = std::vector<Slot>(slotCount);
+	}
+
+	// The texture the next QueueCopy reads from, set right before requesting a capture.
+	// Only the region is copied when it is not empty, subtitle band captures stay small enough for every frame.
+	void SetSource(Microsoft::WRL::ComPtr<ID3D11Texture2D> source, CaptureKind kind = CaptureKind::Manual, const ImageRect& region = ImageRect())
+	{
+		this->source = source;
+		this->sourceKind = kind;
+		this->sourceRegion = region;
+	}
+
+	// Drops every texture, they are recreated with the new back buffer description on the next copy
+	void Release()
+	{
+		for (Slot& slot : slots)
+		{
+			slot.staging.Reset();
+			slot.query.Reset();
+		}
+
+		resolveTexture.Reset();
+		source.Reset();
+	}
+
+	bool QueueCopy(int slotIndex) override
+	{
+		if (source.Get() == nullptr || slotIndex < 0 || slotIndex >= int(slots.size()))
+		{
+			return false;
+		}
+
+		Slot& slot = slots[slotIndex];
+
+		D3D11_TEXTURE2D_DESC desc;
+		source->GetDesc(&desc);
+
+		D3D11_BOX box = { 0, 0, 0, desc.Width, desc.Height, 1 };
+
+		if (sourceRegion.Area() > 0)
+		{
+			box.left = UINT(std::max(0, sourceRegion.x));
+			box.top = UINT(std::max(0, sourceRegion.y));
+			box.right = std::min(desc.Width, UINT(std::max(0, sourceRegion.Right())));
+			box.bottom = std::min(desc.Height, UINT(std::max(0, sourceRegion.Bottom())));
+
+			if (box.right <= box.left || box.bottom <= box.top)
+			{
+				return false;
+			}
+		}
+
+		D3D11_TEXTURE2D_DESC stagingDesc = desc;
+		stagingDesc.Width = box.right - box.left;
+		stagingDesc.Height = box.bottom - box.top;
+
+		if (!EnsureSlotResources(slot, stagingDesc))
+		{
+			return false;
+		}
+
+		ID3D11Resource* copySource = source.Get();
+
+		// Multisampled back buffers cannot be copied into staging textures directly
+		if (desc.SampleDesc.Count > 1)
+		{
+			if (!EnsureResolveTexture(desc))
+			{
+				return false;
+			}
+
+			context->ResolveSubresource(resolveTexture.Get(), 0, source.Get(), 0, desc.Format);
+			copySource = resolveTexture.Get();
+		}
+
+		if (stagingDesc.Width == desc.Width && stagingDesc.Height == desc.Height)
+		{
+			context->CopyResource(slot.staging.Get(), copySource);
+		}
+		else
+		{
+			context->CopySubresourceRegion(slot.staging.Get(), 0, 0, 0, 0, copySource, 0, &box);
+		}
+
+		context->End(slot.query.Get());
+		slot.kind = sourceKind;
+		slot.x = int(box.left);
+		slot.y = int(box.top);
+
+		source.Reset();
+
+		return true;
+	}
+
+	bool IsCopyFinished(int slotIndex) override
+	{
+		Slot& slot = slots[slotIndex];
+
+		return context->GetData(slot.query.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+	}
+
+	bool ReadSlot(int slotIndex, uint64_t frame) override
+	{
+		Slot& slot = slots[slotIndex];
+		D3D11_MAPPED_SUBRESOURCE mapped;
+
+		if (FAILED(context->Map(slot.staging.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		{
+			logger.Log("Failed to map readback slot %i", slotIndex);
+			return false;
+		}
+
+		CapturedFrame captured;
+		captured.frame = frame;
+		captured.kind = slot.kind;
+		captured.x = slot.x;
+		captured.y = slot.y;
+		captured.width = slot.desc.Width;
+		captured.height = slot.desc.Height;
+		captured.format = slot.desc.Format;
+		captured.rowPitch = mapped.RowPitch;
+		captured.pixels = pipeline->AcquireBuffer(size_t(mapped.RowPitch) * slot.desc.Height);
+
+		memcpy(captured.pixels.data(), mapped.pData, captured.pixels.size());
+
+		context->Unmap(slot.staging.Get(), 0);
+
+		pipeline->Submit(std::move(captured));
+
+		return true;
+	}
+
+private:
+	struct Slot
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> staging = nullptr;
+		Microsoft::WRL::ComPtr<ID3D11Query> query = nullptr;
+		D3D11_TEXTURE2D_DESC desc = {};
+		CaptureKind kind = CaptureKind::Manual;
+		// Position of the copied region on screen
+		int x = 0;
+		int y = 0;
+	};
+
+	Logger logger{ "D3D11Readback" };
+	ID3D11Device* device = nullptr;
+	ID3D11DeviceContext* context = nullptr;
+	CapturePipeline* pipeline = nullptr;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> source = nullptr;
+	CaptureKind sourceKind = CaptureKind::Manual;
+	ImageRect sourceRegion;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> resolveTexture = nullptr;
+	std::vector<Slot> slots;
+
+	bool EnsureSlotResources(Slot& slot, const D3D11_TEXTURE2D_DESC& sourceDesc)
+	{
+		bool matches = slot.staging.Get() != nullptr &&
+			slot.desc.Width == sourceDesc.Width &&
+			slot.desc.Height == sourceDesc.Height &&
+			slot.desc.Format == sourceDesc.Format;
+
+		if (!matches)
+		{
+			D3D11_TEXTURE2D_DESC desc = sourceDesc;
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Usage = D3D11_USAGE_STAGING;
+			desc.BindFlags = 0;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			desc.MiscFlags = 0;
+
+			slot.staging.Reset();
+
+			if (FAILED(device->CreateTexture2D(&desc, nullptr, slot.staging.GetAddressOf())))
+			{
+				logger.Log("Failed to create staging texture");
+				return false;
+			}
+
+			slot.desc = desc;
+		}
+
+		if (slot.query.Get() == nullptr)
+		{
+			D3D11_QUERY_DESC queryDesc = {};
+			queryDesc.Query = D3D11_QUERY_EVENT;
+
+			if (FAILED(device->CreateQuery(&queryDesc, slot.query.GetAddressOf())))
+			{
+				logger.Log("Failed to create readback query");
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool EnsureResolveTexture(const D3D11_TEXTURE2D_DESC& sourceDesc)
+	{
+		if (resolveTexture.Get() != nullptr)
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			resolveTexture->GetDesc(&desc);
+
+			if (desc.Width == sourceDesc.Width && desc.Height == sourceDesc.Height && desc.Format == sourceDesc.Format)
+			{
+				return true;
+			}
+
+			resolveTexture.Reset();
+		}
+
+		D3D11_TEXTURE2D_DESC desc = sourceDesc;
+		desc.MipLevels = 1;
+		desc.ArraySize = 1;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = 0;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+
+		return SUCCEEDED(device->CreateTexture2D(&desc, nullptr, resolveTexture.GetAddressOf()));
+	}
+};
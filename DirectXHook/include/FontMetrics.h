@@ -0,0 +1,343 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "TextLayout.h"
+
+// Glyph metrics of a .spritefont file (the format written by MakeSpriteFont), read without a D3D device.
+// Measuring follows DirectX::SpriteFont::MeasureString so layouts computed here match what is drawn.
+// SpriteFont converts UTF-8 to UTF-16 and looks up every code unit on its own, so a character outside the
+// BMP is drawn as its two surrogates, usually two default glyphs. It is measured the same way here.
+class FontMetrics
+{
+public:
+	struct Glyph
+	{
+		uint32_t character = 0;
+		int32_t left = 0;
+		int32_t top = 0;
+		int32_t right = 0;
+		int32_t bottom = 0;
+		float xOffset = 0.0f;
+		float yOffset = 0.0f;
+		float xAdvance = 0.0f;
+	};
+
+	bool Load(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		if (!file)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		return Load(data.data(), data.size());
+	}
+
+	// Reads the header, glyph table, line spacing and default character, the texture that follows is skipped
+	bool Load(const uint8_t* data, size_t size)
+	{
+		static const char magic[] = "DXTKfont";
+		const size_t magicSize = sizeof(magic) - 1;
+		const size_t glyphSize = 32;
+
+		glyphs.clear();
+		ranges.clear();
+		loaded = false;
+
+		if (size < magicSize + 4 || memcmp(data, magic, magicSize) != 0)
+		{
+			return false;
+		}
+
+		size_t offset = magicSize;
+		uint32_t glyphCount = ReadU32(data + offset);
+		offset += 4;
+
+		if (uint64_t(glyphCount) * glyphSize + 8 > size - offset)
+		{
+			return false;
+		}
+
+		glyphs.resize(glyphCount);
+
+		for (Glyph& glyph : glyphs)
+		{
+			glyph.character = ReadU32(data + offset);
+			glyph.left = int32_t(ReadU32(data + offset + 4));
+			glyph.top = int32_t(ReadU32(data + offset + 8));
+			glyph.right = int32_t(ReadU32(data + offset + 12));
+			glyph.bottom = int32_t(ReadU32(data + offset + 16));
+			glyph.xOffset = ReadF32(data + offset + 20);
+			glyph.yOffset = ReadF32(data + offset + 24);
+			glyph.xAdvance = ReadF32(data + offset + 28);
+			offset += glyphSize;
+		}
+
+		lineSpacing = ReadF32(data + offset);
+		defaultCharacter = ReadU32(data + offset + 4);
+
+		// MakeSpriteFont writes the glyphs sorted, SpriteFont relies on it as well
+		std::stable_sort(glyphs.begin(), glyphs.end(),
+			[](const Glyph& a, const Glyph& b) { return a.character < b.character; });
+
+		BuildLookup();
+		// 0 means the font has no default character
+		defaultGlyph = defaultCharacter != 0 ? FindGlyph(defaultCharacter, false) : nullptr;
+		loaded = true;
+
+		return true;
+	}
+
+	bool IsLoaded() const
+	{
+		return loaded;
+	}
+
+	float GetLineSpacing() const
+	{
+		return lineSpacing;
+	}
+
+	uint32_t GetDefaultCharacter() const
+	{
+		return defaultCharacter;
+	}
+
+	size_t GetGlyphCount() const
+	{
+		return glyphs.size();
+	}
+
+	// The glyph of the character, the default glyph when the font lacks it. nullptr when there is neither,
+	// where SpriteFont would throw.
+	const Glyph* FindGlyph(uint32_t character) const
+	{
+		return FindGlyph(character, true);
+	}
+
+	// Extent of UTF-8 text at scale 1, the same result as SpriteFont::MeasureString.
+	// Zero when a character cannot be drawn, where SpriteFont throws.
+	TextSize MeasureString(const char* text) const
+	{
+		TextSize size;
+
+		bool drawable = ForEachGlyph(text, [&](const Glyph* glyph, float x, float y)
+		{
+			float w = float(glyph->right - glyph->left);
+			float h = float(glyph->bottom - glyph->top) + glyph->yOffset;
+
+			h = IsSpace(glyph->character) ? lineSpacing : std::max(h, lineSpacing);
+
+			size.width = std::max(size.width, x + w);
+			size.height = std::max(size.height, y + h);
+		});
+
+		return drawable ? size : TextSize();
+	}
+
+	// Calls action(glyph, x, y) with the pen position of every visible glyph, returns false when a
+	// character has no glyph and the font no default character
+	template <typename Action>
+	bool ForEachGlyph(const char* text, Action action) const
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+
+		while (*text)
+		{
+			uint32_t character = DecodeUtf8(&text);
+
+			if (character == '\r')
+			{
+				continue;
+			}
+
+			if (character == '\n')
+			{
+				x = 0.0f;
+				y += lineSpacing;
+				continue;
+			}
+
+			// The UTF-16 code units SpriteFont looks up
+			uint32_t units[2] = { character, 0 };
+			int unitCount = 1;
+
+			if (character > 0xffff)
+			{
+				units[0] = 0xd800 + ((character - 0x10000) >> 10);
+				units[1] = 0xdc00 + ((character - 0x10000) & 0x3ff);
+				unitCount = 2;
+			}
+
+			for (int i = 0; i < unitCount; i++)
+			{
+				const Glyph* glyph = FindGlyph(units[i]);
+
+				if (glyph == nullptr)
+				{
+					return false;
+				}
+
+				x = std::max(0.0f, x + glyph->xOffset);
+
+				float width = float(glyph->right - glyph->left);
+				float advance = width + glyph->xAdvance;
+
+				if (!IsSpace(units[i]) || width > 1 || glyph->bottom - glyph->top > 1)
+				{
+					action(glyph, x, y);
+				}
+
+				x += advance;
+			}
+		}
+
+		return true;
+	}
+
+	// Next code point of UTF-8 text, malformed sequences decode to U+FFFD one byte at a time.
+	// Values past U+10FFFF have no UTF-16 form and decode to U+FFFD as a whole.
+	static uint32_t DecodeUtf8(const char** text)
+	{
+		const uint8_t* bytes = (const uint8_t*)*text;
+		uint32_t value = bytes[0];
+		int length = 1;
+
+		if (value >= 0xf8) { length = 0; }
+		else if (value >= 0xf0) { value &= 0x07; length = 4; }
+		else if (value >= 0xe0) { value &= 0x0f; length = 3; }
+		else if (value >= 0xc0) { value &= 0x1f; length = 2; }
+		else if (value >= 0x80) { length = 0; }
+
+		for (int i = 1; i < length; i++)
+		{
+			if ((bytes[i] & 0xc0) != 0x80)
+			{
+				length = 0;
+				break;
+			}
+
+			value = value << 6 | (bytes[i] & 0x3f);
+		}
+
+		if (length == 0)
+		{
+			*text += 1;
+			return 0xfffd;
+		}
+
+		*text += length;
+		return value <= 0x10ffff ? value : 0xfffd;
+	}
+
+private:
+	// A run of consecutive characters, their glyphs are consecutive as well
+	struct Range
+	{
+		uint32_t first;
+		uint32_t last;
+		uint32_t glyph;
+	};
+
+	static constexpr uint32_t DirectCount = 128;
+	static constexpr int32_t NoGlyph = -1;
+
+	std::vector<Glyph> glyphs;
+	// ASCII is looked up directly, everything else by binary search over the ranges
+	int32_t direct[DirectCount] = {};
+	std::vector<Range> ranges;
+	const Glyph* defaultGlyph = nullptr;
+	float lineSpacing = 0.0f;
+	uint32_t defaultCharacter = 0;
+	bool loaded = false;
+
+	static uint32_t ReadU32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+	}
+
+	static float ReadF32(const uint8_t* data)
+	{
+		uint32_t bits = ReadU32(data);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Whitespace as iswspace sees it for the characters fonts usually contain
+	static bool IsSpace(uint32_t character)
+	{
+		return character == ' ' || (character >= '\t' && character <= '\r') || character == 0x85 || character == 0xa0 ||
+			character == 0x1680 || (character >= 0x2000 && character <= 0x200a) || character == 0x2028 ||
+			character == 0x2029 || character == 0x202f || character == 0x205f || character == 0x3000;
+	}
+
+	void BuildLookup()
+	{
+		std::fill(std::begin(direct), std::end(direct), NoGlyph);
+
+		for (uint32_t i = 0; i < glyphs.size(); i++)
+		{
+			uint32_t character = glyphs[i].character;
+
+			if (character < DirectCount)
+			{
+				if (direct[character] == NoGlyph)
+				{
+					direct[character] = int32_t(i);
+				}
+
+				continue;
+			}
+
+			if (!ranges.empty() && ranges.back().last == character)
+			{
+				continue;
+			}
+
+			if (!ranges.empty() && ranges.back().last + 1 == character &&
+				ranges.back().glyph + (character - ranges.back().first) == i)
+			{
+				ranges.back().last = character;
+			}
+			else
+			{
+				ranges.push_back({ character, character, i });
+			}
+		}
+	}
+
+	const Glyph* FindGlyph(uint32_t character, bool useDefault) const
+	{
+		if (character < DirectCount)
+		{
+			if (direct[character] != NoGlyph)
+			{
+				return &glyphs[direct[character]];
+			}
+		}
+		else
+		{
+			auto range = std::upper_bound(ranges.begin(), ranges.end(), character,
+				[](uint32_t value, const Range& range) { return value < range.first; });
+
+			if (range != ranges.begin() && character <= (--range)->last)
+			{
+				return &glyphs[range->glyph + (character - range->first)];
+			}
+		}
+
+		return useDefault ? defaultGlyph : nullptr;
+	}
+};
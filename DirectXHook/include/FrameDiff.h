@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "ImageView.h"
+
+// Cheap frame fingerprints used to decide whether a capture is worth sending to the server
+namespace FrameDiff
+{
+	static constexpr int DefaultBlockSize = 16;
+	static constexpr int DefaultSampleStep = 2;
+
+	// Downsampled luminance signature of a frame.
+	// Every block stores its mean luma and its mean horizontal luma gradient,
+	// the latter reacts to text changing even when the average brightness does not.
+	struct Signature
+	{
+		int width = 0;
+		int height = 0;
+		int blockSize = 0;
+		int columns = 0;
+		int rows = 0;
+		std::vector<uint8_t> luma;
+		std::vector<uint8_t> detail;
+
+		bool IsValid() const
+		{
+			return columns > 0 && rows > 0;
+		}
+
+		bool IsCompatible(const Signature& other) const
+		{
+			return width == other.width && height == other.height && blockSize == other.blockSize;
+		}
+	};
+
+	// Integer BT.601 luma, weights sum to 256
+	static inline int Luma(const uint8_t* pixel, bool bgra)
+	{
+		int r = bgra ? pixel[2] : pixel[0];
+		int g = pixel[1];
+		int b = bgra ? pixel[0] : pixel[2];
+
+		return (77 * r + 150 * g + 29 * b) >> 8;
+	}
+
+	static Signature ComputeSignature(const ImageView& image, int blockSize = DefaultBlockSize, int sampleStep = DefaultSampleStep)
+	{
+		Signature signature;
+
+		if (image.pixels == nullptr || image.width <= 0 || image.height <= 0 || blockSize <= 0)
+		{
+			return signature;
+		}
+
+		if (sampleStep < 1 || sampleStep > blockSize)
+		{
+			sampleStep = 1;
+		}
+
+		signature.width = image.width;
+		signature.height = image.height;
+		signature.blockSize = blockSize;
+		signature.columns = (image.width + blockSize - 1) / blockSize;
+		signature.rows = (image.height + blockSize - 1) / blockSize;
+		signature.luma.resize(size_t(signature.columns) * signature.rows);
+		signature.detail.resize(signature.luma.size());
+
+		std::vector<uint32_t> lumaSums(signature.columns);
+		std::vector<uint32_t> detailSums(signature.columns);
+		std::vector<uint32_t> counts(signature.columns);
+
+		for (int blockRow = 0; blockRow < signature.rows; blockRow++)
+		{
+			std::fill(lumaSums.begin(), lumaSums.end(), 0);
+			std::fill(detailSums.begin(), detailSums.end(), 0);
+			std::fill(counts.begin(), counts.end(), 0);
+
+			int yEnd = std::min(image.height, (blockRow + 1) * blockSize);
+
+			for (int y = blockRow * blockSize; y < yEnd; y += sampleStep)
+			{
+				const uint8_t* row = image.Row(y);
+				int previous = Luma(row, image.bgra);
+
+				for (int x = 0; x < image.width; x += sampleStep)
+				{
+					int luma = Luma(row + size_t(x) * 4, image.bgra);
+					int column = x / blockSize;
+
+					lumaSums[column] += luma;
+					detailSums[column] += std::abs(luma - previous);
+					counts[column]++;
+
+					previous = luma;
+				}
+			}
+
+			for (int column = 0; column < signature.columns; column++)
+			{
+				size_t index = size_t(blockRow) * signature.columns + column;
+				uint32_t count = std::max<uint32_t>(counts[column], 1);
+
+				signature.luma[index] = uint8_t(lumaSums[column] / count);
+				signature.detail[index] = uint8_t(std::min<uint32_t>(detailSums[column] / count, 255));
+			}
+		}
+
+		return signature;
+	}
+
+	static bool IsBlockChanged(const Signature& a, const Signature& b, size_t index, int tolerance)
+	{
+		return std::abs(int(a.luma[index]) - int(b.luma[index])) > tolerance ||
+			std::abs(int(a.detail[index]) - int(b.detail[index])) > tolerance;
+	}
+
+	// Number of blocks where either the mean luma or the gradient moved by more than the tolerance.
+	// Returns -1 when the signatures were taken from differently sized frames.
+	static int CountChangedBlocks(const Signature& a, const Signature& b, int tolerance)
+	{
+		if (!a.IsValid() || !b.IsValid() || !a.IsCompatible(b))
+		{
+			return -1;
+		}
+
+		int changed = 0;
+
+		for (size_t i = 0; i < a.luma.size(); i++)
+		{
+			if (IsBlockChanged(a, b, i, tolerance))
+			{
+				changed++;
+			}
+		}
+
+		return changed;
+	}
+
+	static bool IsSameFrame(const Signature& a, const Signature& b, int tolerance, int maxChangedBlocks)
+	{
+		int changed = CountChangedBlocks(a, b, tolerance);
+
+		return changed >= 0 && changed <= maxChangedBlocks;
+	}
+
+	// Tile based change detection between two signatures.
+	// Changed blocks are grown by paddingBlocks (text strokes bleed over block borders),
+	// grouped into 8-connected regions and the bounding boxes of overlapping regions are merged.
+	// When the dirty area exceeds fullFrameRatio of the frame a single full frame rectangle is returned,
+	// so many scattered crops never cost more than one full upload.
+	static std::vector<ImageRect> FindDirtyRects(
+		const Signature& current,
+		const Signature& previous,
+		int tolerance,
+		int paddingBlocks = 1,
+		float fullFrameRatio = 0.6f)
+	{
+		std::vector<ImageRect> rects;
+
+		if (!current.IsValid())
+		{
+			return rects;
+		}
+
+		ImageRect fullFrame = { 0, 0, current.width, current.height };
+
+		if (!previous.IsValid() || !current.IsCompatible(previous))
+		{
+			rects.push_back(fullFrame);
+			return rects;
+		}
+
+		int columns = current.columns;
+		int rows = current.rows;
+		std::vector<uint8_t> dirty(size_t(columns) * rows, 0);
+
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				if (!IsBlockChanged(current, previous, size_t(row) * columns + column, tolerance))
+				{
+					continue;
+				}
+
+				for (int y = std::max(0, row - paddingBlocks); y <= std::min(rows - 1, row + paddingBlocks); y++)
+				{
+					for (int x = std::max(0, column - paddingBlocks); x <= std::min(columns - 1, column + paddingBlocks); x++)
+					{
+						dirty[size_t(y) * columns + x] = 1;
+					}
+				}
+			}
+		}
+
+		// Flood fill every dirty region into a block space bounding box
+		std::vector<int> stack;
+
+		for (int start = 0; start < columns * rows; start++)
+		{
+			if (dirty[start] != 1)
+			{
+				continue;
+			}
+
+			ImageRect box = { start % columns, start / columns, 1, 1 };
+			dirty[start] = 2;
+			stack.push_back(start);
+
+			while (!stack.empty())
+			{
+				int index = stack.back();
+				int column = index % columns;
+				int row = index / columns;
+				stack.pop_back();
+
+				box = box.Union({ column, row, 1, 1 });
+
+				for (int y = std::max(0, row - 1); y <= std::min(rows - 1, row + 1); y++)
+				{
+					for (int x = std::max(0, column - 1); x <= std::min(columns - 1, column + 1); x++)
+					{
+						int neighbour = y * columns + x;
+
+						if (dirty[neighbour] == 1)
+						{
+							dirty[neighbour] = 2;
+							stack.push_back(neighbour);
+						}
+					}
+				}
+			}
+
+			rects.push_back(box);
+		}
+
+		// Bounding boxes of separate regions can still overlap, merge until stable
+		bool merged = true;
+
+		while (merged)
+		{
+			merged = false;
+
+			for (size_t i = 0; i < rects.size() && !merged; i++)
+			{
+				for (size_t j = i + 1; j < rects.size(); j++)
+				{
+					if (rects[i].Intersects(rects[j]))
+					{
+						rects[i] = rects[i].Union(rects[j]);
+						rects.erase(rects.begin() + j);
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
+
+		int dirtyArea = 0;
+		int blockSize = current.blockSize;
+
+		for (ImageRect& rect : rects)
+		{
+			rect.x *= blockSize;
+			rect.y *= blockSize;
+			rect.width = std::min(rect.width * blockSize, current.width - rect.x);
+			rect.height = std::min(rect.height * blockSize, current.height - rect.y);
+			dirtyArea += rect.Area();
+		}
+
+		if (dirtyArea > fullFrameRatio * fullFrame.Area())
+		{
+			rects.clear();
+			rects.push_back(fullFrame);
+		}
+
+		return rects;
+	}
+}
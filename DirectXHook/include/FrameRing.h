@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Frames handed to a server on the same machine through shared memory. The memory holds a header, one
+// descriptor per slot and the slots. A frame is written to the next slot in turn and only the slot and its
+// sequence number go to the server with the request. The sequence of a slot is odd while it is written,
+// the reader checks it before and after copying the frame and drops a frame that was overwritten meanwhile,
+// so the writer never waits for the server. Server/server.py reads the same layout.
+class FrameRing
+{
+public:
+	// "IGTS" in little endian
+	static constexpr uint32_t Magic = 0x53544749;
+	static constexpr uint32_t Version = 1;
+	static constexpr size_t HeaderSize = 64;
+	static constexpr size_t DescriptorSize = 64;
+	// Slots start on a page boundary
+	static constexpr size_t Alignment = 4096;
+
+	// Where a written frame is, sent to the server in place of the frame
+	struct Frame
+	{
+		int slot = -1;
+		uint64_t sequence = 0;
+	};
+
+	static size_t GetMappingSize(int slotCount, size_t slotBytes)
+	{
+		return GetDataOffset(slotCount) + size_t(slotCount) * slotBytes;
+	}
+
+	// Formats the memory, which has to be GetMappingSize bytes and stay mapped while the ring is used
+	FrameRing(void* memory, int slotCount, size_t slotBytes)
+		: base((uint8_t*)memory), slotCount(slotCount), slotBytes(slotBytes)
+	{
+		for (int slot = 0; slot < slotCount; slot++)
+		{
+			new (GetDescriptor(base, slot)) Descriptor();
+		}
+
+		Header header = { Magic, Version, uint32_t(slotCount), 0, slotBytes, GetDataOffset(slotCount) };
+		std::memcpy(base, &header, sizeof(header));
+	}
+
+	size_t GetSlotBytes() const
+	{
+		return slotBytes;
+	}
+
+	// Copies the frame into the next slot, false when it is larger than a slot
+	bool Write(const void* data, size_t size, Frame* frame)
+	{
+		if (size > slotBytes)
+		{
+			return false;
+		}
+
+		int slot = nextSlot;
+		nextSlot = (nextSlot + 1) % slotCount;
+
+		Descriptor* descriptor = GetDescriptor(base, slot);
+		uint64_t sequence = descriptor->sequence.load(std::memory_order_relaxed);
+
+		descriptor->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		std::memcpy(base + GetDataOffset(slotCount) + size_t(slot) * slotBytes, data, size);
+		descriptor->size = size;
+
+		descriptor->sequence.store(sequence + 2, std::memory_order_release);
+
+		frame->slot = slot;
+		frame->sequence = sequence + 2;
+
+		return true;
+	}
+
+	// Reader side of the protocol: copies the frame out of memory of memorySize bytes. False when the memory
+	// is not a ring, or the slot does not hold the frame anymore.
+	static bool Read(const void* memory, size_t memorySize, const Frame& frame, std::vector<uint8_t>* data)
+	{
+		const uint8_t* base = (const uint8_t*)memory;
+		Header header;
+
+		if (memorySize < HeaderSize)
+		{
+			return false;
+		}
+
+		std::memcpy(&header, base, sizeof(header));
+
+		if (header.magic != Magic || header.version != Version || frame.slot < 0 || uint32_t(frame.slot) >= header.slotCount
+			|| header.dataOffset != GetDataOffset(header.slotCount) || GetMappingSize(header.slotCount, header.slotBytes) > memorySize)
+		{
+			return false;
+		}
+
+		const Descriptor* descriptor = GetDescriptor(base, frame.slot);
+
+		if (descriptor->sequence.load(std::memory_order_acquire) != frame.sequence)
+		{
+			return false;
+		}
+
+		size_t size = descriptor->size;
+
+		if (size > header.slotBytes)
+		{
+			return false;
+		}
+
+		const uint8_t* slot = base + header.dataOffset + size_t(frame.slot) * header.slotBytes;
+		data->assign(slot, slot + size);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		return descriptor->sequence.load(std::memory_order_relaxed) == frame.sequence;
+	}
+
+private:
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t reserved;
+		uint64_t slotBytes;
+		uint64_t dataOffset;
+	};
+
+	struct Descriptor
+	{
+		std::atomic<uint64_t> sequence{ 0 };
+		uint64_t size = 0;
+	};
+
+	static_assert(sizeof(Header) <= HeaderSize, "Header does not fit");
+	static_assert(sizeof(Descriptor) <= DescriptorSize, "Descriptor does not fit");
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "The sequence is shared with another process");
+
+	uint8_t* base;
+	int slotCount;
+	size_t slotBytes;
+	int nextSlot = 0;
+
+	static size_t GetDataOffset(size_t slotCount)
+	{
+		return (HeaderSize + slotCount * DescriptorSize + Alignment - 1) / Alignment * Alignment;
+	}
+
+	static Descriptor* GetDescriptor(const uint8_t* base, int slot)
+	{
+		return (Descriptor*)(base + HeaderSize + size_t(slot) * DescriptorSize);
+	}
+};
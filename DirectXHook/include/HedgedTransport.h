@@ -0,0 +1,378 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "LoadBalancer.h"
+#include "Transport.h"
+
+// Sends every request to one of several servers, picked by the load balancer. A request that fails before any
+// of its response arrived is sent again to the next server. Owned by a single worker like the transports it
+// wraps, only Cancel may be called from other threads. The connections are handed in, so the exchange can be
+// tested against local servers; BalancedTransport builds them from the configured servers.
+//
+// With StartHedging, a request that is not answered within the hedge delay of the HedgePolicy is sent a second
+// time from the hedge thread, to another healthy server. A second connection to the same server would only
+// wait behind the first. The attempt whose response starts first goes into the sink, the other one is cancelled.
+class HedgedTransport : public ITransport
+{
+public:
+	// One transport per server for the worker and one for the hedge thread, a transport is owned by a single thread
+	HedgedTransport(
+		std::vector<std::unique_ptr<ITransport>> transports,
+		std::vector<std::unique_ptr<ITransport>> hedgeTransports,
+		const LoadBalancerOptions& balancing,
+		const HedgeOptions& hedgeOptions)
+		: balancer(transports.size(), balancing),
+		hedgePolicy(hedgeOptions),
+		transports(std::move(transports)),
+		hedgeTransports(std::move(hedgeTransports))
+	{
+	}
+
+	~HedgedTransport()
+	{
+		{
+			std::lock_guard<std::mutex> lock(exchangeMutex);
+
+			stopping = true;
+		}
+
+		exchangeChanged.notify_all();
+
+		if (hedgeThread.joinable())
+		{
+			hedgeThread.join();
+		}
+	}
+
+	// Starts the hedge thread, only worth it with more than one server
+	void StartHedging()
+	{
+		if (hedging || transports.size() < 2)
+		{
+			return;
+		}
+
+		hedging = true;
+		hedgeThread = std::thread([this]() { SendHedges(); });
+	}
+
+	bool Send(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink) override
+	{
+		std::vector<int> tried;
+
+		while (!cancelled)
+		{
+			int endpoint = balancer.Acquire(GetTimeMs(), tried);
+
+			if (endpoint < 0)
+			{
+				return false;
+			}
+
+			tried.push_back(endpoint);
+
+			Exchange exchange{ verb, path, headers, data, dataSize, sink };
+			exchange.attempts[Primary] = { transports[endpoint].get(), endpoint };
+
+			bool succeeded = SendExchange(exchange);
+
+			if (exchange.attempts[Hedge].started)
+			{
+				tried.push_back(exchange.attempts[Hedge].endpoint);
+			}
+
+			// Part of the response already went into the sink, it cannot be received a second time
+			if (succeeded || exchange.delivered || exchange.aborted || cancelled)
+			{
+				return succeeded;
+			}
+
+			OnRetry(endpoint);
+		}
+
+		return false;
+	}
+
+	void BeginAttempt() override
+	{
+		std::lock_guard<std::mutex> lock(exchangeMutex);
+
+		cancelled = false;
+	}
+
+	void Cancel() override
+	{
+		std::lock_guard<std::mutex> lock(exchangeMutex);
+
+		cancelled = true;
+
+		if (current)
+		{
+			for (Attempt& attempt : current->attempts)
+			{
+				if (attempt.started && !attempt.finished)
+				{
+					attempt.transport->Cancel();
+				}
+			}
+		}
+
+		exchangeChanged.notify_all();
+	}
+
+	void Close() override
+	{
+		for (std::unique_ptr<ITransport>& transport : transports)
+		{
+			transport->Close();
+		}
+	}
+
+	LoadBalancer& GetBalancer()
+	{
+		return balancer;
+	}
+
+	// Hedges sent so far
+	uint64_t GetHedgeCount() const
+	{
+		return hedgeCount;
+	}
+
+protected:
+	LoadBalancer balancer;
+
+	static uint64_t GetTimeMs()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// The request failed on the server before any of its response arrived, it goes to the next server
+	virtual void OnRetry(int endpoint)
+	{
+	}
+
+	// The request was not answered within the hedge delay and is sent to the second server as well
+	virtual void OnHedge(int primary, int endpoint)
+	{
+	}
+
+	// The server was taken out of rotation after the request
+	virtual void OnEjected(int endpoint)
+	{
+	}
+
+private:
+	static constexpr int Primary = 0;
+	static constexpr int Hedge = 1;
+
+	// One try of a request on one connection
+	struct Attempt
+	{
+		ITransport* transport = nullptr;
+		int endpoint = -1;
+		bool started = false;
+		bool finished = false;
+		bool succeeded = false;
+	};
+
+	// A request and its attempts, the attempt states and winner are guarded by exchangeMutex
+	struct Exchange
+	{
+		const wchar_t* verb;
+		const wchar_t* path;
+		const std::wstring& headers;
+		const void* data;
+		size_t dataSize;
+		const ResponseSink& sink;
+
+		Attempt attempts[2];
+		// The attempt whose response goes into the sink, -1 until one started answering
+		int winner = -1;
+		bool hedgeDone = false;
+		// When the primary attempt started, the latency of the request counts from there whichever attempt won
+		uint64_t startMs = 0;
+		std::chrono::steady_clock::time_point hedgeAt;
+		// Written by the winner only
+		bool delivered = false;
+		bool aborted = false;
+	};
+
+	HedgePolicy hedgePolicy;
+	std::vector<std::unique_ptr<ITransport>> transports;
+	std::vector<std::unique_ptr<ITransport>> hedgeTransports;
+	bool hedging = false;
+	std::thread hedgeThread;
+	std::atomic<uint64_t> hedgeCount = 0;
+
+	std::mutex exchangeMutex;
+	std::condition_variable exchangeChanged;
+	Exchange* current = nullptr;
+	std::atomic<bool> cancelled = false;
+	bool stopping = false;
+
+	// Sends the primary attempt on the calling thread, while the hedge thread waits for the hedge delay
+	bool SendExchange(Exchange& exchange)
+	{
+		int delayMs = hedging ? hedgePolicy.GetDelayMs(exchange.path) : -1;
+
+		{
+			std::lock_guard<std::mutex> lock(exchangeMutex);
+
+			exchange.hedgeDone = delayMs < 0;
+			exchange.startMs = GetTimeMs();
+			exchange.hedgeAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+			exchange.attempts[Primary].started = !cancelled;
+			exchange.attempts[Primary].transport->BeginAttempt();
+			current = &exchange;
+		}
+
+		exchangeChanged.notify_all();
+
+		if (exchange.attempts[Primary].started)
+		{
+			RunAttempt(exchange, Primary);
+		}
+
+		std::unique_lock<std::mutex> lock(exchangeMutex);
+
+		exchange.attempts[Primary].finished = true;
+		exchangeChanged.notify_all();
+		exchangeChanged.wait(lock, [&exchange]() { return exchange.hedgeDone; });
+		current = nullptr;
+
+		return exchange.winner >= 0 && exchange.attempts[exchange.winner].succeeded;
+	}
+
+	void RunAttempt(Exchange& exchange, int role)
+	{
+		Attempt& attempt = exchange.attempts[role];
+
+		ResponseSink forward = [&](const char* chunk, size_t size)
+		{
+			if (!Claim(exchange, role))
+			{
+				return false;
+			}
+
+			exchange.delivered = true;
+			exchange.aborted = !exchange.sink(chunk, size);
+
+			return !exchange.aborted;
+		};
+
+		uint64_t start = GetTimeMs();
+		bool succeeded = attempt.transport->Send(exchange.verb, exchange.path, exchange.headers, exchange.data, exchange.dataSize, forward);
+		uint64_t latencyMs = GetTimeMs() - start;
+
+		// A response without a body wins when it ends first
+		bool won = succeeded && Claim(exchange, role);
+		LoadBalancer::Outcome outcome;
+
+		{
+			std::lock_guard<std::mutex> lock(exchangeMutex);
+
+			attempt.succeeded = won;
+			attempt.finished = true;
+			outcome = won
+				? LoadBalancer::Outcome::Succeeded
+				: exchange.winner >= 0 || exchange.aborted || cancelled ? LoadBalancer::Outcome::Cancelled : LoadBalancer::Outcome::Failed;
+		}
+
+		exchangeChanged.notify_all();
+
+		if (won)
+		{
+			hedgePolicy.Record(exchange.path, GetTimeMs() - exchange.startMs);
+		}
+
+		bool wasHealthy = balancer.GetStats(attempt.endpoint).healthy;
+		balancer.Release(attempt.endpoint, GetTimeMs(), outcome, latencyMs);
+
+		if (wasHealthy && !balancer.GetStats(attempt.endpoint).healthy)
+		{
+			OnEjected(attempt.endpoint);
+		}
+	}
+
+	// Makes the attempt the winner when there is none yet and cancels the other one. False when the other one won.
+	bool Claim(Exchange& exchange, int role)
+	{
+		std::lock_guard<std::mutex> lock(exchangeMutex);
+
+		if (exchange.winner < 0)
+		{
+			exchange.winner = role;
+
+			Attempt& other = exchange.attempts[1 - role];
+
+			if (other.started && !other.finished)
+			{
+				other.transport->Cancel();
+			}
+		}
+
+		return exchange.winner == role;
+	}
+
+	// Waits for each request until its hedge delay passed, and sends it again when it is still unanswered
+	void SendHedges()
+	{
+		std::unique_lock<std::mutex> lock(exchangeMutex);
+
+		while (true)
+		{
+			exchangeChanged.wait(lock, [this]() { return stopping || (current && !current->hedgeDone); });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			Exchange& exchange = *current;
+
+			bool answered = exchangeChanged.wait_until(lock, exchange.hedgeAt, [this, &exchange]()
+			{
+				return exchange.attempts[Primary].finished || exchange.winner >= 0 || cancelled;
+			});
+
+			int primary = exchange.attempts[Primary].endpoint;
+			int endpoint = answered ? -1 : balancer.Acquire(GetTimeMs(), { primary });
+
+			// Only to a working server, the budget is spent on hedges that are actually sent
+			if (endpoint >= 0 && balancer.GetStats(endpoint).healthy && hedgePolicy.TryHedge())
+			{
+				exchange.attempts[Hedge] = { hedgeTransports[endpoint].get(), endpoint, true };
+				exchange.attempts[Hedge].transport->BeginAttempt();
+				hedgeCount++;
+
+				lock.unlock();
+				OnHedge(primary, endpoint);
+				RunAttempt(exchange, Hedge);
+				lock.lock();
+			}
+			else if (endpoint >= 0)
+			{
+				balancer.Release(endpoint, GetTimeMs(), LoadBalancer::Outcome::Cancelled, 0);
+			}
+
+			exchange.hedgeDone = true;
+			exchangeChanged.notify_all();
+		}
+	}
+};
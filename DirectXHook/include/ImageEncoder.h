@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define IMAGE_ENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "ImageView.h"
+
+// Formats a capture can be uploaded in. BMP, PNG and JPEG are written by WIC on the client,
+// QOI is encoded here as it is lossless and an order of magnitude faster than PNG.
+enum class CaptureFormat
+{
+	Bmp,
+	Png,
+	Jpeg,
+	Qoi
+};
+
+namespace ImageEncoder
+{
+	// Name used in the server capability list
+	static const char* GetFormatName(CaptureFormat format)
+	{
+		switch (format)
+		{
+		case CaptureFormat::Png: return "png";
+		case CaptureFormat::Jpeg: return "jpeg";
+		case CaptureFormat::Qoi: return "qoi";
+		default: return "bmp";
+		}
+	}
+
+	static const wchar_t* GetContentType(CaptureFormat format)
+	{
+		switch (format)
+		{
+		case CaptureFormat::Png: return L"image/png";
+		case CaptureFormat::Jpeg: return L"image/jpeg";
+		case CaptureFormat::Qoi: return L"image/qoi";
+		default: return L"image/bmp";
+		}
+	}
+
+	namespace Qoi
+	{
+		static constexpr uint8_t OpIndex = 0x00;
+		static constexpr uint8_t OpDiff = 0x40;
+		static constexpr uint8_t OpLuma = 0x80;
+		static constexpr uint8_t OpRun = 0xc0;
+		static constexpr uint8_t OpRgb = 0xfe;
+		static constexpr int MaxRun = 62;
+		static constexpr uint32_t OpaqueMask = 0xff000000;
+
+		static inline void WriteBigEndian(std::vector<uint8_t>* out, uint32_t value)
+		{
+			out->push_back(uint8_t(value >> 24));
+			out->push_back(uint8_t(value >> 16));
+			out->push_back(uint8_t(value >> 8));
+			out->push_back(uint8_t(value));
+		}
+
+		// Number of pixels starting at x that are equal to the given (opaque) pixel
+		static inline int CountRun(const uint32_t* row, int x, int width, uint32_t pixel)
+		{
+			int start = x;
+
+#ifdef IMAGE_ENCODER_SSE2
+			const __m128i target = _mm_set1_epi32(int(pixel));
+			const __m128i opaque = _mm_set1_epi32(int(OpaqueMask));
+
+			while (x + 4 <= width)
+			{
+				__m128i pixels = _mm_or_si128(_mm_loadu_si128((const __m128i*)(row + x)), opaque);
+
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(pixels, target)) != 0xffff)
+				{
+					break;
+				}
+
+				x += 4;
+			}
+#endif
+
+			while (x < width && (row[x] | OpaqueMask) == pixel)
+			{
+				x++;
+			}
+
+			return x - start;
+		}
+
+		struct Encoder
+		{
+			std::vector<uint8_t>* out = nullptr;
+			uint32_t index[64] = {};
+			uint32_t previous = OpaqueMask;
+			int run = 0;
+
+			void Begin(int width, int height)
+			{
+				out->clear();
+				// Worst case is one RGB op per pixel, reserving the typical case keeps reallocations rare
+				out->reserve(size_t(width) * height + 22);
+
+				out->insert(out->end(), { 'q', 'o', 'i', 'f' });
+				WriteBigEndian(out, uint32_t(width));
+				WriteBigEndian(out, uint32_t(height));
+				out->push_back(3);
+				out->push_back(0);
+			}
+
+			// red and blue are the byte offsets of those channels within a pixel
+			void EncodeRow(const uint32_t* row, int width, int red, int blue)
+			{
+				int x = 0;
+
+				while (x < width)
+				{
+					uint32_t pixel = row[x] | OpaqueMask;
+
+					if (pixel == previous)
+					{
+						int length = CountRun(row, x, width, previous);
+
+						run += length;
+						x += length;
+
+						while (run >= MaxRun)
+						{
+							out->push_back(uint8_t(OpRun | (MaxRun - 1)));
+							run -= MaxRun;
+						}
+
+						continue;
+					}
+
+					if (run > 0)
+					{
+						out->push_back(uint8_t(OpRun | (run - 1)));
+						run = 0;
+					}
+
+					const uint8_t* bytes = (const uint8_t*)&pixel;
+					const uint8_t* previousBytes = (const uint8_t*)&previous;
+					uint8_t r = bytes[red];
+					uint8_t g = bytes[1];
+					uint8_t b = bytes[blue];
+					int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+
+					if (index[hash] == pixel)
+					{
+						out->push_back(uint8_t(OpIndex | hash));
+					}
+					else
+					{
+						index[hash] = pixel;
+
+						int8_t vr = int8_t(r - previousBytes[red]);
+						int8_t vg = int8_t(g - previousBytes[1]);
+						int8_t vb = int8_t(b - previousBytes[blue]);
+						int8_t vgr = int8_t(vr - vg);
+						int8_t vgb = int8_t(vb - vg);
+
+						if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+						{
+							out->push_back(uint8_t(OpDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+						}
+						else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8)
+						{
+							out->push_back(uint8_t(OpLuma | (vg + 32)));
+							out->push_back(uint8_t((vgr + 8) << 4 | (vgb + 8)));
+						}
+						else
+						{
+							out->push_back(OpRgb);
+							out->push_back(r);
+							out->push_back(g);
+							out->push_back(b);
+						}
+					}
+
+					previous = pixel;
+					x++;
+				}
+			}
+
+			void End()
+			{
+				if (run > 0)
+				{
+					out->push_back(uint8_t(OpRun | (run - 1)));
+					run = 0;
+				}
+
+				out->insert(out->end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+			}
+		};
+	}
+
+	// Encodes the image as an opaque, three channel QOI stream (https://qoiformat.org/qoi-specification.pdf).
+	// The alpha channel of back buffers is meaningless for OCR and is dropped.
+	static bool EncodeQoi(const ImageView& image, std::vector<uint8_t>* out)
+	{
+		if (image.pixels == nullptr || image.width <= 0 || image.height <= 0)
+		{
+			return false;
+		}
+
+		Qoi::Encoder encoder;
+		encoder.out = out;
+		encoder.Begin(image.width, image.height);
+
+		for (int y = 0; y < image.height; y++)
+		{
+			encoder.EncodeRow((const uint32_t*)image.Row(y), image.width, image.bgra ? 2 : 0, image.bgra ? 0 : 2);
+		}
+
+		encoder.End();
+
+		return true;
+	}
+
+	// Grayscale images are expanded row by row, equal channels make QOI fall back to its short diff ops
+	static bool EncodeQoi(const GrayImage& image, std::vector<uint8_t>* out)
+	{
+		if (image.pixels.empty() || image.width <= 0 || image.height <= 0)
+		{
+			return false;
+		}
+
+		Qoi::Encoder encoder;
+		encoder.out = out;
+		encoder.Begin(image.width, image.height);
+
+		std::vector<uint32_t> row(image.width);
+
+		for (int y = 0; y < image.height; y++)
+		{
+			const uint8_t* source = image.Row(y);
+
+			for (int x = 0; x < image.width; x++)
+			{
+				row[x] = source[x] * 0x010101u;
+			}
+
+			encoder.EncodeRow(row.data(), image.width, 0, 2);
+		}
+
+		encoder.End();
+
+		return true;
+	}
+}
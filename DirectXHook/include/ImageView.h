@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Non-owning view over 8-bit, four channel pixel data (RGBA or BGRA).
+// Kept free of any Windows types so the image kernels can be used anywhere.
+struct ImageView
+{
+	const uint8_t* pixels = nullptr;
+	int width = 0;
+	int height = 0;
+	size_t rowPitch = 0;
+	bool bgra = false;
+
+	const uint8_t* Row(int y) const
+	{
+		return pixels + rowPitch * y;
+	}
+};
+
+// Owning 8-bit single channel image, rows are tightly packed
+struct GrayImage
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> pixels;
+
+	uint8_t* Row(int y)
+	{
+		return pixels.data() + size_t(width) * y;
+	}
+
+	const uint8_t* Row(int y) const
+	{
+		return pixels.data() + size_t(width) * y;
+	}
+};
+
+// Axis aligned pixel rectangle
+struct ImageRect
+{
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+
+	int Right() const
+	{
+		return x + width;
+	}
+
+	int Bottom() const
+	{
+		return y + height;
+	}
+
+	int Area() const
+	{
+		return width * height;
+	}
+
+	bool Intersects(const ImageRect& other) const
+	{
+		return x < other.Right() && other.x < Right() && y < other.Bottom() && other.y < Bottom();
+	}
+
+	ImageRect Union(const ImageRect& other) const
+	{
+		int left = x < other.x ? x : other.x;
+		int top = y < other.y ? y : other.y;
+		int right = Right() > other.Right() ? Right() : other.Right();
+		int bottom = Bottom() > other.Bottom() ? Bottom() : other.Bottom();
+
+		return { left, top, right - left, bottom - top };
+	}
+};
+
+// View of a rect of the image, sharing its pixels
+static ImageView CropView(const ImageView& image, const ImageRect& rect)
+{
+	ImageView view = image;
+	view.pixels = image.Row(rect.y) + size_t(rect.x) * 4;
+	view.width = rect.width;
+	view.height = rect.height;
+
+	return view;
+}
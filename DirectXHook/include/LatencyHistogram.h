@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Latencies in buckets that grow by ten percent, from 1 ms to a few minutes, so a percentile is accurate
+// to ten percent at any scale. Counts are halved once twice the window was added, recent latencies weigh more.
+class LatencyHistogram
+{
+public:
+	static constexpr int BucketCount = 128;
+
+	explicit LatencyHistogram(uint64_t window = 500) : window(window)
+	{
+		buckets.fill(0);
+	}
+
+	void Add(uint64_t latencyMs)
+	{
+		buckets[BucketOf(latencyMs)]++;
+
+		if (++count >= window * 2)
+		{
+			count = 0;
+
+			for (uint64_t& bucket : buckets)
+			{
+				bucket /= 2;
+				count += bucket;
+			}
+		}
+	}
+
+	uint64_t GetCount() const
+	{
+		return count;
+	}
+
+	// Upper bound of the bucket holding the percentile (0 - 100), 0 when empty
+	uint64_t GetPercentile(float percentile) const
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		uint64_t rank = uint64_t(std::ceil(std::clamp(percentile, 0.0f, 100.0f) / 100.0 * count));
+		uint64_t seen = 0;
+
+		for (int bucket = 0; bucket < BucketCount; bucket++)
+		{
+			seen += buckets[bucket];
+
+			if (seen >= std::max<uint64_t>(rank, 1))
+			{
+				return UpperBound(bucket);
+			}
+		}
+
+		return UpperBound(BucketCount - 1);
+	}
+
+	static int BucketOf(uint64_t latencyMs)
+	{
+		if (latencyMs <= 1)
+		{
+			return 0;
+		}
+
+		int bucket = int(std::log(double(latencyMs)) / std::log(Growth)) + 1;
+
+		return std::min(bucket, BucketCount - 1);
+	}
+
+	static uint64_t UpperBound(int bucket)
+	{
+		return uint64_t(std::ceil(std::pow(Growth, bucket)));
+	}
+
+private:
+	static constexpr double Growth = 1.1;
+
+	uint64_t window;
+	uint64_t count = 0;
+	std::array<uint64_t, BucketCount> buckets;
+};
+
+struct HedgeOptions
+{
+	// A request still unanswered at this percentile of the latencies of its kind is sent a second time
+	float percentile = 95.0f;
+	// Latencies of a kind measured before its requests are hedged
+	int minSamples = 20;
+	// Least time before a hedge, fast requests are not worth doubling
+	int minDelayMs = 50;
+	// Hedges as a fraction of all requests sent so far, 0.1 sends at most one request in ten twice. Keeps the
+	// extra load on the servers bounded when all of them slow down.
+	float budget = 0.1f;
+};
+
+// Decides when a request is hedged: one latency histogram per kind of request (the path it is sent to),
+// the hedge delay is the configured percentile of it. Thread safe.
+class HedgePolicy
+{
+public:
+	explicit HedgePolicy(const HedgeOptions& options = HedgeOptions()) : options(options)
+	{
+	}
+
+	// Time after which a request of the kind is hedged, -1 while too few of its latencies are known
+	int GetDelayMs(const std::wstring& kind)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		requests++;
+
+		const LatencyHistogram& histogram = histograms[kind];
+
+		if (histogram.GetCount() < uint64_t(options.minSamples))
+		{
+			return -1;
+		}
+
+		return std::max(options.minDelayMs, int(histogram.GetPercentile(options.percentile)));
+	}
+
+	// Latency of a request that was answered
+	void Record(const std::wstring& kind, uint64_t latencyMs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		histograms[kind].Add(latencyMs);
+	}
+
+	// True when the budget allows another hedge, which is then counted
+	bool TryHedge()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (hedges + 1 > options.budget * requests)
+		{
+			return false;
+		}
+
+		hedges++;
+
+		return true;
+	}
+
+private:
+	HedgeOptions options;
+	std::mutex mutex;
+	std::map<std::wstring, LatencyHistogram> histograms;
+	uint64_t requests = 0;
+	uint64_t hedges = 0;
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// A translation server
+struct ServerEndpoint
+{
+	const wchar_t* address;
+	uint16_t port;
+	// The server runs on this machine, frames are handed to it in shared memory, see SharedMemoryTransport.h
+	bool sharedMemory = false;
+};
+
+enum class LoadBalancing
+{
+	// Fewest requests in flight, the lower latency average on ties
+	LeastOutstanding,
+	// Lowest latency average weighted by the requests in flight, a fast server gets more work until it slows down
+	PeakEwma
+};
+
+struct LoadBalancerOptions
+{
+	LoadBalancing policy = LoadBalancing::PeakEwma;
+	// Weight of the newest latency in the moving average
+	float ewmaWeight = 0.3f;
+	// Failures in a row that take a server out of rotation
+	int maxFailures = 2;
+	// Time a server stays out before it is checked again, doubled on every failed check up to maxEjectionMs
+	int ejectionMs = 5000;
+	int maxEjectionMs = 60000;
+	// A server is slow when its latency average is this many times the one of the fastest other server
+	float slowFactor = 3.0f;
+	// and at least this high, small differences between fast servers do not matter
+	int minSlowMs = 500;
+	// Requests a server has to answer before it can be found slow
+	int minSamples = 3;
+	// The latency average of a server counts half for every this long it did not answer a request,
+	// so a server that was slow once gets measured again now and then
+	int idleHalfLifeMs = 10000;
+};
+
+// Picks the server for the next request and keeps the health of every server. Failing and slow servers are
+// ejected, they come back once a health check succeeds. While every server is ejected, the one that comes
+// back first is used anyway. Time is passed in by the caller so the balancer can be replayed in tests.
+// Thread safe, the health checks run on a thread of their own.
+class LoadBalancer
+{
+public:
+	enum class Outcome
+	{
+		Succeeded,
+		Failed,
+		// Aborted by the client, says nothing about the server
+		Cancelled
+	};
+
+	struct Stats
+	{
+		uint64_t requests = 0;
+		uint64_t failures = 0;
+		uint64_t ejections = 0;
+		float ewmaMs = 0.0f;
+		int outstanding = 0;
+		bool healthy = true;
+	};
+
+	LoadBalancer(size_t endpointCount, const LoadBalancerOptions& options = LoadBalancerOptions())
+		: options(options), endpoints(endpointCount)
+	{
+	}
+
+	size_t GetCount() const
+	{
+		return endpoints.size();
+	}
+
+	// The server for a request, skipping those in tried. -1 when every server was tried.
+	// The request counts as outstanding until Release.
+	int Acquire(uint64_t nowMs, const std::vector<int>& tried = {})
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		int best = -1;
+
+		for (int i = 0; i < int(endpoints.size()); i++)
+		{
+			if (std::find(tried.begin(), tried.end(), i) != tried.end())
+			{
+				continue;
+			}
+
+			if (best < 0 || IsBetter(i, best, nowMs))
+			{
+				best = i;
+			}
+		}
+
+		if (best >= 0)
+		{
+			endpoints[best].outstanding++;
+			endpoints[best].stats.requests++;
+		}
+
+		return best;
+	}
+
+	void Release(int endpoint, uint64_t nowMs, Outcome outcome, uint64_t latencyMs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Endpoint& target = endpoints[endpoint];
+		target.outstanding = std::max(0, target.outstanding - 1);
+
+		if (outcome == Outcome::Cancelled)
+		{
+			return;
+		}
+
+		if (outcome == Outcome::Failed)
+		{
+			target.stats.failures++;
+
+			if (++target.failures >= options.maxFailures && target.healthy)
+			{
+				Eject(target, nowMs);
+			}
+
+			return;
+		}
+
+		target.failures = 0;
+		target.samples++;
+		target.lastResponseMs = nowMs;
+		target.ewmaMs = target.samples == 1
+			? float(latencyMs)
+			: target.ewmaMs + options.ewmaWeight * (float(latencyMs) - target.ewmaMs);
+
+		if (target.healthy && IsSlow(endpoint))
+		{
+			Eject(target, nowMs);
+		}
+	}
+
+	// Ejected servers whose time out ended, the caller checks them and reports with ReportHealthCheck
+	std::vector<int> GetHealthChecksDue(uint64_t nowMs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<int> due;
+
+		for (int i = 0; i < int(endpoints.size()); i++)
+		{
+			if (!endpoints[i].healthy && nowMs >= endpoints[i].ejectedUntilMs)
+			{
+				due.push_back(i);
+			}
+		}
+
+		return due;
+	}
+
+	// A working server is back in rotation with a fresh latency average, a failing one stays out twice as long
+	void ReportHealthCheck(int endpoint, uint64_t nowMs, bool succeeded)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Endpoint& target = endpoints[endpoint];
+
+		if (succeeded)
+		{
+			target.healthy = true;
+			target.failures = 0;
+			target.samples = 0;
+			target.ewmaMs = 0.0f;
+			target.ejectionMs = options.ejectionMs;
+			return;
+		}
+
+		target.ejectionMs = std::min(options.maxEjectionMs, target.ejectionMs * 2);
+		target.ejectedUntilMs = nowMs + uint64_t(target.ejectionMs);
+	}
+
+	Stats GetStats(int endpoint)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Stats stats = endpoints[endpoint].stats;
+		stats.ewmaMs = endpoints[endpoint].ewmaMs;
+		stats.outstanding = endpoints[endpoint].outstanding;
+		stats.healthy = endpoints[endpoint].healthy;
+
+		return stats;
+	}
+
+private:
+	struct Endpoint
+	{
+		bool healthy = true;
+		int outstanding = 0;
+		int failures = 0;
+		int samples = 0;
+		float ewmaMs = 0.0f;
+		uint64_t lastResponseMs = 0;
+		int ejectionMs = 0;
+		uint64_t ejectedUntilMs = 0;
+		Stats stats;
+	};
+
+	LoadBalancerOptions options;
+	std::mutex mutex;
+	std::vector<Endpoint> endpoints;
+
+	void Eject(Endpoint& target, uint64_t nowMs)
+	{
+		target.healthy = false;
+		target.ejectionMs = target.ejectionMs > 0 ? target.ejectionMs : options.ejectionMs;
+		target.ejectedUntilMs = nowMs + uint64_t(target.ejectionMs);
+		target.stats.ejections++;
+	}
+
+	// Healthy before ejected, an ejected one coming back sooner before one coming back later
+	bool IsBetter(int candidate, int best, uint64_t nowMs) const
+	{
+		const Endpoint& a = endpoints[candidate];
+		const Endpoint& b = endpoints[best];
+
+		if (a.healthy != b.healthy)
+		{
+			return a.healthy;
+		}
+
+		if (!a.healthy)
+		{
+			return a.ejectedUntilMs < b.ejectedUntilMs;
+		}
+
+		// Servers without measurements go first, so every server gets measured. Their average is 0 and says
+		// nothing, so among them the one with fewer requests in flight goes first.
+		if (a.samples == 0 || b.samples == 0)
+		{
+			return a.samples != b.samples ? a.samples == 0 : a.outstanding < b.outstanding;
+		}
+
+		float latencyA = GetIdleLatency(a, nowMs);
+		float latencyB = GetIdleLatency(b, nowMs);
+
+		if (options.policy == LoadBalancing::LeastOutstanding)
+		{
+			return a.outstanding != b.outstanding ? a.outstanding < b.outstanding : latencyA < latencyB;
+		}
+
+		return latencyA * (a.outstanding + 1) < latencyB * (b.outstanding + 1);
+	}
+
+	float GetIdleLatency(const Endpoint& endpoint, uint64_t nowMs) const
+	{
+		if (options.idleHalfLifeMs <= 0 || nowMs <= endpoint.lastResponseMs)
+		{
+			return endpoint.ewmaMs;
+		}
+
+		return endpoint.ewmaMs * std::exp2(-float(nowMs - endpoint.lastResponseMs) / options.idleHalfLifeMs);
+	}
+
+	// Slower than the fastest other healthy server by slowFactor, the last healthy server is never slow
+	bool IsSlow(int endpoint) const
+	{
+		const Endpoint& target = endpoints[endpoint];
+
+		if (target.samples < options.minSamples || target.ewmaMs < options.minSlowMs)
+		{
+			return false;
+		}
+
+		for (int i = 0; i < int(endpoints.size()); i++)
+		{
+			const Endpoint& other = endpoints[i];
+
+			if (i != endpoint && other.healthy && other.samples > 0 && target.ewmaMs > options.slowFactor * other.ewmaMs)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+};
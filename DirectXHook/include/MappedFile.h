@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file, MapViewOfFile on Windows and mmap elsewhere.
+// The file stays open for writing by others, appended bytes are not part of the view until it is opened again.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const std::filesystem::path& path)
+	{
+		Close();
+
+#ifdef _WIN32
+		file = CreateFileW(
+			path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL,
+			NULL);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			Close();
+			return false;
+		}
+
+		size = size_t(fileSize.QuadPart);
+
+		// Empty files cannot be mapped, they are opened with an empty view
+		if (size > 0)
+		{
+			mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+			if (mapping == NULL)
+			{
+				Close();
+				return false;
+			}
+
+			data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		}
+#else
+		file = open(path.c_str(), O_RDONLY);
+
+		if (file < 0)
+		{
+			return false;
+		}
+
+		struct stat status;
+
+		if (fstat(file, &status) != 0)
+		{
+			Close();
+			return false;
+		}
+
+		size = size_t(status.st_size);
+
+		if (size > 0)
+		{
+			void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+			data = view == MAP_FAILED ? nullptr : (const uint8_t*)view;
+		}
+#endif
+
+		if (size > 0 && data == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		opened = true;
+
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		if (mapping != NULL)
+		{
+			CloseHandle(mapping);
+			mapping = NULL;
+		}
+
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (data != nullptr)
+		{
+			munmap((void*)data, size);
+		}
+
+		if (file >= 0)
+		{
+			close(file);
+			file = -1;
+		}
+#endif
+
+		data = nullptr;
+		size = 0;
+		opened = false;
+	}
+
+	bool IsOpen() const
+	{
+		return opened;
+	}
+
+	const uint8_t* GetData() const
+	{
+		return data;
+	}
+
+	size_t GetSize() const
+	{
+		return size;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int file = -1;
+#endif
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	bool opened = false;
+};
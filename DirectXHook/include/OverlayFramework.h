@@ -12,6 +12,10 @@
 #include <string>
 
 #include "Logger.h"
+#include "TextQueue.h"
+#include "TextShadow.h"
+#include "TextLayout.h"
+#include "FontMetrics.h"
 
 #undef DrawText
 
@@ -44,6 +48,45 @@ namespace OF
 	static std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> ofTextures = std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>();
 	static std::vector<std::shared_ptr<DirectX::SpriteFont>> ofFonts = std::vector<std::shared_ptr<DirectX::SpriteFont>>();
 	static std::shared_ptr<DirectX::SpriteFont> ofActiveFont = nullptr;
+	// Metrics read from the same files, text is measured on the CPU without going through SpriteFont
+	static std::vector<std::shared_ptr<FontMetrics>> ofFontMetrics = std::vector<std::shared_ptr<FontMetrics>>();
+	static std::shared_ptr<FontMetrics> ofActiveFontMetrics = nullptr;
+	static TextQueue ofTextQueue;
+
+	// Draws queued text with the overlay sprite batch, the font of a command is a DirectX::SpriteFont
+	class SpriteBatchTextBackend : public ITextBackend
+	{
+	public:
+		void Begin() override
+		{
+			ofSpriteBatch->Begin();
+		}
+
+		void DrawString(const TextCommand& command, const char* text) override
+		{
+			DirectX::XMVECTORF32 color = { { { command.color.r, command.color.g, command.color.b, command.color.a } } };
+
+			try
+			{
+				((DirectX::SpriteFont*)command.font)->DrawString(
+					ofSpriteBatch.get(),
+					text,
+					DirectX::XMFLOAT2(command.x, command.y),
+					color,
+					0.0f,
+					DirectX::XMFLOAT2(0.0f, 0.0f),
+					DirectX::XMFLOAT2(command.scaleX, command.scaleY));
+			}
+			catch (...) {
+				// Pass
+			}
+		}
+
+		void End() override
+		{
+			ofSpriteBatch->End();
+		}
+	};
 
 	// Gives the framework the required DirectX objects to draw
 	static void InitFramework(
@@ -163,11 +206,20 @@ namespace OF
 
 		logger.Log("Font was loaded successfully");
 
+		auto metrics = std::make_shared<FontMetrics>();
+
+		if (!metrics->Load(filepath))
+		{
+			logger.Log("Font metrics could not be read, text is measured with SpriteFont");
+		}
+
 		ofFonts.push_back(font);
+		ofFontMetrics.push_back(metrics);
 
 		if (ofActiveFont == nullptr)
 		{
 			ofActiveFont = font;
+			ofActiveFontMetrics = metrics;
 		}
 
 		return ofFonts.size() - 1;
@@ -182,6 +234,7 @@ namespace OF
 		}
 
 		ofActiveFont = ofFonts[font];
+		ofActiveFontMetrics = ofFontMetrics[font];
 	}
 
 	static void PlaceOnTop(Box* box)
@@ -325,62 +378,109 @@ namespace OF
 		_DrawBox(box, { _r, _g, _b, _a }, 0);
 	}
 
-	static void DrawText(const char* text, int x, int y, float w, float h, XMVECTOR color)
+	// Size of the text at scale 1, zero when it cannot be measured
+	static TextSize MeasureWith(DirectX::SpriteFont* font, const FontMetrics* metrics, const char* text)
 	{
-		if (ofActiveFont == nullptr)
+		TextSize size;
+
+		if (font == nullptr)
 		{
-			logger.Log("Attempted to render text with an invalid font, make sure to run SetFont first!");
-			return;
+			return size;
 		}
 
-		XMFLOAT2 size;
-		XMVECTOR textVector;
+		if (metrics != nullptr && metrics->IsLoaded())
+		{
+			return metrics->MeasureString(text);
+		}
 
 		try
 		{
-			textVector = ofActiveFont->MeasureString(text);
+			XMFLOAT2 measured;
+			XMStoreFloat2(&measured, font->MeasureString(text));
+
+			size.width = measured.x;
+			size.height = measured.y;
 		}
 		catch (...)
 		{
-			return;
+			// Pass
 		}
 
-		XMStoreFloat2(&size, textVector);
+		return size;
+	}
 
-		XMFLOAT2 position = XMFLOAT2(float(x), float(y));
-		XMFLOAT2 origin = XMFLOAT2(0.0f, 0.0f);
-		XMFLOAT2 scale = XMFLOAT2(float(w) / size.x, float(h) / size.y);
+	// Size of the text in the active font at scale 1, zero when it cannot be measured
+	static TextSize MeasureText(const char* text)
+	{
+		return MeasureWith(ofActiveFont.get(), ofActiveFontMetrics.get(), text);
+	}
 
-		ofSpriteBatch->Begin();
+	// Measures in the font active now, also after another one was set. Measuring only reads the glyphs,
+	// so the translate worker lays out text with it while the render thread draws.
+	static TextLayoutEngine::MeasureFunction GetMeasureFunction()
+	{
+		std::shared_ptr<DirectX::SpriteFont> font = ofActiveFont;
+		std::shared_ptr<FontMetrics> metrics = ofActiveFontMetrics;
 
-		const double pi = atan(1.0f) * 4.0f;
-		const int r = SubtitleShadowRadius;
+		return [font, metrics](const char* text) { return MeasureWith(font.get(), metrics.get(), text); };
+	}
 
-		for (int i = 0; i <= 360; i++)
+	// Queues the text with its shadow at a layout computed beforehand, nothing is measured here
+	static void DrawText(const char* text, const TextLayout& layout, XMVECTOR color)
+	{
+		if (ofActiveFont == nullptr)
 		{
-			XMFLOAT2 p;
-
-			p.x = position.x + r * std::cos(pi * i / 180.0f);
-			p.y = position.y + r * std::sin(pi * i / 180.0f);
+			logger.Log("Attempted to render text with an invalid font, make sure to run SetFont first!");
+			return;
+		}
 
-			try
-			{
-				ofActiveFont->DrawString(ofSpriteBatch.get(), text, p, Colors::Black, 0.0f, origin, scale);
-			}
-			catch (...) {
-				// Pass
-			}
+		if (!layout.visible)
+		{
+			return;
 		}
 
-		try
+		TextCommand command;
+		command.font = ofActiveFont.get();
+		command.textOffset = ofTextQueue.AddText(text);
+		command.scaleX = layout.scaleX;
+		command.scaleY = layout.scaleY;
+		command.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		static const std::vector<TextShadow::Offset> shadowOffsets = TextShadow::ComputeOffsets(SubtitleShadowRadius, SubtitleShadowQuality);
+
+		for (const TextShadow::Offset& offset : shadowOffsets)
 		{
-			ofActiveFont->DrawString(ofSpriteBatch.get(), text, position, color, 0.0f, origin, scale);
+			command.x = layout.x + offset.x;
+			command.y = layout.y + offset.y;
+
+			ofTextQueue.Push(command);
 		}
-		catch (...) {
-			// Pass
+
+		XMFLOAT4 fill;
+		XMStoreFloat4(&fill, color);
+
+		command.x = layout.x;
+		command.y = layout.y;
+		command.color = { fill.x, fill.y, fill.z, fill.w };
+
+		ofTextQueue.Push(command);
+	}
+
+	static void DrawText(const char* text, int x, int y, float w, float h, XMVECTOR color)
+	{
+		DrawText(text, TextLayoutEngine::StretchToBox(MeasureText(text), float(x), float(y), w, h), color);
+	}
+
+	// Submits the text queued by DrawText during the frame in one sprite batch
+	static void FlushText()
+	{
+		if (ofSpriteBatch == nullptr)
+		{
+			return;
 		}
 
-		ofSpriteBatch->End();
+		SpriteBatchTextBackend backend;
+		ofTextQueue.Flush(backend);
 	}
 
 	static void DrawText(
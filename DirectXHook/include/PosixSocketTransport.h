@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "Transport.h"
+
+// HTTP/1.1 over a plain POSIX socket, the counterpart of WinHttpTransport for clients and tests that do not
+// run on Windows. One connection is kept open and reused for consecutive requests as long as the server
+// answers with a Content-Length and does not ask to close it. Owned by a single worker, only Cancel may be
+// called from other threads.
+class PosixSocketTransport : public ITransport
+{
+public:
+	// timeoutMs limits every send and every wait for response bytes, 0 waits as long as the system does
+	PosixSocketTransport(const std::string& host, uint16_t port, int timeoutMs = 0)
+		: host(host), port(port), timeoutMs(timeoutMs)
+	{
+	}
+
+	~PosixSocketTransport()
+	{
+		Close();
+	}
+
+	bool Send(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink) override
+	{
+		bool connectionFailed = false;
+
+		if (Open() && SendOnce(verb, path, headers, data, dataSize, sink, &connectionFailed))
+		{
+			return true;
+		}
+
+		// The server may have closed the idle connection, one retry on a fresh one
+		if (connectionFailed && !cancelled)
+		{
+			Close();
+
+			return Open() && SendOnce(verb, path, headers, data, dataSize, sink, &connectionFailed);
+		}
+
+		return false;
+	}
+
+	void BeginAttempt() override
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+
+		cancelled = false;
+	}
+
+	void Cancel() override
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+
+		cancelled = true;
+
+		// Shutting the socket down makes the blocking send or recv of the worker return, the worker closes it
+		if (activeSocket >= 0)
+		{
+			shutdown(activeSocket, SHUT_RDWR);
+		}
+	}
+
+	void Close() override
+	{
+		if (connection >= 0)
+		{
+			close(connection);
+		}
+
+		connection = -1;
+	}
+
+	// Connections opened so far, a reused connection does not count again
+	uint64_t GetConnectCount() const
+	{
+		return connects;
+	}
+
+private:
+	std::string host;
+	uint16_t port;
+	int timeoutMs;
+	int connection = -1;
+	uint64_t connects = 0;
+
+	std::mutex requestMutex;
+	int activeSocket = -1;
+	std::atomic<bool> cancelled = false;
+	std::vector<char> receiveBuffer;
+
+	bool Open()
+	{
+		if (connection >= 0)
+		{
+			return true;
+		}
+
+		addrinfo hints = {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo* addresses = nullptr;
+
+		if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+		{
+			return false;
+		}
+
+		for (addrinfo* address = addresses; address != nullptr && connection < 0; address = address->ai_next)
+		{
+			connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+			if (connection >= 0 && connect(connection, address->ai_addr, address->ai_addrlen) != 0)
+			{
+				close(connection);
+				connection = -1;
+			}
+		}
+
+		freeaddrinfo(addresses);
+
+		if (connection < 0)
+		{
+			return false;
+		}
+
+		// Requests are written in one piece and waited for, Nagle would only delay them
+		int noDelay = 1;
+		setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+#ifdef SO_NOSIGPIPE
+		int noSignal = 1;
+		setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &noSignal, sizeof(noSignal));
+#endif
+
+		if (timeoutMs > 0)
+		{
+			timeval timeout = {};
+			timeout.tv_sec = timeoutMs / 1000;
+			timeout.tv_usec = (timeoutMs % 1000) * 1000;
+			setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		}
+
+		connects++;
+
+		return true;
+	}
+
+	bool SendOnce(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink,
+		bool* connectionFailed)
+	{
+		*connectionFailed = false;
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			// Cancelled before the request started, Cancel had nothing to shut down
+			if (cancelled)
+			{
+				return false;
+			}
+
+			activeSocket = connection;
+		}
+
+		// Verbs, paths and headers of the client are ASCII
+		std::string head = Narrow(verb) + " " + Narrow(path) + " HTTP/1.1\r\n";
+		head += "Host: " + host + ":" + std::to_string(port) + "\r\n";
+		head += "Content-Length: " + std::to_string(dataSize) + "\r\n";
+
+		if (!headers.empty())
+		{
+			head += Narrow(headers.c_str()) + "\r\n";
+		}
+
+		head += "\r\n";
+
+		bool keepAlive = false;
+		bool accepted = false;
+		bool complete = false;
+
+		if (WriteAll(head.data(), head.size()) && WriteAll(data, dataSize))
+		{
+			complete = ReadResponse(sink, &accepted, &keepAlive, connectionFailed);
+		}
+		else
+		{
+			*connectionFailed = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			activeSocket = -1;
+
+			if (cancelled)
+			{
+				*connectionFailed = false;
+				complete = false;
+			}
+		}
+
+		// A connection that was cancelled, failed or left in the middle of a body cannot carry the next request
+		if (!complete || !keepAlive)
+		{
+			Close();
+		}
+
+		return complete && accepted;
+	}
+
+	bool WriteAll(const void* data, size_t size)
+	{
+		const char* bytes = (const char*)data;
+
+		while (size > 0)
+		{
+#ifdef MSG_NOSIGNAL
+			ssize_t written = send(connection, bytes, size, MSG_NOSIGNAL);
+#else
+			ssize_t written = send(connection, bytes, size, 0);
+#endif
+
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (written <= 0)
+			{
+				return false;
+			}
+
+			bytes += written;
+			size -= size_t(written);
+		}
+
+		return true;
+	}
+
+	// Receives into the reusable buffer, 0 when the server closed the connection and -1 on errors
+	ssize_t Receive()
+	{
+		if (receiveBuffer.empty())
+		{
+			receiveBuffer.resize(64 * 1024);
+		}
+
+		ssize_t size;
+
+		do
+		{
+			size = recv(connection, receiveBuffer.data(), receiveBuffer.size(), 0);
+		} while (size < 0 && errno == EINTR);
+
+		return size;
+	}
+
+	// Reads the status line and headers, then hands every chunk of a 200 response body to the sink as soon as
+	// it arrives. Without a Content-Length the body ends when the server closes the connection. True when the
+	// whole response was read, accepted tells whether it was a 200.
+	bool ReadResponse(const ResponseSink& sink, bool* accepted, bool* keepAlive, bool* connectionFailed)
+	{
+		std::string head;
+		size_t headEnd = std::string::npos;
+
+		while (headEnd == std::string::npos)
+		{
+			ssize_t size = Receive();
+
+			if (size <= 0)
+			{
+				// Nothing of the response arrived, a stale keep-alive connection looks like this
+				*connectionFailed = head.empty();
+				return false;
+			}
+
+			head.append(receiveBuffer.data(), size_t(size));
+			headEnd = head.find("\r\n\r\n");
+		}
+
+		int statusCode = 0;
+		long long contentLength = -1;
+		*keepAlive = true;
+
+		if (head.compare(0, 5, "HTTP/") != 0 || head.find(' ') == std::string::npos)
+		{
+			return false;
+		}
+
+		statusCode = std::atoi(head.c_str() + head.find(' ') + 1);
+
+		for (size_t line = head.find("\r\n") + 2; line < headEnd; line = head.find("\r\n", line) + 2)
+		{
+			std::string header = Lowercase(head.substr(line, head.find("\r\n", line) - line));
+
+			if (header.compare(0, 15, "content-length:") == 0)
+			{
+				contentLength = std::atoll(header.c_str() + 15);
+			}
+			else if (header.compare(0, 11, "connection:") == 0 && header.find("close") != std::string::npos)
+			{
+				*keepAlive = false;
+			}
+		}
+
+		if (contentLength < 0)
+		{
+			*keepAlive = false;
+		}
+
+		// A body that is not wanted is still read, so the connection can be reused
+		*accepted = statusCode == 200;
+		ResponseSink discard = [](const char*, size_t) { return true; };
+		const ResponseSink& target = *accepted ? sink : discard;
+
+		size_t bodyStart = headEnd + 4;
+		uint64_t remaining = contentLength < 0 ? UINT64_MAX : uint64_t(contentLength);
+		size_t first = size_t(std::min<uint64_t>(head.size() - bodyStart, remaining));
+
+		if (first > 0 && !target(head.data() + bodyStart, first))
+		{
+			return false;
+		}
+
+		remaining -= first;
+
+		while (remaining > 0)
+		{
+			ssize_t size = Receive();
+
+			if (size == 0 && contentLength < 0)
+			{
+				break;
+			}
+
+			if (size <= 0)
+			{
+				return false;
+			}
+
+			size_t chunk = size_t(std::min<uint64_t>(uint64_t(size), remaining));
+
+			if (!target(receiveBuffer.data(), chunk))
+			{
+				return false;
+			}
+
+			remaining -= chunk;
+		}
+
+		return true;
+	}
+
+	static std::string Narrow(const wchar_t* text)
+	{
+		std::string narrow;
+
+		for (; *text != L'\0'; text++)
+		{
+			narrow += char(*text);
+		}
+
+		return narrow;
+	}
+
+	static std::string Lowercase(std::string text)
+	{
+		for (char& character : text)
+		{
+			if (character >= 'A' && character <= 'Z')
+			{
+				character = char(character - 'A' + 'a');
+			}
+		}
+
+		return text;
+	}
+};
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PREPROCESS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PREPROCESS_TARGET_AVX2
+#else
+#define PREPROCESS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include "ImageView.h"
+
+// Turns a capture into what OCR actually needs: a grayscale image at a sensible resolution
+namespace Preprocess
+{
+	enum class Isa
+	{
+		Scalar,
+		Sse2,
+		Avx2
+	};
+
+	struct Options
+	{
+		// Integer area-average downscale factor, 1 keeps the native resolution
+		int downscale = 1;
+		// Stretches the 1st - 99th luma percentile to the full range
+		bool normalizeContrast = false;
+	};
+
+	// Integer BT.601 weights summing to 256, the same as FrameDiff::Luma.
+	// Products and their sum stay below 65536, so the SIMD paths can work on 16-bit lanes.
+	static constexpr int WeightRed = 77;
+	static constexpr int WeightGreen = 150;
+	static constexpr int WeightBlue = 29;
+
+	static Isa DetectIsa()
+	{
+#ifdef PREPROCESS_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+
+			if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+			{
+				return Isa::Avx2;
+			}
+		}
+#else
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return Isa::Avx2;
+		}
+#endif
+		return Isa::Sse2;
+#else
+		return Isa::Scalar;
+#endif
+	}
+
+	static Isa GetIsa()
+	{
+		static const Isa isa = DetectIsa();
+		return isa;
+	}
+
+	static void LumaRowScalar(const uint8_t* source, uint8_t* target, int width, bool bgra)
+	{
+		const int w0 = bgra ? WeightBlue : WeightRed;
+		const int w2 = bgra ? WeightRed : WeightBlue;
+
+		for (int x = 0; x < width; x++)
+		{
+			const uint8_t* pixel = source + size_t(x) * 4;
+			target[x] = uint8_t((w0 * pixel[0] + WeightGreen * pixel[1] + w2 * pixel[2]) >> 8);
+		}
+	}
+
+#ifdef PREPROCESS_X86
+	// Four pixels held as 32-bit lanes, returns the luma of each in the low byte of its lane
+	static inline __m128i LumaLanesSse2(__m128i pixels, __m128i w0, __m128i w1, __m128i w2)
+	{
+		const __m128i mask = _mm_set1_epi32(0xff);
+
+		__m128i c0 = _mm_and_si128(pixels, mask);
+		__m128i c1 = _mm_and_si128(_mm_srli_epi32(pixels, 8), mask);
+		__m128i c2 = _mm_and_si128(_mm_srli_epi32(pixels, 16), mask);
+
+		__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(c0, w0), _mm_mullo_epi16(c1, w1)), _mm_mullo_epi16(c2, w2));
+
+		return _mm_srli_epi32(sum, 8);
+	}
+
+	static void LumaRowSse2(const uint8_t* source, uint8_t* target, int width, bool bgra)
+	{
+		const __m128i w0 = _mm_set1_epi32(bgra ? WeightBlue : WeightRed);
+		const __m128i w1 = _mm_set1_epi32(WeightGreen);
+		const __m128i w2 = _mm_set1_epi32(bgra ? WeightRed : WeightBlue);
+
+		int x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i* pixels = (const __m128i*)(source + size_t(x) * 4);
+
+			__m128i a = LumaLanesSse2(_mm_loadu_si128(pixels + 0), w0, w1, w2);
+			__m128i b = LumaLanesSse2(_mm_loadu_si128(pixels + 1), w0, w1, w2);
+			__m128i c = LumaLanesSse2(_mm_loadu_si128(pixels + 2), w0, w1, w2);
+			__m128i d = LumaLanesSse2(_mm_loadu_si128(pixels + 3), w0, w1, w2);
+
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+			_mm_storeu_si128((__m128i*)(target + x), packed);
+		}
+
+		LumaRowScalar(source + size_t(x) * 4, target + x, width - x, bgra);
+	}
+
+	PREPROCESS_TARGET_AVX2
+	static inline __m256i LumaLanesAvx2(__m256i pixels, __m256i w0, __m256i w1, __m256i w2)
+	{
+		const __m256i mask = _mm256_set1_epi32(0xff);
+
+		__m256i c0 = _mm256_and_si256(pixels, mask);
+		__m256i c1 = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+		__m256i c2 = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+
+		__m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(c0, w0), _mm256_mullo_epi16(c1, w1)), _mm256_mullo_epi16(c2, w2));
+
+		return _mm256_srli_epi32(sum, 8);
+	}
+
+	PREPROCESS_TARGET_AVX2
+	static void LumaRowAvx2(const uint8_t* source, uint8_t* target, int width, bool bgra)
+	{
+		const __m256i w0 = _mm256_set1_epi32(bgra ? WeightBlue : WeightRed);
+		const __m256i w1 = _mm256_set1_epi32(WeightGreen);
+		const __m256i w2 = _mm256_set1_epi32(bgra ? WeightRed : WeightBlue);
+		// The packs work within 128-bit halves, this restores the pixel order
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		int x = 0;
+
+		for (; x + 32 <= width; x += 32)
+		{
+			const __m256i* pixels = (const __m256i*)(source + size_t(x) * 4);
+
+			__m256i a = LumaLanesAvx2(_mm256_loadu_si256(pixels + 0), w0, w1, w2);
+			__m256i b = LumaLanesAvx2(_mm256_loadu_si256(pixels + 1), w0, w1, w2);
+			__m256i c = LumaLanesAvx2(_mm256_loadu_si256(pixels + 2), w0, w1, w2);
+			__m256i d = LumaLanesAvx2(_mm256_loadu_si256(pixels + 3), w0, w1, w2);
+
+			__m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+			_mm256_storeu_si256((__m256i*)(target + x), _mm256_permutevar8x32_epi32(packed, order));
+		}
+
+		LumaRowSse2(source + size_t(x) * 4, target + x, width - x, bgra);
+	}
+#endif
+
+	static GrayImage ToLuma(const ImageView& image, Isa isa = GetIsa())
+	{
+		GrayImage gray;
+
+		if (image.pixels == nullptr || image.width <= 0 || image.height <= 0)
+		{
+			return gray;
+		}
+
+		gray.width = image.width;
+		gray.height = image.height;
+		gray.pixels.resize(size_t(image.width) * image.height);
+
+		for (int y = 0; y < image.height; y++)
+		{
+			switch (isa)
+			{
+#ifdef PREPROCESS_X86
+			case Isa::Avx2:
+				LumaRowAvx2(image.Row(y), gray.Row(y), image.width, image.bgra);
+				break;
+			case Isa::Sse2:
+				LumaRowSse2(image.Row(y), gray.Row(y), image.width, image.bgra);
+				break;
+#endif
+			default:
+				LumaRowScalar(image.Row(y), gray.Row(y), image.width, image.bgra);
+				break;
+			}
+		}
+
+		return gray;
+	}
+
+	// Box filter over factor x factor blocks, partial blocks at the right and bottom edges are dropped
+	static GrayImage Downscale(const GrayImage& image, int factor)
+	{
+		if (factor <= 1 || image.width < factor || image.height < factor)
+		{
+			return image;
+		}
+
+		GrayImage scaled;
+		scaled.width = image.width / factor;
+		scaled.height = image.height / factor;
+		scaled.pixels.resize(size_t(scaled.width) * scaled.height);
+
+		const uint32_t area = uint32_t(factor * factor);
+		std::vector<uint32_t> sums(scaled.width);
+
+		for (int y = 0; y < scaled.height; y++)
+		{
+			std::fill(sums.begin(), sums.end(), 0);
+
+			for (int row = 0; row < factor; row++)
+			{
+				const uint8_t* source = image.Row(y * factor + row);
+
+				for (int x = 0; x < scaled.width; x++)
+				{
+					for (int column = 0; column < factor; column++)
+					{
+						sums[x] += source[x * factor + column];
+					}
+				}
+			}
+
+			uint8_t* target = scaled.Row(y);
+
+			for (int x = 0; x < scaled.width; x++)
+			{
+				target[x] = uint8_t((sums[x] + area / 2) / area);
+			}
+		}
+
+		return scaled;
+	}
+
+	// Linear stretch of the 1st - 99th percentile. Nearly flat images are left alone,
+	// stretching them would only amplify noise.
+	static void NormalizeContrast(GrayImage* image)
+	{
+		size_t count = image->pixels.size();
+
+		if (count == 0)
+		{
+			return;
+		}
+
+		size_t histogram[256] = {};
+
+		for (uint8_t value : image->pixels)
+		{
+			histogram[value]++;
+		}
+
+		size_t clip = count / 100;
+		size_t accumulated = 0;
+		int low = 0;
+		int high = 255;
+
+		for (; low < 255; low++)
+		{
+			accumulated += histogram[low];
+
+			if (accumulated > clip)
+			{
+				break;
+			}
+		}
+
+		accumulated = 0;
+
+		for (; high > 0; high--)
+		{
+			accumulated += histogram[high];
+
+			if (accumulated > clip)
+			{
+				break;
+			}
+		}
+
+		if (high - low < 16)
+		{
+			return;
+		}
+
+		uint8_t table[256];
+
+		for (int value = 0; value < 256; value++)
+		{
+			int stretched = (value - low) * 255 / (high - low);
+			table[value] = uint8_t(std::min(255, std::max(0, stretched)));
+		}
+
+		for (uint8_t& value : image->pixels)
+		{
+			value = table[value];
+		}
+	}
+
+	// Factor that brings text of sourceTextHeight pixels closest to targetTextHeight without going below it
+	static int ChooseDownscale(int sourceTextHeight, int targetTextHeight)
+	{
+		if (sourceTextHeight <= 0 || targetTextHeight <= 0)
+		{
+			return 1;
+		}
+
+		return std::max(1, sourceTextHeight / targetTextHeight);
+	}
+
+	static GrayImage Run(const ImageView& image, const Options& options)
+	{
+		GrayImage gray = ToLuma(image);
+
+		if (options.downscale > 1)
+		{
+			gray = Downscale(gray, options.downscale);
+		}
+
+		if (options.normalizeContrast)
+		{
+			NormalizeContrast(&gray);
+		}
+
+		return gray;
+	}
+}
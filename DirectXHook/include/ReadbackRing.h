@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// GPU side of the readback ring. The renderer implements it with staging textures and event queries,
+// the ring itself only deals with slot indices so the scheduling stays independent of Direct3D.
+class IReadbackDevice
+{
+public:
+	virtual ~IReadbackDevice() {}
+
+	// Queues a copy of the current back buffer into the slot, must not block
+	virtual bool QueueCopy(int slot) = 0;
+	// True once the GPU finished the copy into the slot
+	virtual bool IsCopyFinished(int slot) = 0;
+	// Maps the slot and hands its pixels over, called only after IsCopyFinished returned true
+	virtual bool ReadSlot(int slot, uint64_t frame) = 0;
+};
+
+// What to do when every slot is waiting for the GPU
+enum class ReadbackDropPolicy
+{
+	// Ignore the new capture request
+	DropNewest,
+	// Forget the oldest pending copy and reuse its slot, the latest frame wins. Droppable copies go first.
+	DropOldest
+};
+
+// Ring of N readback slots: a copy queued on frame K is read on frame K + latency at the earliest,
+// by then the GPU has normally finished it and mapping does not stall the render thread.
+class ReadbackRing
+{
+public:
+	ReadbackRing(IReadbackDevice* device, int size, int latency, ReadbackDropPolicy dropPolicy)
+		: device(device), slots(size < 1 ? 1 : size), latency(latency < 0 ? 0 : latency), dropPolicy(dropPolicy)
+	{
+	}
+
+	// Requests a capture of the frame being presented, false when it was dropped. A droppable capture, one that is
+	// requested again on the next frame anyway, never takes the slot of a capture that is not, so a steady stream
+	// of them cannot push out a single one that was asked for.
+	bool Request(uint64_t frame, bool droppable = false)
+	{
+		int slot = FindFreeSlot();
+
+		if (slot < 0)
+		{
+			auto evicted = dropPolicy == ReadbackDropPolicy::DropOldest ? FindEvictable(droppable) : pending.end();
+
+			if (evicted == pending.end())
+			{
+				dropped++;
+				return false;
+			}
+
+			slot = *evicted;
+			pending.erase(evicted);
+			slots[slot].busy = false;
+			dropped++;
+		}
+
+		if (!device->QueueCopy(slot))
+		{
+			return false;
+		}
+
+		slots[slot].busy = true;
+		slots[slot].droppable = droppable;
+		slots[slot].frame = frame;
+		pending.push_back(slot);
+
+		return true;
+	}
+
+	// Called once per presented frame, reads every slot that is old enough and finished, oldest first.
+	// Returns the number of slots read.
+	int Poll(uint64_t frame)
+	{
+		int read = 0;
+
+		while (!pending.empty())
+		{
+			int slot = pending.front();
+
+			if (frame - slots[slot].frame < uint64_t(latency) || !device->IsCopyFinished(slot))
+			{
+				break;
+			}
+
+			pending.pop_front();
+			slots[slot].busy = false;
+
+			if (device->ReadSlot(slot, slots[slot].frame))
+			{
+				read++;
+			}
+		}
+
+		return read;
+	}
+
+	// Forgets every pending copy, used when the swap chain is resized
+	void Reset()
+	{
+		for (int slot : pending)
+		{
+			slots[slot].busy = false;
+		}
+
+		pending.clear();
+	}
+
+	size_t GetPendingCount() const
+	{
+		return pending.size();
+	}
+
+	uint64_t GetDroppedCount() const
+	{
+		return dropped;
+	}
+
+private:
+	struct Slot
+	{
+		bool busy = false;
+		bool droppable = false;
+		uint64_t frame = 0;
+	};
+
+	IReadbackDevice* device;
+	std::vector<Slot> slots;
+	std::deque<int> pending;
+	int latency;
+	ReadbackDropPolicy dropPolicy;
+	uint64_t dropped = 0;
+
+	int FindFreeSlot() const
+	{
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			if (!slots[i].busy)
+			{
+				return int(i);
+			}
+		}
+
+		return -1;
+	}
+
+	// The oldest pending copy the request may replace, a droppable one first
+	std::deque<int>::iterator FindEvictable(bool droppable)
+	{
+		for (auto it = pending.begin(); it != pending.end(); ++it)
+		{
+			if (slots[*it].droppable)
+			{
+				return it;
+			}
+		}
+
+		return droppable ? pending.end() : pending.begin();
+	}
+};
@@ -24,6 +24,9 @@
 #include "TranslateClient.h"
 #include "Logger.h"
 #include "OverlayFramework.h"
+#include "CapturePipeline.h"
+#include "ReadbackRing.h"
+#include "D3D11Readback.h"
 
 // D3D11 renderer with support for D3D12 using D3D11On12
 class Renderer : public ID3DRenderer
@@ -126,10 +129,20 @@ private:
 	bool CheckSuccess(HRESULT hr);
 
 	bool showTranslations = false;
+	bool autoTranslate = AutoTranslateOnStart;
+	bool subtitleMode = SubtitleModeOnStart;
 	bool showInProgress = false;
 	bool cleanNeeded = false;
+	uint64_t frameCount = 0;
+
+	CapturePipeline capturePipeline;
+	D3D11ReadbackDevice readbackDevice;
+	std::unique_ptr<ReadbackRing> readbackRing = nullptr;
+	// Font the published layouts were built with
+	const void* layoutFont = nullptr;
 
 	void Init();
 	void Tick();
-	bool CreateScreenshot(Blob* blob);
+	bool RequestScreenshot(CaptureKind kind = CaptureKind::Manual);
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> GetBackBufferTexture();
 };
\ No newline at end of file
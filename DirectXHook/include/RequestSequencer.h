@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "CaptureKind.h"
+#include "Transport.h"
+
+// Requests are numbered in the order they are created. A response is only shown when its request is newer than
+// the one the shown entries of its kind came from, so a slow response can never overwrite a newer one.
+// Kinds are kept apart, a settled subtitle does not make a scan of the whole frame outdated.
+// What is shown is not synchronized here, the client changes it under its mutex along with the entries.
+class RequestSequencer
+{
+public:
+	// Called by the capture pipeline only, so the sequences of a kind increase
+	uint64_t Next(CaptureKind kind)
+	{
+		uint64_t sequence = ++latest;
+		latestOfKind[int(kind)] = sequence;
+
+		return sequence;
+	}
+
+	// True once a newer request of the same kind was created, its response would be outdated on arrival
+	bool IsSuperseded(uint64_t sequence, CaptureKind kind) const
+	{
+		return sequence < latestOfKind[int(kind)];
+	}
+
+	// True when the response to sequence is newer than what is shown of its kind
+	bool IsNewerThanShown(uint64_t sequence, CaptureKind kind) const
+	{
+		return sequence > shown[int(kind)];
+	}
+
+	// Records that the response to sequence is shown, false when it is not newer and has to be discarded
+	bool Show(uint64_t sequence, CaptureKind kind)
+	{
+		if (!IsNewerThanShown(sequence, kind))
+		{
+			return false;
+		}
+
+		shown[int(kind)] = sequence;
+
+		return true;
+	}
+
+	uint64_t GetShown(CaptureKind kind) const
+	{
+		return shown[int(kind)];
+	}
+
+	// The shown entries were cleared, responses to every request created so far are stale
+	void Clear()
+	{
+		for (uint64_t& sequence : shown)
+		{
+			sequence = latest;
+		}
+	}
+
+private:
+	std::atomic<uint64_t> latest = 0;
+	std::atomic<uint64_t> latestOfKind[CaptureKindCount] = {};
+	uint64_t shown[CaptureKindCount] = {};
+};
+
+// Requests waiting for a single sender thread, where the latest request of a kind wins. Posting one drops the
+// waiting requests of its kind and, with cancelInFlight, cancels the one being sent when it is older and of that
+// kind too, so a burst of scans never queues up behind a slow server. Request needs a sequence and a kind.
+template <typename Request>
+class LatestRequestQueue
+{
+public:
+	LatestRequestQueue(ITransport* transport, bool cancelInFlight)
+		: transport(transport), cancelInFlight(cancelInFlight)
+	{
+	}
+
+	// Queues the request, returns the number of older requests of its kind that were dropped or cancelled
+	int Post(std::unique_ptr<Request> request)
+	{
+		int superseded = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			for (auto waiting = queue.begin(); waiting != queue.end();)
+			{
+				if ((*waiting)->kind != request->kind)
+				{
+					++waiting;
+					continue;
+				}
+
+				waiting = queue.erase(waiting);
+				superseded++;
+			}
+
+			if (cancelInFlight && inFlightSequence != 0 && inFlightKind == request->kind && inFlightSequence < request->sequence)
+			{
+				transport->Cancel();
+				superseded++;
+			}
+
+			queue.push_back(std::move(request));
+		}
+
+		wakeUp.notify_one();
+
+		return superseded;
+	}
+
+	// Called by the sender, waits for the next request and marks it as being sent
+	std::unique_ptr<Request> Take()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeUp.wait(lock, [this] { return !queue.empty(); });
+
+		std::unique_ptr<Request> request = std::move(queue.front());
+		queue.pop_front();
+		inFlightSequence = request->sequence;
+		inFlightKind = request->kind;
+		// A Cancel from Post sticks from here on, also when it comes before the request is sent
+		transport->BeginAttempt();
+
+		return request;
+	}
+
+	// Called by the sender once the request from Take was sent, true when no other request is waiting
+	bool Finish()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		inFlightSequence = 0;
+
+		return queue.empty();
+	}
+
+	// Requests waiting or being sent
+	int GetPendingCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return int(queue.size()) + (inFlightSequence != 0 ? 1 : 0);
+	}
+
+private:
+	ITransport* transport;
+	bool cancelInFlight;
+
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::deque<std::unique_ptr<Request>> queue;
+	uint64_t inFlightSequence = 0;
+	CaptureKind inFlightKind = CaptureKind::Manual;
+};
@@ -0,0 +1,692 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "TranslationEntry.h"
+#include "ResultCodec.h"
+
+// Incremental parser for the JSON response of the server, an array of flat objects with the keys
+// x, y, w, h, message and translation. Chunks are fed as they come off the connection and every entry
+// is emitted as soon as its closing brace was read, no document is built. Unknown keys are skipped.
+// Binary results (ResultCodec) are recognized by their magic and every record is emitted once it arrived.
+// Records are decoded straight from the chunk, only one split across chunks is buffered. Their text is copied
+// once into the entry, which outlives the receive buffer.
+class ResponseParser
+{
+public:
+	// Consumes the next chunk, completed entries are appended to target. False once the input is malformed.
+	bool Feed(const char* data, size_t size, std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		if (!started && size > 0 && data[0] == ResultCodec::Magic[0])
+		{
+			isBinary = true;
+		}
+
+		if (isBinary)
+		{
+			started = true;
+			FeedBinary((const uint8_t*)data, size, target);
+
+			return !failed;
+		}
+
+		for (size_t i = 0; i < size && !failed; i++)
+		{
+			Consume(data[i], target);
+		}
+
+		return !failed;
+	}
+
+	// Called after the last chunk. An empty body counts as an empty array.
+	bool Finish(std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		// Whitespace ends a number or literal still waiting for its delimiter
+		if (!isBinary)
+		{
+			Consume(' ', target);
+		}
+
+		return !failed && (complete || !started);
+	}
+
+	bool IsComplete() const
+	{
+		return complete;
+	}
+
+	bool HasFailed() const
+	{
+		return failed;
+	}
+
+private:
+	enum class Lexer
+	{
+		Idle,
+		String,
+		Escape,
+		Unicode,
+		Number,
+		Literal
+	};
+
+	// What may come next inside a skipped value
+	enum class Skip
+	{
+		ValueOrEnd,
+		Value,
+		KeyOrEnd,
+		Key,
+		Colon,
+		CommaOrEnd
+	};
+
+	enum Field
+	{
+		FieldX = 1 << 0,
+		FieldY = 1 << 1,
+		FieldW = 1 << 2,
+		FieldH = 1 << 3,
+		FieldMessage = 1 << 4,
+		FieldTranslation = 1 << 5,
+		AllFields = (1 << 6) - 1
+	};
+
+	Lexer lexer = Lexer::Idle;
+	std::string token;
+	uint32_t codePoint = 0;
+	uint32_t highSurrogate = 0;
+	int unicodeDigits = 0;
+
+	// 0 outside the response, 1 inside the array, 2 inside an entry
+	int depth = 0;
+	// Open objects and arrays of a value of an unknown key that is being skipped. Skipped values are not kept
+	// but still checked, a stray comma or colon fails the response as it would anywhere else.
+	std::vector<char> skipStack;
+	Skip skip = Skip::Value;
+	bool expectKey = false;
+	bool expectColon = false;
+	bool expectValue = false;
+	bool started = false;
+	bool complete = false;
+	bool failed = false;
+	// Inside the array: an entry was read and no comma followed yet, a comma was read and no entry followed yet
+	bool afterElement = false;
+	bool afterComma = false;
+
+	bool isBinary = false;
+	bool headerRead = false;
+	uint32_t recordsLeft = 0;
+	uint64_t bytesLeft = 0;
+	// The header or a record split across chunks
+	std::vector<uint8_t> partial;
+
+	std::string key;
+	TranslateClient::TranslationEntry entry = {};
+	int seenFields = 0;
+
+	void FeedBinary(const uint8_t* data, size_t size, std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		while (size > 0 && !failed)
+		{
+			if (complete)
+			{
+				failed = true;
+				return;
+			}
+
+			if (!headerRead)
+			{
+				size_t take = std::min(size, ResultCodec::HeaderSize - partial.size());
+
+				partial.insert(partial.end(), data, data + take);
+				data += take;
+				size -= take;
+
+				if (partial.size() == ResultCodec::HeaderSize)
+				{
+					ReadBinaryHeader();
+				}
+
+				continue;
+			}
+
+			// A whole record in the chunk is decoded in place
+			if (partial.empty() && size >= ResultCodec::RecordHeaderSize && size >= ResultCodec::GetRecordSize(data))
+			{
+				size_t recordSize = size_t(ResultCodec::GetRecordSize(data));
+
+				EmitRecord(data, recordSize, target);
+				data += recordSize;
+				size -= recordSize;
+
+				continue;
+			}
+
+			uint64_t needed = partial.size() < ResultCodec::RecordHeaderSize
+				? ResultCodec::RecordHeaderSize
+				: ResultCodec::GetRecordSize(partial.data());
+
+			if (needed > bytesLeft)
+			{
+				failed = true;
+				return;
+			}
+
+			size_t take = size_t(std::min<uint64_t>(size, needed - partial.size()));
+
+			partial.insert(partial.end(), data, data + take);
+			data += take;
+			size -= take;
+
+			if (partial.size() >= ResultCodec::RecordHeaderSize && partial.size() == ResultCodec::GetRecordSize(partial.data()))
+			{
+				EmitRecord(partial.data(), partial.size(), target);
+				partial.clear();
+			}
+		}
+	}
+
+	void ReadBinaryHeader()
+	{
+		uint32_t recordsSize = 0;
+
+		if (!ResultCodec::ReadHeader(partial.data(), &recordsLeft, &recordsSize))
+		{
+			failed = true;
+			return;
+		}
+
+		headerRead = true;
+		bytesLeft = recordsSize;
+		partial.clear();
+		CheckBinaryEnd();
+	}
+
+	void EmitRecord(const uint8_t* record, size_t recordSize, std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		if (recordsLeft == 0 || recordSize > bytesLeft)
+		{
+			failed = true;
+			return;
+		}
+
+		ResultCodec::EntryView source = ResultCodec::ReadRecord(record);
+		TranslateClient::TranslationEntry decoded;
+
+		decoded.x = source.x;
+		decoded.y = source.y;
+		decoded.w = source.w;
+		decoded.h = source.h;
+		decoded.message = std::string(source.message);
+		decoded.translation = std::string(source.translation);
+
+		target->push_back(std::move(decoded));
+
+		recordsLeft--;
+		bytesLeft -= recordSize;
+		CheckBinaryEnd();
+	}
+
+	// Complete after the last record, which has to end exactly where the header said
+	void CheckBinaryEnd()
+	{
+		if (recordsLeft == 0)
+		{
+			complete = bytesLeft == 0;
+			failed = bytesLeft != 0;
+		}
+	}
+
+	void Consume(char c, std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		switch (lexer)
+		{
+		case Lexer::String:
+			if (c == '"')
+			{
+				lexer = Lexer::Idle;
+				OnString();
+			}
+			else if (c == '\\')
+			{
+				lexer = Lexer::Escape;
+			}
+			else if (uint8_t(c) < 0x20)
+			{
+				failed = true;
+			}
+			else
+			{
+				token.push_back(c);
+			}
+			return;
+		case Lexer::Escape:
+			OnEscape(c);
+			return;
+		case Lexer::Unicode:
+			OnUnicodeDigit(c);
+			return;
+		case Lexer::Number:
+			if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')
+			{
+				token.push_back(c);
+				return;
+			}
+
+			lexer = Lexer::Idle;
+			OnNumber();
+			break;
+		case Lexer::Literal:
+			if (c >= 'a' && c <= 'z')
+			{
+				token.push_back(c);
+				return;
+			}
+
+			lexer = Lexer::Idle;
+			OnLiteral();
+			break;
+		default:
+			break;
+		}
+
+		if (failed || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			return;
+		}
+
+		started = true;
+		token.clear();
+
+		if (c == '"')
+		{
+			lexer = Lexer::String;
+		}
+		else if (c == '-' || (c >= '0' && c <= '9'))
+		{
+			lexer = Lexer::Number;
+			token.push_back(c);
+		}
+		else if (c >= 'a' && c <= 'z')
+		{
+			lexer = Lexer::Literal;
+			token.push_back(c);
+		}
+		else
+		{
+			OnStructural(c, target);
+		}
+	}
+
+	void OnEscape(char c)
+	{
+		lexer = Lexer::String;
+
+		switch (c)
+		{
+		case '"': token.push_back('"'); break;
+		case '\\': token.push_back('\\'); break;
+		case '/': token.push_back('/'); break;
+		case 'b': token.push_back('\b'); break;
+		case 'f': token.push_back('\f'); break;
+		case 'n': token.push_back('\n'); break;
+		case 'r': token.push_back('\r'); break;
+		case 't': token.push_back('\t'); break;
+		case 'u':
+			lexer = Lexer::Unicode;
+			codePoint = 0;
+			unicodeDigits = 0;
+			break;
+		default:
+			failed = true;
+			break;
+		}
+	}
+
+	void OnUnicodeDigit(char c)
+	{
+		uint32_t value;
+
+		if (c >= '0' && c <= '9') value = c - '0';
+		else if (c >= 'a' && c <= 'f') value = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F') value = c - 'A' + 10;
+		else
+		{
+			failed = true;
+			return;
+		}
+
+		codePoint = codePoint << 4 | value;
+
+		if (++unicodeDigits == 4)
+		{
+			lexer = Lexer::String;
+			AppendCodePoint(codePoint);
+		}
+	}
+
+	// Python's json.dumps escapes everything outside ASCII, characters beyond the BMP arrive as surrogate pairs
+	void AppendCodePoint(uint32_t value)
+	{
+		if (value >= 0xd800 && value < 0xdc00)
+		{
+			highSurrogate = value;
+			return;
+		}
+
+		if (value >= 0xdc00 && value < 0xe000)
+		{
+			value = highSurrogate != 0 ? 0x10000 + ((highSurrogate - 0xd800) << 10) + (value - 0xdc00) : 0xfffd;
+		}
+		else if (highSurrogate != 0)
+		{
+			AppendUtf8(0xfffd);
+		}
+
+		highSurrogate = 0;
+		AppendUtf8(value);
+	}
+
+	void AppendUtf8(uint32_t value)
+	{
+		if (value < 0x80)
+		{
+			token.push_back(char(value));
+		}
+		else if (value < 0x800)
+		{
+			token.push_back(char(0xc0 | value >> 6));
+			token.push_back(char(0x80 | (value & 0x3f)));
+		}
+		else if (value < 0x10000)
+		{
+			token.push_back(char(0xe0 | value >> 12));
+			token.push_back(char(0x80 | (value >> 6 & 0x3f)));
+			token.push_back(char(0x80 | (value & 0x3f)));
+		}
+		else
+		{
+			token.push_back(char(0xf0 | value >> 18));
+			token.push_back(char(0x80 | (value >> 12 & 0x3f)));
+			token.push_back(char(0x80 | (value >> 6 & 0x3f)));
+			token.push_back(char(0x80 | (value & 0x3f)));
+		}
+	}
+
+	void OnStructural(char c, std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		if (!skipStack.empty())
+		{
+			OnSkippedStructural(c);
+			return;
+		}
+
+		if (complete)
+		{
+			failed = true;
+			return;
+		}
+
+		switch (depth)
+		{
+		case 0:
+			failed = c != '[';
+			depth = 1;
+			break;
+		case 1:
+			if (c == '{' && !afterElement)
+			{
+				depth = 2;
+				afterComma = false;
+				entry = {};
+				seenFields = 0;
+				expectKey = true;
+				expectColon = false;
+				expectValue = false;
+			}
+			else if (c == ']' && !afterComma)
+			{
+				depth = 0;
+				complete = true;
+			}
+			else if (c == ',' && afterElement)
+			{
+				afterElement = false;
+				afterComma = true;
+			}
+			else
+			{
+				failed = true;
+			}
+			break;
+		default:
+			if (c == ':' && expectColon)
+			{
+				expectColon = false;
+				expectValue = true;
+			}
+			else if (c == ',' && !expectKey && !expectColon && !expectValue)
+			{
+				expectKey = true;
+				afterComma = true;
+			}
+			else if (c == '}' && !(expectKey && afterComma) && !expectColon && !expectValue)
+			{
+				depth = 1;
+				afterElement = true;
+				afterComma = false;
+				EmitEntry(target);
+			}
+			else if ((c == '{' || c == '[') && expectValue)
+			{
+				skipStack.push_back(c);
+				skip = c == '{' ? Skip::KeyOrEnd : Skip::ValueOrEnd;
+			}
+			else
+			{
+				failed = true;
+			}
+			break;
+		}
+	}
+
+	void OnSkippedStructural(char c)
+	{
+		char open = skipStack.back();
+
+		if ((c == '{' || c == '[') && (skip == Skip::Value || skip == Skip::ValueOrEnd))
+		{
+			skipStack.push_back(c);
+			skip = c == '{' ? Skip::KeyOrEnd : Skip::ValueOrEnd;
+		}
+		else if (c == '}' && open == '{' && (skip == Skip::CommaOrEnd || skip == Skip::KeyOrEnd))
+		{
+			EndSkippedContainer();
+		}
+		else if (c == ']' && open == '[' && (skip == Skip::CommaOrEnd || skip == Skip::ValueOrEnd))
+		{
+			EndSkippedContainer();
+		}
+		else if (c == ',' && skip == Skip::CommaOrEnd)
+		{
+			skip = open == '{' ? Skip::Key : Skip::Value;
+		}
+		else if (c == ':' && skip == Skip::Colon)
+		{
+			skip = Skip::Value;
+		}
+		else
+		{
+			failed = true;
+		}
+	}
+
+	void EndSkippedContainer()
+	{
+		skipStack.pop_back();
+		skip = Skip::CommaOrEnd;
+
+		if (skipStack.empty())
+		{
+			expectValue = false;
+		}
+	}
+
+	// A string, number or literal inside a skipped value
+	void OnSkippedScalar(bool isString)
+	{
+		if (isString && (skip == Skip::Key || skip == Skip::KeyOrEnd))
+		{
+			skip = Skip::Colon;
+		}
+		else if (skip == Skip::Value || skip == Skip::ValueOrEnd)
+		{
+			skip = Skip::CommaOrEnd;
+		}
+		else
+		{
+			failed = true;
+		}
+	}
+
+	void OnString()
+	{
+		if (!skipStack.empty())
+		{
+			OnSkippedScalar(true);
+			return;
+		}
+
+		if (depth != 2)
+		{
+			failed = true;
+		}
+		else if (expectKey)
+		{
+			key = token;
+			expectKey = false;
+			afterComma = false;
+			expectColon = true;
+		}
+		else if (expectValue)
+		{
+			expectValue = false;
+
+			if (key == "message")
+			{
+				entry.message = token;
+				seenFields |= FieldMessage;
+			}
+			else if (key == "translation")
+			{
+				entry.translation = token;
+				seenFields |= FieldTranslation;
+			}
+		}
+		else
+		{
+			failed = true;
+		}
+	}
+
+	void OnNumber()
+	{
+		char* end = nullptr;
+		double value = strtod(token.c_str(), &end);
+
+		if (end != token.c_str() + token.size())
+		{
+			failed = true;
+			return;
+		}
+
+		if (!skipStack.empty())
+		{
+			OnSkippedScalar(false);
+			return;
+		}
+
+		if (depth != 2 || !expectValue)
+		{
+			failed = true;
+			return;
+		}
+
+		expectValue = false;
+
+		// Converting a double that does not fit is undefined, an out of range or infinite value fails the response
+		bool isCoordinate = key == "x" || key == "y";
+		bool isSize = key == "w" || key == "h";
+
+		if ((isCoordinate && !(value >= double(INT_MIN) && value <= double(INT_MAX))) ||
+			(isSize && !(value >= -double(FLT_MAX) && value <= double(FLT_MAX))))
+		{
+			failed = true;
+			return;
+		}
+
+		if (key == "x")
+		{
+			entry.x = int(value);
+			seenFields |= FieldX;
+		}
+		else if (key == "y")
+		{
+			entry.y = int(value);
+			seenFields |= FieldY;
+		}
+		else if (key == "w")
+		{
+			entry.w = float(value);
+			seenFields |= FieldW;
+		}
+		else if (key == "h")
+		{
+			entry.h = float(value);
+			seenFields |= FieldH;
+		}
+	}
+
+	void OnLiteral()
+	{
+		if (token != "true" && token != "false" && token != "null")
+		{
+			failed = true;
+			return;
+		}
+
+		if (!skipStack.empty())
+		{
+			OnSkippedScalar(false);
+			return;
+		}
+
+		if (depth != 2 || !expectValue)
+		{
+			failed = true;
+			return;
+		}
+
+		expectValue = false;
+	}
+
+	void EmitEntry(std::vector<TranslateClient::TranslationEntry>* target)
+	{
+		// Same contract as the DOM parser had, an entry missing a field fails the whole response
+		if (seenFields != AllFields)
+		{
+			failed = true;
+			return;
+		}
+
+		target->push_back(std::move(entry));
+	}
+};
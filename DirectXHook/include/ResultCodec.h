@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "TranslationEntry.h"
+
+// Binary form of a server response, requested with the Accept header when PreferBinaryResults is set.
+// All integers are little endian:
+//   header   magic "IGTR", u16 version, u16 flags (0), u32 entry count, u32 size of the records
+//   records  i32 x, i32 y, f32 w, f32 h, u32 message size, u32 translation size,
+//            followed by the UTF-8 message and translation
+// Every record carries its own text, so a reader can hand out an entry as soon as its record arrived.
+// The header declares the total size, so a reader knows when the response is complete.
+namespace ResultCodec
+{
+	static constexpr char Magic[4] = { 'I', 'G', 'T', 'R' };
+	static constexpr uint16_t Version = 2;
+	static constexpr size_t HeaderSize = 16;
+	// Fixed part of a record, the text follows it
+	static constexpr size_t RecordHeaderSize = 24;
+	static constexpr const char* ContentType = "application/x-igt-results";
+
+	static inline uint32_t ReadU32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+	}
+
+	static inline float ReadF32(const uint8_t* data)
+	{
+		uint32_t bits = ReadU32(data);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	static inline void WriteU32(std::vector<uint8_t>* out, uint32_t value)
+	{
+		out->push_back(uint8_t(value));
+		out->push_back(uint8_t(value >> 8));
+		out->push_back(uint8_t(value >> 16));
+		out->push_back(uint8_t(value >> 24));
+	}
+
+	static inline void WriteF32(std::vector<uint8_t>* out, float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		WriteU32(out, bits);
+	}
+
+	// Reads the HeaderSize bytes of the header, false when the data is not a supported result
+	static bool ReadHeader(const uint8_t* data, uint32_t* count, uint32_t* recordsSize)
+	{
+		if (memcmp(data, Magic, sizeof(Magic)) != 0 || (data[4] | data[5] << 8) != Version)
+		{
+			return false;
+		}
+
+		*count = ReadU32(data + 8);
+		*recordsSize = ReadU32(data + 12);
+
+		return true;
+	}
+
+	// Size of the record starting with the RecordHeaderSize bytes given, text included
+	static uint64_t GetRecordSize(const uint8_t* record)
+	{
+		return RecordHeaderSize + uint64_t(ReadU32(record + 16)) + ReadU32(record + 20);
+	}
+
+	// An entry pointing into the encoded buffer, nothing is copied
+	struct EntryView
+	{
+		int32_t x = 0;
+		int32_t y = 0;
+		float w = 0.0f;
+		float h = 0.0f;
+		std::string_view message;
+		std::string_view translation;
+	};
+
+	// Views of a complete record of GetRecordSize bytes, only valid while its buffer is
+	static EntryView ReadRecord(const uint8_t* record)
+	{
+		EntryView view;
+		uint32_t messageSize = ReadU32(record + 16);
+
+		view.x = int32_t(ReadU32(record));
+		view.y = int32_t(ReadU32(record + 4));
+		view.w = ReadF32(record + 8);
+		view.h = ReadF32(record + 12);
+		view.message = std::string_view((const char*)record + RecordHeaderSize, messageSize);
+		view.translation = std::string_view((const char*)record + RecordHeaderSize + messageSize, ReadU32(record + 20));
+
+		return view;
+	}
+
+	static void Encode(const std::vector<TranslateClient::TranslationEntry>& entries, std::vector<uint8_t>* out)
+	{
+		out->clear();
+		out->insert(out->end(), Magic, Magic + sizeof(Magic));
+		out->push_back(uint8_t(Version));
+		out->push_back(uint8_t(Version >> 8));
+		out->push_back(0);
+		out->push_back(0);
+		WriteU32(out, uint32_t(entries.size()));
+		WriteU32(out, 0);
+
+		for (const TranslateClient::TranslationEntry& entry : entries)
+		{
+			WriteU32(out, uint32_t(entry.x));
+			WriteU32(out, uint32_t(entry.y));
+			WriteF32(out, entry.w);
+			WriteF32(out, entry.h);
+			WriteU32(out, uint32_t(entry.message.size()));
+			WriteU32(out, uint32_t(entry.translation.size()));
+			out->insert(out->end(), entry.message.begin(), entry.message.end());
+			out->insert(out->end(), entry.translation.begin(), entry.translation.end());
+		}
+
+		uint32_t recordsSize = uint32_t(out->size() - HeaderSize);
+
+		for (int i = 0; i < 4; i++)
+		{
+			(*out)[12 + i] = uint8_t(recordsSize >> (8 * i));
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Named memory other processes can map, a pagefile backed file mapping on Windows and POSIX shared memory
+// elsewhere (/dev/shm/<name> on Linux). The creator owns it, the name is removed again on Close.
+class SharedMemory
+{
+public:
+	SharedMemory() = default;
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+
+	~SharedMemory()
+	{
+		Close();
+	}
+
+	// A name no other running process uses, counter tells apart the memories of this process
+	static std::string GetUniqueName(const char* prefix, int counter)
+	{
+#ifdef _WIN32
+		unsigned long processId = GetCurrentProcessId();
+#else
+		unsigned long processId = (unsigned long)getpid();
+#endif
+
+		return std::string(prefix) + "-" + std::to_string(processId) + "-" + std::to_string(counter);
+	}
+
+	bool Create(const std::string& name, size_t size)
+	{
+		Close();
+
+#ifdef _WIN32
+		mapping = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			NULL,
+			PAGE_READWRITE,
+			DWORD(uint64_t(size) >> 32),
+			DWORD(size),
+			name.c_str());
+
+		if (mapping == NULL || GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			Close();
+			return false;
+		}
+
+		data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+		file = shm_open(("/" + name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+		if (file < 0)
+		{
+			return false;
+		}
+
+		linkedName = "/" + name;
+
+		if (ftruncate(file, off_t(size)) == 0)
+		{
+			void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			data = view == MAP_FAILED ? nullptr : (uint8_t*)view;
+		}
+#endif
+
+		if (data == nullptr)
+		{
+			Close();
+			return false;
+		}
+
+		this->name = name;
+		this->size = size;
+
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		if (mapping != NULL)
+		{
+			CloseHandle(mapping);
+			mapping = NULL;
+		}
+#else
+		if (data != nullptr)
+		{
+			munmap(data, size);
+		}
+
+		if (file >= 0)
+		{
+			close(file);
+			file = -1;
+		}
+
+		if (!linkedName.empty())
+		{
+			shm_unlink(linkedName.c_str());
+			linkedName.clear();
+		}
+#endif
+
+		data = nullptr;
+		size = 0;
+		name.clear();
+	}
+
+	uint8_t* GetData() const
+	{
+		return data;
+	}
+
+	size_t GetSize() const
+	{
+		return size;
+	}
+
+	const std::string& GetName() const
+	{
+		return name;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE mapping = NULL;
+#else
+	int file = -1;
+	std::string linkedName;
+#endif
+	uint8_t* data = nullptr;
+	size_t size = 0;
+	std::string name;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "FrameRing.h"
+#include "Logger.h"
+#include "SharedMemory.h"
+#include "Transport.h"
+
+// For a server on the same machine: the body of a large request is written into a FrameRing in shared memory
+// and the request sent through the wrapped transport only says where it is, with the X-Shm-* headers.
+// Responses come back through the wrapped transport as before, they are small and stream in as the server
+// writes them. Bodies that do not fit a slot, or all of them when the memory cannot be created, are sent
+// as usual. Owned by a single thread like the wrapped transport, only Cancel may be called from others.
+class SharedMemoryTransport : public ITransport
+{
+public:
+	SharedMemoryTransport(std::unique_ptr<ITransport> control, int slotCount, size_t slotBytes, size_t minBytes)
+		: control(std::move(control)), slotCount(slotCount), slotBytes(slotBytes), minBytes(minBytes)
+	{
+	}
+
+	bool Send(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink) override
+	{
+		FrameRing::Frame frame;
+
+		if (dataSize < minBytes || !Open() || !ring->Write(data, dataSize, &frame))
+		{
+			return control->Send(verb, path, headers, data, dataSize, sink);
+		}
+
+		std::wstring frameHeaders = headers;
+
+		frameHeaders += headers.empty() ? L"" : L"\r\n";
+		frameHeaders += L"X-Shm-Name: " + std::wstring(memory.GetName().begin(), memory.GetName().end());
+		frameHeaders += L"\r\nX-Shm-Bytes: " + std::to_wstring(memory.GetSize());
+		frameHeaders += L"\r\nX-Shm-Slot: " + std::to_wstring(frame.slot);
+		frameHeaders += L"\r\nX-Shm-Sequence: " + std::to_wstring(frame.sequence);
+
+		return control->Send(verb, path, frameHeaders, nullptr, 0, sink);
+	}
+
+	void BeginAttempt() override
+	{
+		control->BeginAttempt();
+	}
+
+	void Cancel() override
+	{
+		control->Cancel();
+	}
+
+	void Close() override
+	{
+		control->Close();
+	}
+
+private:
+	Logger logger{ "SharedMemoryTransport" };
+	std::unique_ptr<ITransport> control;
+	int slotCount;
+	size_t slotBytes;
+	size_t minBytes;
+	SharedMemory memory;
+	std::unique_ptr<FrameRing> ring;
+	bool failed = false;
+
+	// Creates the memory on the first large request, once
+	bool Open()
+	{
+		static std::atomic<int> counter = 0;
+
+		if (ring || failed)
+		{
+			return !failed;
+		}
+
+		std::string name = SharedMemory::GetUniqueName("InGameTranslator", counter++);
+
+		if (!memory.Create(name, FrameRing::GetMappingSize(slotCount, slotBytes)))
+		{
+			logger.Log("Failed to create shared memory %s, sending frames over the connection", name.c_str());
+			failed = true;
+			return false;
+		}
+
+		ring = std::make_unique<FrameRing>(memory.GetData(), slotCount, slotBytes);
+
+		return true;
+	}
+};
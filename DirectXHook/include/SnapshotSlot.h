@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Latest published value for a reader that must not wait on the writers, the render thread. Values are
+// immutable once published: a writer builds a new one and swaps it in as a whole, a reader keeps the one it
+// acquired alive through its reference for as long as it uses it. Nothing is copied on either side.
+// T needs a uint64_t generation, it is numbered here so a reader can tell whether anything changed.
+template <typename T>
+class SnapshotSlot
+{
+public:
+	SnapshotSlot()
+		: current(std::make_shared<const T>())
+	{
+	}
+
+	// Writers have to be serialized by the caller, so generations are published in order
+	void Publish(std::shared_ptr<T> next)
+	{
+		next->generation = ++generation;
+		std::atomic_store(&current, std::shared_ptr<const T>(std::move(next)));
+	}
+
+	// Safe from any thread at any time, one reference count increment
+	std::shared_ptr<const T> Acquire() const
+	{
+		return std::atomic_load(&current);
+	}
+
+	// Generation of the last published value, only for the writers
+	uint64_t GetGeneration() const
+	{
+		return generation;
+	}
+
+private:
+	std::shared_ptr<const T> current;
+	uint64_t generation = 0;
+};
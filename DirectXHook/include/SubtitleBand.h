@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "FrameDiff.h"
+#include "ImageView.h"
+#include "TileCache.h"
+
+// Where the dialogue of the game is looked for
+enum class SubtitleBandMode
+{
+	// Between SubtitleBandTop and SubtitleBandBottom of the screen
+	Fixed,
+	// Found by SubtitleBandDetector in the lower half of the screen
+	Auto
+};
+
+namespace SubtitleBand
+{
+	// Band across the whole width between two fractions of the screen height
+	static ImageRect FromFractions(int width, int height, float top, float bottom)
+	{
+		int y = std::max(0, std::min(height, int(top * height)));
+		int bottomY = std::max(y, std::min(height, int(bottom * height)));
+
+		return { 0, y, width, bottomY - y };
+	}
+}
+
+// Finds the subtitle band from full frames: rows in the lower half of the screen that hold text and change
+// between frames vote, the band is the run of rows with the most votes once it got enough of them.
+// Text that stays (HUD, menus) does not vote, so it does not pull the band away from the dialogue.
+class SubtitleBandDetector
+{
+public:
+	static constexpr int MinVotes = 3;
+
+	void Feed(const GrayImage& frame)
+	{
+		if (frame.width != width || frame.height != height)
+		{
+			width = frame.width;
+			height = frame.height;
+			votes.assign(height, 0);
+			previous.clear();
+			found = false;
+		}
+
+		if (width < 2)
+		{
+			return;
+		}
+
+		const uint32_t threshold = uint32_t(TileHashing::MinRowEnergy * std::min(width - 1, TileHashing::MinLineWidth));
+		Preprocess::Isa isa = Preprocess::GetIsa();
+		int top = height / 2;
+		bool fed = !previous.empty();
+
+		previous.resize(size_t(width) * (height - top));
+
+		for (int y = top; y < height; y++)
+		{
+			const uint8_t* row = frame.Row(y);
+			uint8_t* last = &previous[size_t(width) * (y - top)];
+
+			if (fed && TileHashing::RowEnergy(row, width, isa) >= threshold && RowDifference(row, last, width) >= threshold)
+			{
+				votes[y]++;
+			}
+
+			memcpy(last, row, width);
+		}
+
+		Evaluate();
+	}
+
+	bool IsFound() const
+	{
+		return found;
+	}
+
+	const ImageRect& GetBand() const
+	{
+		return band;
+	}
+
+private:
+	int width = 0;
+	int height = 0;
+	bool found = false;
+	ImageRect band;
+	std::vector<int> votes;
+	// Lower half of the previous frame
+	std::vector<uint8_t> previous;
+
+	static uint32_t RowDifference(const uint8_t* row, const uint8_t* last, int width)
+	{
+		uint32_t sum = 0;
+
+		for (int x = 0; x < width; x++)
+		{
+			sum += uint32_t(std::abs(int(row[x]) - int(last[x])));
+		}
+
+		return sum;
+	}
+
+	void Evaluate()
+	{
+		int most = *std::max_element(votes.begin(), votes.end());
+
+		if (most < MinVotes)
+		{
+			return;
+		}
+
+		// Lines of the same subtitle are at most this far apart
+		int maxGap = std::max(4, height / 40);
+		int bestVotes = 0;
+		int start = -1;
+		int last = -1;
+		int runVotes = 0;
+
+		for (int y = height / 2; y <= height; y++)
+		{
+			bool strong = y < height && votes[y] * 2 >= most;
+
+			if (!strong && (y == height || (start >= 0 && y - last > maxGap)))
+			{
+				if (start >= 0 && runVotes > bestVotes)
+				{
+					bestVotes = runVotes;
+					band = { 0, start, width, last + 1 - start };
+				}
+
+				start = -1;
+				runVotes = 0;
+			}
+
+			if (strong)
+			{
+				start = start < 0 ? y : start;
+				last = y;
+				runVotes += votes[y];
+			}
+		}
+
+		int padding = std::max(8, band.height / 4);
+		int top = std::max(0, band.y - padding);
+		int bottom = std::min(height, band.Bottom() + padding);
+
+		band = { 0, top, width, bottom - top };
+		found = true;
+	}
+};
+
+// Decides when the text of the subtitle band is sent: once the band stayed the same for stableFrames captures
+// in a row and differs from what was sent last. A settled band without text clears the shown subtitle.
+class SubtitleTracker
+{
+public:
+	enum class Action
+	{
+		None,
+		Submit,
+		Clear
+	};
+
+	explicit SubtitleTracker(int stableFrames) : stableFrames(std::max(1, stableFrames))
+	{
+	}
+
+	// hasText is only asked for when the band settled on something new
+	template <typename HasText>
+	Action Feed(const FrameDiff::Signature& signature, int tolerance, HasText hasText)
+	{
+		bool same = FrameDiff::IsSameFrame(signature, previous, tolerance, 0);
+
+		stable = same ? stable + 1 : 0;
+		previous = signature;
+
+		if (stable != stableFrames || FrameDiff::IsSameFrame(signature, sent, tolerance, 0))
+		{
+			return Action::None;
+		}
+
+		sent = signature;
+
+		return hasText() ? Action::Submit : Action::Clear;
+	}
+
+	// Forgets what was sent, the settled band is sent again
+	void Reset()
+	{
+		sent = FrameDiff::Signature();
+		stable = 0;
+	}
+
+private:
+	int stableFrames;
+	int stable = 0;
+	FrameDiff::Signature previous;
+	FrameDiff::Signature sent;
+};
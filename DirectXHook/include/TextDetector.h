@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "ImageView.h"
+
+struct TextDetectorOptions
+{
+	// Luma step between neighbouring pixels that counts as the edge of a stroke
+	int edgeThreshold = 40;
+	// Edge pixels a CellSize x CellSize cell needs to count as text
+	int minCellEdges = 4;
+	// Cells without text bridged inside a line, the space between words
+	int maxGapCells = 3;
+	int minTextHeight = 8;
+	int maxTextHeight = 160;
+	// Part of the bounding box of a component covered by text cells, textures fill less of it in a scattered way
+	float minFill = 0.35f;
+	// Threads that compute the edge cells, 0 uses every core
+	int threads = 0;
+};
+
+// Proposes the lines of text in a capture, so only those have to go to the server instead of the whole frame.
+// The image is divided into cells, a cell holds text when enough of its pixels are edges of strokes.
+// Text cells are bridged across the gaps between letters and words, joined into connected components,
+// filtered by size and fill, and components next to each other on the same baseline are grouped into lines.
+class TextDetector
+{
+public:
+	static constexpr int CellSize = 4;
+	static constexpr int Padding = 3;
+	// Cell rows a thread gets at least, smaller images are not worth splitting
+	static constexpr int MinRowsPerThread = 32;
+
+	explicit TextDetector(const TextDetectorOptions& options = TextDetectorOptions()) : options(options)
+	{
+	}
+
+	// Bounding boxes of the lines of text in image coordinates, top to bottom
+	std::vector<ImageRect> Detect(const GrayImage& image) const
+	{
+		std::vector<ImageRect> lines;
+
+		if (image.width < CellSize * 2 || image.height < CellSize * 2)
+		{
+			return lines;
+		}
+
+		int columns = image.width / CellSize;
+		int rows = image.height / CellSize;
+		std::vector<uint8_t> cells(size_t(columns) * rows, 0);
+
+		FindEdgeCells(image, columns, rows, cells.data());
+		BridgeGaps(columns, rows, cells.data());
+
+		for (const ImageRect& component : FindComponents(columns, rows, cells.data()))
+		{
+			int height = component.height * CellSize;
+
+			if (height < options.minTextHeight || height > options.maxTextHeight)
+			{
+				continue;
+			}
+
+			lines.push_back({ component.x * CellSize, component.y * CellSize, component.width * CellSize, height });
+		}
+
+		lines = GroupLines(std::move(lines));
+
+		for (ImageRect& line : lines)
+		{
+			int left = std::max(0, line.x - Padding);
+			int top = std::max(0, line.y - Padding);
+			int right = std::min(image.width, line.Right() + Padding);
+			int bottom = std::min(image.height, line.Bottom() + Padding);
+
+			line = { left, top, right - left, bottom - top };
+		}
+
+		std::sort(lines.begin(), lines.end(), [](const ImageRect& a, const ImageRect& b)
+		{
+			return a.y != b.y ? a.y < b.y : a.x < b.x;
+		});
+
+		return lines;
+	}
+
+	// Joins proposals into fewer crops while their bounding box is at most maxWaste times the area they cover,
+	// every crop costs a round trip to the server
+	static std::vector<ImageRect> MergeCrops(std::vector<ImageRect> crops, float maxWaste)
+	{
+		std::vector<int> covered;
+
+		for (const ImageRect& crop : crops)
+		{
+			covered.push_back(crop.Area());
+		}
+
+		bool merged = true;
+
+		while (merged)
+		{
+			merged = false;
+
+			for (size_t i = 0; i < crops.size(); i++)
+			{
+				for (size_t j = i + 1; j < crops.size(); j++)
+				{
+					ImageRect joined = crops[i].Union(crops[j]);
+
+					if (joined.Area() <= maxWaste * (covered[i] + covered[j]))
+					{
+						crops[i] = joined;
+						covered[i] += covered[j];
+						crops.erase(crops.begin() + j);
+						covered.erase(covered.begin() + j);
+						j = i;
+						merged = true;
+					}
+				}
+			}
+		}
+
+		return crops;
+	}
+
+private:
+	TextDetectorOptions options;
+
+	// Marks the cells with enough stroke edges, in horizontal stripes on several threads
+	void FindEdgeCells(const GrayImage& image, int columns, int rows, uint8_t* cells) const
+	{
+		int threads = options.threads > 0 ? options.threads : int(std::thread::hardware_concurrency());
+		threads = std::max(1, std::min(threads, rows / MinRowsPerThread));
+
+		auto stripe = [&](int firstRow, int lastRow)
+		{
+			std::vector<uint16_t> counts(columns);
+
+			for (int row = firstRow; row < lastRow; row++)
+			{
+				std::fill(counts.begin(), counts.end(), 0);
+
+				for (int y = row * CellSize; y < (row + 1) * CellSize; y++)
+				{
+					CountEdges(image, y, columns, counts.data());
+				}
+
+				for (int column = 0; column < columns; column++)
+				{
+					cells[size_t(row) * columns + column] = counts[column] >= options.minCellEdges;
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+
+		for (int i = 1; i < threads; i++)
+		{
+			workers.emplace_back(stripe, rows * i / threads, rows * (i + 1) / threads);
+		}
+
+		stripe(0, rows / threads);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	// Adds the edge pixels of the row to the count of their cell. A pixel is an edge when it differs enough
+	// from its right or lower neighbour.
+	void CountEdges(const GrayImage& image, int y, int columns, uint16_t* counts) const
+	{
+		const uint8_t* row = image.Row(y);
+		const uint8_t* below = image.Row(std::min(y + 1, image.height - 1));
+		// The last pixel of the image has no right neighbour, it is compared with itself
+		int width = std::min(columns * CellSize, image.width - 1);
+		int threshold = options.edgeThreshold;
+
+		for (int column = 0; column * CellSize < width; column++)
+		{
+			int end = std::min(width, (column + 1) * CellSize);
+			uint16_t count = 0;
+
+			for (int x = column * CellSize; x < end; x++)
+			{
+				count += std::abs(int(row[x + 1]) - int(row[x])) >= threshold || std::abs(int(below[x]) - int(row[x])) >= threshold;
+			}
+
+			counts[column] += count;
+		}
+
+		if (width < columns * CellSize)
+		{
+			counts[columns - 1] += std::abs(int(below[width]) - int(row[width])) >= threshold;
+		}
+	}
+
+	// Fills runs of at most maxGapCells empty cells between two text cells of a row
+	void BridgeGaps(int columns, int rows, uint8_t* cells) const
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			uint8_t* line = cells + size_t(row) * columns;
+			int last = -1;
+
+			for (int column = 0; column < columns; column++)
+			{
+				if (!line[column])
+				{
+					continue;
+				}
+
+				if (last >= 0 && column - last - 1 <= options.maxGapCells)
+				{
+					std::fill(line + last + 1, line + column, uint8_t(2));
+				}
+
+				last = column;
+			}
+		}
+	}
+
+	// Bounding boxes in cells of the 4-connected components, scattered components are dropped
+	std::vector<ImageRect> FindComponents(int columns, int rows, const uint8_t* cells) const
+	{
+		std::vector<int> parent(size_t(columns) * rows);
+		std::iota(parent.begin(), parent.end(), 0);
+
+		auto find = [&parent](int i)
+		{
+			while (parent[i] != i)
+			{
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+
+			return i;
+		};
+
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				int i = row * columns + column;
+
+				if (!cells[i])
+				{
+					continue;
+				}
+
+				if (column > 0 && cells[i - 1])
+				{
+					parent[find(i)] = find(i - 1);
+				}
+
+				if (row > 0 && cells[i - columns])
+				{
+					parent[find(i)] = find(i - columns);
+				}
+			}
+		}
+
+		struct Component
+		{
+			int left, top, right, bottom, edgeCells;
+		};
+
+		std::vector<int> index(parent.size(), -1);
+		std::vector<Component> components;
+
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				int i = row * columns + column;
+
+				if (!cells[i])
+				{
+					continue;
+				}
+
+				int root = find(i);
+
+				if (index[root] < 0)
+				{
+					index[root] = int(components.size());
+					components.push_back({ column, row, column, row, 0 });
+				}
+
+				Component& component = components[index[root]];
+				component.left = std::min(component.left, column);
+				component.right = std::max(component.right, column);
+				component.bottom = row;
+				component.edgeCells += cells[i] == 1;
+			}
+		}
+
+		std::vector<ImageRect> boxes;
+
+		for (const Component& component : components)
+		{
+			ImageRect box = { component.left, component.top, component.right + 1 - component.left, component.bottom + 1 - component.top };
+
+			if (component.edgeCells >= options.minFill * box.Area())
+			{
+				boxes.push_back(box);
+			}
+		}
+
+		return boxes;
+	}
+
+	// Joins boxes that share most of their height and are at most one and a half line heights apart, until none are left
+	static std::vector<ImageRect> GroupLines(std::vector<ImageRect> boxes)
+	{
+		bool merged = true;
+
+		while (merged)
+		{
+			merged = false;
+
+			for (size_t i = 0; i < boxes.size(); i++)
+			{
+				for (size_t j = i + 1; j < boxes.size(); j++)
+				{
+					const ImageRect& a = boxes[i];
+					const ImageRect& b = boxes[j];
+					int overlap = std::min(a.Bottom(), b.Bottom()) - std::max(a.y, b.y);
+					int height = std::min(a.height, b.height);
+					int gap = std::max(a.x, b.x) - std::min(a.Right(), b.Right());
+
+					if (overlap * 2 >= height && gap * 2 <= std::max(a.height, b.height) * 3)
+					{
+						// The grown box may reach boxes already passed, they are compared again
+						boxes[i] = a.Union(b);
+						boxes.erase(boxes.begin() + j);
+						j = i;
+						merged = true;
+					}
+				}
+			}
+		}
+
+		return boxes;
+	}
+};
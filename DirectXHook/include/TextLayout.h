@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TranslationEntry.h"
+
+struct TextSize
+{
+	float width = 0.0f;
+	float height = 0.0f;
+};
+
+// Where and how large a string is drawn, everything the per-frame path needs besides the text
+struct TextLayout
+{
+	float x = 0.0f;
+	float y = 0.0f;
+	float scaleX = 1.0f;
+	float scaleY = 1.0f;
+	// The text as it is drawn, with the line breaks of the layout. Empty for StretchToBox, which does not wrap.
+	std::string text;
+	// False when the text could not be measured, nothing is drawn then
+	bool visible = false;
+};
+
+enum class TextFitMode
+{
+	// Stretched over the box in both directions, the aspect ratio of the text is lost
+	Stretch,
+	// Wrapped into lines and scaled uniformly to the largest size that fits the box
+	Wrap
+};
+
+enum class LineBreaking
+{
+	// Fills every line as far as it goes
+	Greedy,
+	// Spreads the words evenly over the lines, minimizing the squared slack of all lines but the last
+	Balanced
+};
+
+// What happens to text that does not fit the box even at the smallest line height
+enum class TextSpill
+{
+	// Drawn at the smallest line height and runs past the bottom of the box
+	Overflow,
+	// Scaled below the smallest line height until it fits
+	Shrink,
+	// The lines below the box are dropped, the last one shown ends with "..."
+	Ellipsis
+};
+
+struct TextFitOptions
+{
+	TextFitMode mode = TextFitMode::Wrap;
+	LineBreaking breaking = LineBreaking::Greedy;
+	TextSpill spill = TextSpill::Overflow;
+	// Range of the drawn line height in pixels
+	float minLineHeight = 12.0f;
+	float maxLineHeight = 48.0f;
+};
+
+namespace TextLayoutEngine
+{
+	using MeasureFunction = std::function<TextSize(const char* text)>;
+
+	// Stretches the text over the box
+	static TextLayout StretchToBox(TextSize size, float x, float y, float width, float height)
+	{
+		TextLayout layout;
+
+		layout.x = x;
+		layout.y = y;
+		layout.visible = size.width > 0.0f && size.height > 0.0f;
+
+		if (layout.visible)
+		{
+			layout.scaleX = width / size.width;
+			layout.scaleY = height / size.height;
+		}
+
+		return layout;
+	}
+
+	// Words of the text, one list per line of the text itself. Runs of spaces separate words, '\n' starts a new line.
+	static std::vector<std::vector<std::string>> SplitWords(const std::string& text)
+	{
+		std::vector<std::vector<std::string>> paragraphs(1);
+		std::string word;
+
+		for (char character : text)
+		{
+			if (character == ' ' || character == '\t' || character == '\n')
+			{
+				if (!word.empty())
+				{
+					paragraphs.back().push_back(std::move(word));
+					word.clear();
+				}
+
+				if (character == '\n')
+				{
+					paragraphs.emplace_back();
+				}
+			}
+			else if (character != '\r')
+			{
+				word += character;
+			}
+		}
+
+		if (!word.empty())
+		{
+			paragraphs.back().push_back(std::move(word));
+		}
+
+		return paragraphs;
+	}
+
+	static std::string JoinWords(const std::vector<std::string>& words, size_t first, size_t last)
+	{
+		std::string line;
+
+		for (size_t i = first; i < last; i++)
+		{
+			if (i != first)
+			{
+				line += ' ';
+			}
+
+			line += words[i];
+		}
+
+		return line;
+	}
+
+	// Lines of a paragraph no wider than maxWidth at scale 1. A word wider than that gets a line of its own.
+	static void BreakLines(
+		const std::vector<std::string>& words,
+		float maxWidth,
+		LineBreaking breaking,
+		const MeasureFunction& measure,
+		std::vector<std::string>& lines)
+	{
+		if (words.empty())
+		{
+			lines.emplace_back();
+			return;
+		}
+
+		if (breaking == LineBreaking::Greedy)
+		{
+			std::string line = words[0];
+
+			for (size_t i = 1; i < words.size(); i++)
+			{
+				std::string candidate = line + ' ' + words[i];
+
+				if (measure(candidate.c_str()).width <= maxWidth)
+				{
+					line = std::move(candidate);
+				}
+				else
+				{
+					lines.push_back(std::move(line));
+					line = words[i];
+				}
+			}
+
+			lines.push_back(std::move(line));
+			return;
+		}
+
+		// cost[j] is the least total cost of setting the first j words, start[j] where the last of those lines begins
+		size_t count = words.size();
+		std::vector<float> cost(count + 1, std::numeric_limits<float>::infinity());
+		std::vector<size_t> start(count + 1, 0);
+
+		cost[0] = 0.0f;
+
+		for (size_t last = 1; last <= count; last++)
+		{
+			for (size_t first = last; first-- > 0;)
+			{
+				float width = measure(JoinWords(words, first, last).c_str()).width;
+
+				if (width > maxWidth && first + 1 != last)
+				{
+					break;
+				}
+
+				float slack = last == count ? 0.0f : std::max(0.0f, maxWidth - width);
+				float total = cost[first] + slack * slack;
+
+				if (total < cost[last])
+				{
+					cost[last] = total;
+					start[last] = first;
+				}
+			}
+		}
+
+		size_t firstLine = lines.size();
+
+		for (size_t last = count; last > 0; last = start[last])
+		{
+			lines.push_back(JoinWords(words, start[last], last));
+		}
+
+		std::reverse(lines.begin() + firstLine, lines.end());
+	}
+
+	static std::string JoinLines(const std::vector<std::string>& lines, size_t count)
+	{
+		std::string text;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (i != 0)
+			{
+				text += '\n';
+			}
+
+			text += lines[i];
+		}
+
+		return text;
+	}
+
+	// Wraps the text into lines and picks the largest uniform scale at which the lines fit the box, by binary search
+	// between the line heights of the options. Text that does not fit at the smallest one spills as the options say.
+	// The lines are left aligned, the block is centered in the box.
+	static TextLayout FitToBox(
+		const std::string& text,
+		const MeasureFunction& measure,
+		float x,
+		float y,
+		float width,
+		float height,
+		const TextFitOptions& options)
+	{
+		TextSize unwrapped = measure(text.c_str());
+
+		if (options.mode == TextFitMode::Stretch || width <= 0.0f || height <= 0.0f)
+		{
+			TextLayout layout = StretchToBox(unwrapped, x, y, width, height);
+			layout.text = text;
+			return layout;
+		}
+
+		TextLayout layout;
+
+		if (unwrapped.width <= 0.0f || unwrapped.height <= 0.0f)
+		{
+			return layout;
+		}
+
+		std::vector<std::vector<std::string>> paragraphs = SplitWords(text);
+		float lineHeight = unwrapped.height / paragraphs.size();
+
+		std::vector<std::string> lines;
+		TextSize size;
+
+		auto wrap = [&](float scale)
+		{
+			lines.clear();
+
+			for (const std::vector<std::string>& words : paragraphs)
+			{
+				BreakLines(words, width / scale, options.breaking, measure, lines);
+			}
+
+			size = measure(JoinLines(lines, lines.size()).c_str());
+
+			return size.width > 0.0f && size.width * scale <= width && size.height * scale <= height;
+		};
+
+		float low = options.minLineHeight / lineHeight;
+		float high = std::max(low, std::min(height, options.maxLineHeight) / lineHeight);
+		float scale = high;
+
+		if (!wrap(high))
+		{
+			scale = low;
+
+			if (wrap(low))
+			{
+				// Stops once the line heights of the bounds are less than half a pixel apart
+				while ((high - low) * lineHeight > 0.5f)
+				{
+					float middle = (low + high) * 0.5f;
+
+					if (wrap(middle))
+					{
+						low = middle;
+					}
+					else
+					{
+						high = middle;
+					}
+				}
+
+				scale = low;
+				wrap(scale);
+			}
+			else if (options.spill == TextSpill::Shrink && size.width > 0.0f && size.height > 0.0f)
+			{
+				// The size was measured at scale 1
+				scale = std::min(width / size.width, height / size.height);
+			}
+			else if (options.spill == TextSpill::Ellipsis)
+			{
+				size_t shown = std::max<size_t>(1, size_t(height / (lineHeight * scale)));
+
+				if (shown < lines.size())
+				{
+					std::string& last = lines[shown - 1];
+					std::vector<std::string> words = SplitWords(last).front();
+
+					for (size_t count = words.size(); ; count--)
+					{
+						last = JoinWords(words, 0, count) + "...";
+
+						if (count == 0 || measure(last.c_str()).width * scale <= width)
+						{
+							break;
+						}
+					}
+
+					lines.resize(shown);
+				}
+
+				size = measure(JoinLines(lines, lines.size()).c_str());
+			}
+		}
+
+		layout.text = JoinLines(lines, lines.size());
+		layout.scaleX = scale;
+		layout.scaleY = scale;
+		layout.x = x + std::max(0.0f, (width - size.width * scale) * 0.5f);
+		layout.y = y + std::max(0.0f, (height - size.height * scale) * 0.5f);
+		layout.visible = size.width > 0.0f && size.height > 0.0f;
+
+		return layout;
+	}
+}
+
+// Layouts of the shown entries, built by the writer of a snapshot before it is published so the render thread
+// only draws them. Layouts of strings that stay on screen are carried over from the previous build of the same
+// text kind, keyed by text, font and box size, so a partial update only measures what is new.
+class LayoutCache
+{
+public:
+	using MeasureFunction = TextLayoutEngine::MeasureFunction;
+
+	explicit LayoutCache(const TextFitOptions& options = TextFitOptions()) : options(options)
+	{
+	}
+
+	// Layouts of the entries in the same order, of their translations or of the recognized text
+	std::vector<TextLayout> Build(
+		const void* font,
+		bool translations,
+		const std::vector<TranslateClient::TranslationEntry>& entries,
+		const MeasureFunction& measure)
+	{
+		std::unordered_map<Key, TextLayout, KeyHash>& cache = caches[translations ? 1 : 0];
+		std::unordered_map<Key, TextLayout, KeyHash> kept;
+		std::vector<TextLayout> layouts;
+
+		layouts.reserve(entries.size());
+
+		for (const TranslateClient::TranslationEntry& entry : entries)
+		{
+			Key key{ translations ? entry.translation : entry.message, font, entry.w, entry.h };
+			TextLayout layout;
+
+			auto cached = cache.find(key);
+
+			if (cached != cache.end())
+			{
+				layout = cached->second;
+			}
+			else
+			{
+				layout = TextLayoutEngine::FitToBox(key.text, measure, 0.0f, 0.0f, entry.w, entry.h, options);
+				measured++;
+			}
+
+			kept.emplace(key, layout);
+
+			layout.x += float(entry.x);
+			layout.y += float(entry.y);
+			layouts.push_back(std::move(layout));
+		}
+
+		cache = std::move(kept);
+
+		return layouts;
+	}
+
+	// Number of strings measured so far, cache hits are not counted
+	uint64_t GetMeasuredCount() const
+	{
+		return measured;
+	}
+
+private:
+	// Layouts in the cache are relative to the origin of the box, the position is added per entry
+	struct Key
+	{
+		std::string text;
+		const void* font;
+		float width;
+		float height;
+
+		bool operator==(const Key& other) const
+		{
+			return text == other.text && font == other.font && width == other.width && height == other.height;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			size_t hash = std::hash<std::string>()(key.text);
+			hash ^= std::hash<const void*>()(key.font) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			hash ^= std::hash<float>()(key.width) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			hash ^= std::hash<float>()(key.height) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+	};
+
+	TextFitOptions options;
+	// Of the recognized text and of the translations, kept apart so building both does not evict either
+	std::unordered_map<Key, TextLayout, KeyHash> caches[2];
+	uint64_t measured = 0;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+struct TextColor
+{
+	float r = 1.0f;
+	float g = 1.0f;
+	float b = 1.0f;
+	float a = 1.0f;
+};
+
+// One string to draw, the text lives in the arena of the queue it was pushed to
+struct TextCommand
+{
+	// Identifies the font, draws of the same font end up next to each other
+	const void* font = nullptr;
+	uint32_t textOffset = 0;
+	float x = 0.0f;
+	float y = 0.0f;
+	float scaleX = 1.0f;
+	float scaleY = 1.0f;
+	TextColor color;
+};
+
+// What actually draws the queued text, the overlay implements it with SpriteBatch
+class ITextBackend
+{
+public:
+	virtual ~ITextBackend() {}
+
+	virtual void Begin() = 0;
+	virtual void DrawString(const TextCommand& command, const char* text) = 0;
+	virtual void End() = 0;
+};
+
+// Collects the text of a whole frame and submits it in a single Begin/End.
+// Commands are grouped by font, the order within a font is kept so shadows stay behind their text.
+// The buffers are reused from frame to frame, a steady frame does not allocate.
+class TextQueue
+{
+public:
+	// Copies the text into the arena once, any number of commands can refer to it
+	uint32_t AddText(const char* text)
+	{
+		uint32_t offset = uint32_t(arena.size());
+		size_t length = strlen(text);
+
+		arena.insert(arena.end(), text, text + length + 1);
+
+		return offset;
+	}
+
+	void Push(const TextCommand& command)
+	{
+		commands.push_back(command);
+	}
+
+	size_t GetCount() const
+	{
+		return commands.size();
+	}
+
+	void Flush(ITextBackend& backend)
+	{
+		if (commands.empty())
+		{
+			arena.clear();
+			return;
+		}
+
+		bool singleFont = std::all_of(commands.begin(), commands.end(),
+			[this](const TextCommand& command) { return command.font == commands.front().font; });
+
+		if (!singleFont)
+		{
+			std::stable_sort(commands.begin(), commands.end(),
+				[](const TextCommand& a, const TextCommand& b) { return std::less<const void*>()(a.font, b.font); });
+		}
+
+		backend.Begin();
+
+		for (const TextCommand& command : commands)
+		{
+			backend.DrawString(command, arena.data() + command.textOffset);
+		}
+
+		backend.End();
+
+		commands.clear();
+		arena.clear();
+	}
+
+private:
+	std::vector<TextCommand> commands;
+	std::vector<char> arena;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+enum class ShadowQuality
+{
+	Off,
+	// Four diagonal copies, enough for small radii
+	Low,
+	// The eight compass directions
+	Medium,
+	// As many copies around the circle as needed to keep neighbours about MaxSampleSpacing pixels apart
+	High
+};
+
+// Outline behind overlay text, made of copies of the string drawn at fixed offsets around the label
+namespace TextShadow
+{
+	struct Offset
+	{
+		float x;
+		float y;
+	};
+
+	static constexpr float Pi = 3.14159265f;
+	static constexpr float MaxSampleSpacing = 1.5f;
+	static constexpr int MaxSamples = 64;
+
+	static int GetSampleCount(float radius, ShadowQuality quality)
+	{
+		switch (quality)
+		{
+		case ShadowQuality::Off:
+			return 0;
+		case ShadowQuality::Low:
+			return 4;
+		case ShadowQuality::Medium:
+			return 8;
+		default:
+			break;
+		}
+
+		int count = int(std::ceil(2.0f * Pi * radius / MaxSampleSpacing));
+
+		return count < 8 ? 8 : (count > MaxSamples ? MaxSamples : count);
+	}
+
+	// Offsets evenly spread over the circle of the given radius
+	static std::vector<Offset> ComputeOffsets(float radius, ShadowQuality quality)
+	{
+		std::vector<Offset> offsets;
+
+		if (radius <= 0.0f)
+		{
+			return offsets;
+		}
+
+		int count = GetSampleCount(radius, quality);
+		// Low starts on the diagonals, an outline that only extends left, right, up and down looks boxy
+		float start = quality == ShadowQuality::Low ? 0.5f : 0.0f;
+
+		for (int i = 0; i < count; i++)
+		{
+			float angle = 2.0f * Pi * (i + start) / count;
+
+			offsets.push_back({ radius * std::cos(angle), radius * std::sin(angle) });
+		}
+
+		return offsets;
+	}
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ImageView.h"
+#include "Preprocess.h"
+#include "TranslationEntry.h"
+
+// Fingerprint of a line of text. The tile is divided into CellSize x CellSize cells and the mean luma of every cell
+// is quantized to two bits relative to the darkest and brightest cell. The key does not change with the brightness
+// of the tile, while a changed character moves the cells it covers to other levels.
+struct TileKey
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint64_t> bits;
+
+	bool operator==(const TileKey& other) const
+	{
+		return width == other.width && height == other.height && bits == other.bits;
+	}
+};
+
+struct TileKeyHash
+{
+	size_t operator()(const TileKey& key) const
+	{
+		uint64_t hash = 0xcbf29ce484222325ull ^ (uint64_t(key.width) << 32 | uint32_t(key.height));
+
+		for (uint64_t word : key.bits)
+		{
+			hash = (hash ^ word) * 0x100000001b3ull;
+			hash ^= hash >> 29;
+		}
+
+		return size_t(hash);
+	}
+};
+
+// A tile of the frame, in screen space, its fingerprint and the hash of its pixels (TileHashing::ComputePixelHash)
+struct Tile
+{
+	ImageRect rect;
+	TileKey key;
+	uint64_t pixelHash = 0;
+};
+
+// Splitting a capture into text lines and fingerprinting them
+namespace TileHashing
+{
+	static constexpr int CellSize = 4;
+	// Mean horizontal luma step of a row that counts as text
+	static constexpr int MinRowEnergy = 6;
+	static constexpr int MinTextHeight = 6;
+	// A row counts as text when its detail adds up to at least a line this wide, a short label in a wide capture still does
+	static constexpr int MinLineWidth = 64;
+	// Rows without text inside a line, between the strokes of a character
+	static constexpr int MaxRowGap = 2;
+	static constexpr int Padding = 2;
+
+	static uint32_t RowEnergyScalar(const uint8_t* row, int width)
+	{
+		uint32_t sum = 0;
+
+		for (int x = 0; x + 1 < width; x++)
+		{
+			sum += uint32_t(std::abs(int(row[x + 1]) - int(row[x])));
+		}
+
+		return sum;
+	}
+
+	// Adds the luma of every group of CellSize pixels of the row to sums
+	static void AddCellSumsScalar(const uint8_t* row, int first, int width, uint32_t* sums)
+	{
+		for (int x = first; x < width; x++)
+		{
+			sums[x / CellSize] += row[x];
+		}
+	}
+
+#ifdef PREPROCESS_X86
+	// Sum of the absolute differences of neighbouring pixels, _mm_sad_epu8 against the row shifted by one
+	static uint32_t RowEnergySse2(const uint8_t* row, int width)
+	{
+		__m128i sum = _mm_setzero_si128();
+		int x = 0;
+
+		for (; x + 17 <= width; x += 16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(row + x));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row + x + 1));
+
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(a, b));
+		}
+
+		uint32_t total = uint32_t(_mm_cvtsi128_si32(sum)) + uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+
+		return total + RowEnergyScalar(row + x, width - x);
+	}
+
+	// Four cells per 16 pixels: the low and high halves of every 64-bit lane are summed by _mm_sad_epu8 separately
+	static void AddCellSumsSse2(const uint8_t* row, int width, uint32_t* sums)
+	{
+		static_assert(CellSize == 4, "The SSE2 path sums groups of four pixels");
+
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i low = _mm_set_epi32(0, -1, 0, -1);
+		int x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+			__m128i even = _mm_sad_epu8(_mm_and_si128(pixels, low), zero);
+			__m128i odd = _mm_sad_epu8(_mm_srli_epi64(pixels, 32), zero);
+			uint32_t* cell = sums + x / CellSize;
+
+			cell[0] += uint32_t(_mm_cvtsi128_si32(even));
+			cell[1] += uint32_t(_mm_cvtsi128_si32(odd));
+			cell[2] += uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(even, 8)));
+			cell[3] += uint32_t(_mm_cvtsi128_si32(_mm_srli_si128(odd, 8)));
+		}
+
+		AddCellSumsScalar(row, x, width, sums);
+	}
+#endif
+
+	static uint32_t RowEnergy(const uint8_t* row, int width, Preprocess::Isa isa)
+	{
+#ifdef PREPROCESS_X86
+		if (isa != Preprocess::Isa::Scalar)
+		{
+			return RowEnergySse2(row, width);
+		}
+#endif
+		return RowEnergyScalar(row, width);
+	}
+
+	static void AddCellSums(const uint8_t* row, int width, uint32_t* sums, Preprocess::Isa isa)
+	{
+#ifdef PREPROCESS_X86
+		if (isa != Preprocess::Isa::Scalar)
+		{
+			AddCellSumsSse2(row, width, sums);
+			return;
+		}
+#endif
+		AddCellSumsScalar(row, 0, width, sums);
+	}
+
+	// Lines of text in the image: runs of rows with enough horizontal detail, split where a gap at least
+	// as wide as the line is high separates two labels
+	static std::vector<ImageRect> FindTextTiles(const GrayImage& image, Preprocess::Isa isa = Preprocess::GetIsa())
+	{
+		std::vector<ImageRect> tiles;
+
+		if (image.width < 2 || image.height < MinTextHeight)
+		{
+			return tiles;
+		}
+
+		const uint32_t rowThreshold = uint32_t(MinRowEnergy * std::min(image.width - 1, MinLineWidth));
+		std::vector<ImageRect> bands;
+		int start = -1;
+		int last = -1;
+
+		for (int y = 0; y <= image.height; y++)
+		{
+			bool text = y < image.height && RowEnergy(image.Row(y), image.width, isa) >= rowThreshold;
+
+			if (text)
+			{
+				if (start < 0 || y - last > MaxRowGap + 1)
+				{
+					if (start >= 0)
+					{
+						bands.push_back({ 0, start, image.width, last + 1 - start });
+					}
+
+					start = y;
+				}
+
+				last = y;
+			}
+		}
+
+		if (start >= 0)
+		{
+			bands.push_back({ 0, start, image.width, last + 1 - start });
+		}
+
+		std::vector<uint32_t> columns(image.width);
+
+		for (const ImageRect& band : bands)
+		{
+			if (band.height < MinTextHeight)
+			{
+				continue;
+			}
+
+			int top = std::max(0, band.y - Padding);
+			int bottom = std::min(image.height, band.Bottom() + Padding);
+
+			std::fill(columns.begin(), columns.end(), 0);
+
+			for (int y = band.y; y < band.Bottom(); y++)
+			{
+				const uint8_t* row = image.Row(y);
+
+				for (int x = 0; x + 1 < image.width; x++)
+				{
+					columns[x] += uint32_t(std::abs(int(row[x + 1]) - int(row[x])));
+				}
+			}
+
+			int left = -1;
+			int right = -1;
+
+			for (int x = 0; x <= image.width; x++)
+			{
+				bool text = x < image.width && columns[x] >= uint32_t(MinRowEnergy * band.height);
+
+				if (!text)
+				{
+					continue;
+				}
+
+				if (left >= 0 && x - right > band.height)
+				{
+					tiles.push_back({ std::max(0, left - Padding), top, std::min(image.width, right + 1 + Padding) - std::max(0, left - Padding), bottom - top });
+					left = -1;
+				}
+
+				if (left < 0)
+				{
+					left = x;
+				}
+
+				right = x;
+			}
+
+			if (left >= 0)
+			{
+				tiles.push_back({ std::max(0, left - Padding), top, std::min(image.width, right + 1 + Padding) - std::max(0, left - Padding), bottom - top });
+			}
+		}
+
+		return tiles;
+	}
+
+	static TileKey ComputeKey(const GrayImage& image, const ImageRect& tile, Preprocess::Isa isa = Preprocess::GetIsa())
+	{
+		TileKey key;
+		key.width = tile.width;
+		key.height = tile.height;
+
+		int columns = (tile.width + CellSize - 1) / CellSize;
+		int rows = (tile.height + CellSize - 1) / CellSize;
+		std::vector<uint32_t> means(size_t(columns) * rows, 0);
+
+		for (int y = 0; y < tile.height; y++)
+		{
+			AddCellSums(image.Row(tile.y + y) + tile.x, tile.width, &means[size_t(y / CellSize) * columns], isa);
+		}
+
+		for (int row = 0; row < rows; row++)
+		{
+			int cellHeight = std::min(CellSize, tile.height - row * CellSize);
+
+			for (int column = 0; column < columns; column++)
+			{
+				int cellWidth = std::min(CellSize, tile.width - column * CellSize);
+				means[size_t(row) * columns + column] /= uint32_t(cellWidth * cellHeight);
+			}
+		}
+
+		auto range = std::minmax_element(means.begin(), means.end());
+		uint32_t darkest = *range.first;
+		uint32_t contrast = *range.second - darkest + 1;
+
+		key.bits.assign((means.size() * 2 + 63) / 64, 0);
+
+		// A flat tile has no text to tell apart, every cell gets level 0
+		if (contrast <= 16)
+		{
+			return key;
+		}
+
+		for (size_t i = 0; i < means.size(); i++)
+		{
+			uint64_t level = (means[i] - darkest) * 4 / contrast;
+			key.bits[i * 2 / 64] |= level << (i * 2 % 64);
+		}
+
+		return key;
+	}
+
+	// Hash of every pixel of the tile relative to its darkest one. Two lines of the same size can share a key,
+	// the cells average away the strokes that tell them apart, so a cache hit is only taken when this matches too.
+	// Like the key it does not change when the whole tile gets brighter or darker by the same amount.
+	static uint64_t ComputePixelHash(const GrayImage& image, const ImageRect& tile)
+	{
+		uint8_t darkest = 255;
+
+		for (int y = 0; y < tile.height; y++)
+		{
+			const uint8_t* row = image.Row(tile.y + y) + tile.x;
+			darkest = std::min(darkest, *std::min_element(row, row + tile.width));
+		}
+
+		// Every byte is at least darkest, subtracting it from all bytes of a word at once never borrows
+		const uint64_t offset = darkest * 0x0101010101010101ull;
+		uint64_t hash = 0xcbf29ce484222325ull ^ (uint64_t(tile.width) << 32 | uint32_t(tile.height));
+
+		for (int y = 0; y < tile.height; y++)
+		{
+			const uint8_t* row = image.Row(tile.y + y) + tile.x;
+			int x = 0;
+
+			for (; x + 8 <= tile.width; x += 8)
+			{
+				uint64_t word;
+				memcpy(&word, row + x, sizeof(word));
+				hash = (hash ^ (word - offset)) * 0x100000001b3ull;
+				hash ^= hash >> 29;
+			}
+
+			for (; x < tile.width; x++)
+			{
+				hash = (hash ^ uint8_t(row[x] - darkest)) * 0x100000001b3ull;
+			}
+		}
+
+		return hash;
+	}
+}
+
+// Recognized lines of text by fingerprint, so a line seen before does not have to go to the server again.
+// Entries are stored relative to the origin of their tile. Holds at most maxTiles tiles, the least recently
+// used are evicted first. Looked up by the capture pipeline and filled by the translate worker.
+class TileCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		// Tile pixels served from the cache or sent to the server
+		uint64_t hitPixels = 0;
+		uint64_t missPixels = 0;
+		// Lookups that found the key of another line, counted as misses as well
+		uint64_t collisions = 0;
+	};
+
+	explicit TileCache(size_t maxTiles) : maxTiles(maxTiles)
+	{
+	}
+
+	// Entries recognized in the tile, moved to its position on screen. False when the tile is not cached,
+	// or another line with the same key is.
+	bool Find(const Tile& tile, std::vector<TranslateClient::TranslationEntry>* entries)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto found = tiles.find(tile.key);
+
+		if (found != tiles.end() && found->second.pixelHash != tile.pixelHash)
+		{
+			stats.collisions++;
+			found = tiles.end();
+		}
+
+		if (found == tiles.end())
+		{
+			stats.misses++;
+			stats.missPixels += uint64_t(tile.rect.Area());
+			return false;
+		}
+
+		stats.hits++;
+		stats.hitPixels += uint64_t(tile.rect.Area());
+		order.splice(order.begin(), order, found->second.position);
+
+		for (TranslateClient::TranslationEntry entry : found->second.entries)
+		{
+			entry.x += tile.rect.x;
+			entry.y += tile.rect.y;
+			entries->push_back(std::move(entry));
+		}
+
+		return true;
+	}
+
+	// Keeps the entries of the screen space tile, an empty list is cached as well: the tile holds no text
+	void Insert(const Tile& tile, std::vector<TranslateClient::TranslationEntry> entries)
+	{
+		for (TranslateClient::TranslationEntry& entry : entries)
+		{
+			entry.x -= tile.rect.x;
+			entry.y -= tile.rect.y;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto found = tiles.find(tile.key);
+
+		if (found != tiles.end())
+		{
+			found->second.entries = std::move(entries);
+			found->second.pixelHash = tile.pixelHash;
+			order.splice(order.begin(), order, found->second.position);
+			return;
+		}
+
+		order.push_front(tile.key);
+		tiles.emplace(tile.key, Cached{ std::move(entries), tile.pixelHash, order.begin() });
+
+		while (tiles.size() > maxTiles)
+		{
+			tiles.erase(order.back());
+			order.pop_back();
+		}
+	}
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return stats;
+	}
+
+private:
+	struct Cached
+	{
+		std::vector<TranslateClient::TranslationEntry> entries;
+		uint64_t pixelHash;
+		std::list<TileKey>::iterator position;
+	};
+
+	size_t maxTiles;
+	std::mutex mutex;
+	// Most recently used first
+	std::list<TileKey> order;
+	std::unordered_map<TileKey, Cached, TileKeyHash> tiles;
+	Stats stats;
+};
@@ -3,207 +3,649 @@
 #include <Windows.h>
 #include <winhttp.h>
 #include <DirectXTex.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <mutex>
 #include <nlohmann/json.hpp>
 
 #include "Config.h"
 #include "Logger.h"
+#include "Transport.h"
+#include "CaptureKind.h"
+#include "RequestSequencer.h"
+#include "SnapshotSlot.h"
+#include "TextLayout.h"
+#include "TranslationEntry.h"
+#include "ResponseParser.h"
+#include "ImageView.h"
+#include "TileCache.h"
+#include "CropAtlas.h"
+#include "TranslationCache.h"
+#include "TranslationStore.h"
 
 using namespace DirectX;
 using json = nlohmann::json;
 
-#pragma comment(lib, "winhttp.lib")
-
 namespace TranslateClient 
 {
 	static Logger logger{ "TranslateClient" };
 
-	struct TranslationEntry {
-		int x;
-		int y;
-		float w;
-		float h;
-		std::string translation;
-		std::string message;
+	// The client is used from more than one translation unit (renderer and capture pipeline),
+	// its state is inline so all of them share a single instance
+	inline std::vector<TranslationEntry> lastEntries = std::vector<TranslationEntry>();
+	inline std::mutex mutex;
+
+	// What the server accepts, filled by QueryCapabilities
+	struct ServerCapabilities
+	{
+		bool queried = false;
+		std::vector<std::string> formats;
+		// The server can skip translating and return the recognized text only
+		bool ocrOnly = false;
+	};
+
+	inline ServerCapabilities capabilities = ServerCapabilities();
+	// Only used by the translate worker. The store on disk backs the cache in memory across sessions.
+	inline TranslationCache translationCache{ TranslationCacheBytes };
+	inline TranslationStore translationStore;
+	// Filled by the translate worker, looked up by the capture pipeline
+	inline TileCache tileCache{ TileCacheMaxTiles };
+
+	// Numbers the requests and decides which responses are still worth showing
+	inline RequestSequencer sequencer;
+	// Set when a request was dropped or failed, the next capture is then sent as a full frame
+	// because the changed regions of the lost request would otherwise never be scanned
+	inline std::atomic<bool> resyncNeeded = false;
+
+	// Called by the capture pipeline only, so the sequences of a kind increase
+	static uint64_t NextSequence(CaptureKind kind)
+	{
+		return sequencer.Next(kind);
+	}
+
+	static void RequestResync()
+	{
+		resyncNeeded = true;
+	}
+
+	static bool ConsumeResync()
+	{
+		return resyncNeeded.exchange(false);
+	}
+
+	// Entries shown at one point in time. A snapshot is never modified once published,
+	// every change publishes a new one with a higher generation.
+	struct Snapshot
+	{
+		uint64_t generation = 0;
+		std::vector<TranslationEntry> entries;
+		// Laid out with layoutFont before publishing, the render thread draws them without measuring.
+		// Both texts are laid out, so toggling between them costs nothing either. Empty until a font was set.
+		const void* layoutFont = nullptr;
+		std::vector<TextLayout> messageLayouts;
+		std::vector<TextLayout> translationLayouts;
 	};
 
-	static std::vector<TranslationEntry> entries = std::vector<TranslationEntry>();
-	static std::mutex mutex = std::mutex();
+	// The render thread reads it without taking the mutex and without copying the entries,
+	// its reference keeps the snapshot alive while the frame is drawn
+	inline SnapshotSlot<Snapshot> snapshots;
+
+	// Guarded by the mutex, whoever publishes builds the layouts. The font is set by the renderer.
+	inline LayoutCache layoutCache{ SubtitleTextFit };
+	inline const void* layoutFont = nullptr;
+	inline LayoutCache::MeasureFunction layoutMeasure;
+
+	// Called with the mutex held, so generations are published in order
+	static void Publish(std::vector<TranslationEntry> newEntries)
+	{
+		std::shared_ptr<Snapshot> next = std::make_shared<Snapshot>();
+		next->entries = std::move(newEntries);
+
+		if (layoutMeasure)
+		{
+			next->layoutFont = layoutFont;
+			next->messageLayouts = layoutCache.Build(layoutFont, false, next->entries, layoutMeasure);
+			next->translationLayouts = layoutCache.Build(layoutFont, true, next->entries, layoutMeasure);
+		}
+
+		snapshots.Publish(std::move(next));
+	}
 
-	static void PullEntries(std::vector<TranslationEntry>* target)
+	static std::shared_ptr<const Snapshot> AcquireSnapshot()
+	{
+		return snapshots.Acquire();
+	}
+
+	// Called by the renderer when the active font changed, measure has to stay valid on any thread.
+	// The shown entries are published again laid out with the new font.
+	static void SetLayoutFont(const void* font, LayoutCache::MeasureFunction measure)
 	{
 		std::lock_guard<std::mutex> lock(mutex);
 
-		*target = entries;
+		layoutFont = font;
+		layoutMeasure = std::move(measure);
+		Publish(snapshots.Acquire()->entries);
 	}
 
 	static void ClearEntries()
 	{
 		std::lock_guard<std::mutex> lock(mutex);
 
-		entries.clear();
+		Publish({});
+		// Responses to requests sent before clearing are stale
+		sequencer.Clear();
+	}
+
+	// A region of the captured frame, encoded on its own, and its position on screen
+	struct Crop
+	{
+		int x = 0;
+		int y = 0;
+		int width = 0;
+		int height = 0;
+		CaptureFormat format = CaptureFormat::Bmp;
+		// Uploaded pixels per screen pixel, below 1 when the crop was downscaled
+		float scale = 1.0f;
+		Blob blob;
+		// Lines of text inside the crop missing from the tile cache, their entries are cached once they arrive
+		std::vector<Tile> tiles;
+		// Set when the crop is an atlas of several parts of the frame, x and y are 0 then
+		AtlasLayout atlas;
+	};
+
+	struct Request
+	{
+		uint64_t sequence = 0;
+		CaptureKind kind = CaptureKind::Manual;
+		std::vector<Crop> crops;
+		// The parts of the frame scanned again, shown entries inside them are replaced by the response
+		std::vector<ImageRect> regions;
+		// Entries of lines found in the tile cache, already in screen space
+		std::vector<TranslationEntry> cachedEntries;
+		bool fullFrame = true;
+	};
+
+	static bool IsInsideRect(const TranslationEntry& entry, const ImageRect& rect)
+	{
+		return entry.x < rect.Right() && rect.x < entry.x + entry.w &&
+			entry.y < rect.Bottom() && rect.y < entry.y + entry.h;
+	}
+
+	// True once a newer request of the same kind was created, its response would be outdated on arrival
+	static bool IsSuperseded(const Request& request)
+	{
+		return sequencer.IsSuperseded(request.sequence, request.kind);
+	}
+
+	// For partial requests the entries of the previous response outside of the re-scanned regions are kept,
+	// as those regions did not change
+	static std::vector<TranslationEntry> MergeEntries(const Request& request, const std::vector<TranslationEntry>& newEntries)
+	{
+		std::vector<TranslationEntry> merged;
+
+		if (!request.fullFrame)
+		{
+			for (const TranslationEntry& entry : lastEntries)
+			{
+				bool rescanned = false;
+
+				for (const ImageRect& region : request.regions)
+				{
+					rescanned = rescanned || IsInsideRect(entry, region);
+				}
+
+				if (!rescanned)
+				{
+					merged.push_back(entry);
+				}
+			}
+		}
+
+		merged.insert(merged.end(), newEntries.begin(), newEntries.end());
+
+		return merged;
+	}
+
+	// Replaces the shown entries with the response.
+	// Returns false when the response is older than the shown entries of its kind and was discarded.
+	static bool PushEntries(const Request& request, const std::vector<TranslationEntry>& newEntries)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!sequencer.Show(request.sequence, request.kind))
+		{
+			logger.Log("Discarding response %llu, %llu is already shown", request.sequence, sequencer.GetShown(request.kind));
+			return false;
+		}
+
+		lastEntries = MergeEntries(request, newEntries);
+		Publish(lastEntries);
+
+		return true;
 	}
 
-	static void PushEntries(std::vector<TranslationEntry> &newEntries)
+	// Shows the entries received so far while the response is still arriving
+	static void PreviewEntries(const Request& request, const std::vector<TranslationEntry>& newEntries)
 	{
 		std::lock_guard<std::mutex> lock(mutex);
 
-		for (TranslationEntry entry : newEntries)
+		if (sequencer.IsNewerThanShown(request.sequence, request.kind))
 		{
-			entries.push_back(entry);
+			Publish(MergeEntries(request, newEntries));
 		}
 	}
 
-	static void ParseResponse(const char *buffer, size_t size)
+	// Shows the result of the last response again, used when the frame did not change since then
+	static void RestoreEntries()
 	{
-		if (size <= 1)
+		std::lock_guard<std::mutex> lock(mutex);
+
+		Publish(lastEntries);
+	}
+
+	// Moves a position from crop space into screen space, an atlas maps it through the piece it falls into
+	static void MoveToScreen(TranslationEntry* entry, const Crop& crop)
+	{
+		if (!crop.atlas.pieces.empty())
 		{
+			float x = entry->x / crop.scale;
+			float y = entry->y / crop.scale;
+			float w = entry->w / crop.scale;
+			float h = entry->h / crop.scale;
+
+			crop.atlas.ToScreen(&x, &y, &w, &h);
+
+			entry->x = int(x);
+			entry->y = int(y);
+			entry->w = w;
+			entry->h = h;
 			return;
 		}
 
-		std::vector<TranslationEntry> newEntries;
-		
-		try
+		entry->x = crop.x + int(entry->x / crop.scale);
+		entry->y = crop.y + int(entry->y / crop.scale);
+		entry->w /= crop.scale;
+		entry->h /= crop.scale;
+	}
+
+	// True when the server only recognizes the text and the translations come from the cache
+	static bool TranslatesLocally()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return UseTranslationCache && capabilities.ocrOnly;
+	}
+
+	static bool PostCrop(ITransport& transport, Crop& crop, bool ocrOnly, const ResponseSink& sink)
+	{
+		std::wstring headers = std::wstring(L"Content-Type: ") + ImageEncoder::GetContentType(crop.format);
+
+		if (ocrOnly)
+		{
+			headers += L"\r\nX-Translate: no";
+		}
+
+		// Servers that do not know the binary format ignore the header and answer with JSON
+		if (PreferBinaryResults)
+		{
+			headers += L"\r\nAccept: application/x-igt-results, application/json";
+		}
+
+		return transport.Send(
+			L"POST",
+			L"/",
+			headers,
+			crop.blob.GetBufferPointer(),
+			crop.blob.GetBufferSize(),
+			sink);
+	}
+
+	// Asks the server for the list of accepted capture formats.
+	// Servers without the endpoint are assumed to decode what OpenCV reads.
+	static void QueryCapabilities(ITransport& transport)
+	{
+		std::string body;
+		std::vector<std::string> formats = { "bmp", "png", "jpeg" };
+		bool ocrOnly = false;
+
+		ResponseSink collect = [&body](const char* data, size_t size)
+		{
+			body.append(data, size);
+			return true;
+		};
+
+		if (transport.Send(L"GET", L"/capabilities", L"", nullptr, 0, collect))
 		{
-			json parsed = json::parse(buffer);
+			try
+			{
+				json document = json::parse(body);
 
-			for (json& pe : parsed)
+				document.at("formats").get_to(formats);
+				ocrOnly = document.value("ocr_only", false);
+			}
+			catch (const json::exception& e)
 			{
-				TranslationEntry entry;
+				logger.Log("Invalid capabilities: %s", e.what());
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		capabilities.queried = true;
+		capabilities.formats = formats;
+		capabilities.ocrOnly = ocrOnly;
+	}
 
-				pe.at("message").get_to(entry.message);
-				pe.at("x").get_to(entry.x);
-				pe.at("y").get_to(entry.y);
-				pe.at("w").get_to(entry.w);
-				pe.at("h").get_to(entry.h);
-				pe.at("translation").get_to(entry.translation);
+	// Picks the preferred format when the server supports it, PNG otherwise
+	static CaptureFormat NegotiateFormat(CaptureFormat preferred)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
 
-				newEntries.push_back(entry);
+		if (capabilities.queried)
+		{
+			for (const std::string& format : capabilities.formats)
+			{
+				if (format == ImageEncoder::GetFormatName(preferred))
+				{
+					return preferred;
+				}
 			}
+		}
+		else if (preferred != CaptureFormat::Qoi)
+		{
+			return preferred;
+		}
 
-			ClearEntries();
-			PushEntries(newEntries);
+		return CaptureFormat::Png;
+	}
+
+	// Opens the translations of earlier sessions, called on the translate worker so the game does not wait for the disk
+	static void OpenTranslationStore()
+	{
+		if (!UseTranslationCache || !PersistTranslations)
+		{
+			return;
+		}
+
+		if (!translationStore.Open(TranslationStorePath))
+		{
+			logger.Log("Could not open the translation store, translations are not kept between sessions");
+			return;
+		}
+
+		if (translationStore.NeedsCompaction() && !translationStore.Compact())
+		{
+			logger.Log("Compacting the translation store failed");
 		}
-		catch (const json::parse_error& e)
+
+		logger.Log("Opened the translation store with %u translations", UINT(translationStore.GetCount()));
+	}
+
+	// The translation from the memory cache, or from the store on disk, which then also fills the memory cache
+	static const std::string* FindTranslation(const std::string& message)
+	{
+		const std::string* translation = translationCache.Find(message);
+
+		if (translation == nullptr && translationStore.IsOpen())
 		{
-			logger.Log("Error while parsing JSON: %s %s", buffer, e.what());
+			std::string key = TranslationCache::Normalize(message);
+			std::string stored;
+
+			if (translationStore.Find(key, &stored))
+			{
+				translationCache.Insert(key, stored);
+				translation = translationCache.Peek(key);
+			}
 		}
+
+		return translation;
 	}
 
-	static DWORD SendRequest(LPVOID pBlob)
+	// Keeps a received translation in memory and on disk
+	static void StoreTranslation(const std::string& key, const std::string& translation)
 	{
-		Blob* blob = (Blob*)pBlob;
-		DWORD size = 0;
-		DWORD received = 0;
-		LPSTR outBuffer;
-		BOOL responseReceving = FALSE;
+		translationCache.Insert(key, translation);
 
-		HINTERNET session = NULL;
-		HINTERNET connect = NULL;
-		HINTERNET request = NULL;
+		if (!translationStore.IsOpen())
+		{
+			return;
+		}
 
-		session = WinHttpOpen(
-			UserAgent,
-			WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-			WINHTTP_NO_PROXY_NAME,
-			WINHTTP_NO_PROXY_BYPASS,
-			0);
+		if (!translationStore.Append(key, translation))
+		{
+			logger.Log("Writing the translation store failed, closing it");
+			translationStore.Close();
+			return;
+		}
+	}
 
-		if (session)
+	// Compacts the store once enough was appended, called by the translate worker between requests
+	static void CompactTranslationStore()
+	{
+		if (!translationStore.IsOpen() || !translationStore.NeedsCompaction())
 		{
-			connect = WinHttpConnect(
-				session,
-				ServerAddress,
-				ServerPort,
-				0);
+			return;
 		}
 
-		if (connect)
+		if (!translationStore.Compact())
 		{
-			request = WinHttpOpenRequest(
-				connect,
-				L"POST",
-				L"/",
-				NULL,
-				WINHTTP_NO_REFERER,
-				WINHTTP_DEFAULT_ACCEPT_TYPES,
-				NULL);
+			logger.Log("Compacting the translation store failed");
 		}
+	}
+
+	// Fills in the translations the cache knows, returns false when some are missing
+	static bool FillFromCache(std::vector<TranslationEntry>& entries, size_t first)
+	{
+		bool complete = true;
 
-		if (request)
+		for (size_t i = first; i < entries.size(); i++)
 		{
-			LPVOID data = blob->GetBufferPointer();
-			DWORD dataSize = blob->GetBufferSize();
+			const std::string* translation = FindTranslation(entries[i].message);
 
-			responseReceving = WinHttpSendRequest(
-				request,
-				WINHTTP_NO_ADDITIONAL_HEADERS,
-				0,
-				data,
-				dataSize,
-				dataSize,
-				0);
+			if (translation != nullptr)
+			{
+				entries[i].translation = *translation;
+			}
+			else
+			{
+				complete = false;
+			}
 		}
 
-		if (responseReceving)
+		return complete;
+	}
+
+	// Sends the recognized text missing from the cache to the translator in one request, each string once,
+	// and fills in the entries from the response. Storing a large batch can evict translations from the cache,
+	// so the entries never read them back from it. The lookups were counted by FillFromCache already.
+	static bool TranslateMissing(ITransport& transport, std::vector<TranslationEntry>& entries)
+	{
+		json texts = json::array();
+		std::vector<std::string> keys;
+		// Index into keys of the translation each entry waits for, SIZE_MAX for the ones the cache filled in
+		std::vector<size_t> missing(entries.size());
+
+		for (size_t i = 0; i < entries.size(); i++)
 		{
-			responseReceving = WinHttpReceiveResponse(
-				request,
-				NULL);
+			std::string key = TranslationCache::Normalize(entries[i].message);
+			const std::string* cached = translationCache.Peek(key);
+
+			if (cached != nullptr)
+			{
+				entries[i].translation = *cached;
+				missing[i] = SIZE_MAX;
+				continue;
+			}
+
+			missing[i] = size_t(std::find(keys.begin(), keys.end(), key) - keys.begin());
+
+			if (missing[i] == keys.size())
+			{
+				texts.push_back(entries[i].message);
+				keys.push_back(key);
+			}
 		}
 
-		if (responseReceving)
+		if (!keys.empty())
 		{
-			do
+			std::string request = texts.dump();
+			std::string body;
+
+			ResponseSink collect = [&body](const char* data, size_t size)
 			{
-				size = 0;
+				body.append(data, size);
+				return true;
+			};
 
-				if (!WinHttpQueryDataAvailable(request, &size))
-				{
-					logger.Log("Error in WinHttpQueryDataAvailable: %u", GetLastError());
-					return 1;
-				}
+			if (!transport.Send(L"POST", L"/translate", L"Content-Type: application/json", request.data(), request.size(), collect))
+			{
+				return false;
+			}
 
-				outBuffer = new char[size + 1];
+			std::vector<std::string> translations;
 
-				if (!outBuffer)
+			try
+			{
+				json::parse(body).get_to(translations);
+			}
+			catch (const json::exception& e)
+			{
+				logger.Log("Invalid translations: %s", e.what());
+				return false;
+			}
+
+			if (translations.size() != keys.size())
+			{
+				logger.Log("Expected %u translations, received %u", UINT(keys.size()), UINT(translations.size()));
+				return false;
+			}
+
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				StoreTranslation(keys[i], translations[i]);
+			}
+
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				if (missing[i] != SIZE_MAX)
 				{
-					logger.Log("Out of memory");
-					size = 0;
+					entries[i].translation = translations[missing[i]];
 				}
-				else
+			}
+		}
+
+		const TranslationCache::Stats& stats = translationCache.GetStats();
+		logger.Log("Translated %u strings, cache hit rate %.1f%% (%llu hits, %llu misses, %u cached)",
+			UINT(keys.size()), translationCache.GetHitRate() * 100.0, stats.hits, stats.misses, UINT(translationCache.GetCount()));
+
+		return true;
+	}
+
+	// Caches the entries of every line of text that was sent, an entry belongs to the line holding its center
+	static void CacheTiles(const Request& request, const std::vector<TranslationEntry>& entries)
+	{
+		for (const Crop& crop : request.crops)
+		{
+			for (const Tile& tile : crop.tiles)
+			{
+				std::vector<TranslationEntry> inside;
+
+				for (const TranslationEntry& entry : entries)
 				{
-					RtlZeroMemory(outBuffer, size + 1);
+					int centerX = entry.x + int(entry.w / 2);
+					int centerY = entry.y + int(entry.h / 2);
 
-					if (!WinHttpReadData(request, (LPVOID)outBuffer, size, &received))
-					{
-						logger.Log("Error in WinHttpReadData: %u", GetLastError());
-						return 1;
-					}
-					else
+					if (centerX >= tile.rect.x && centerX < tile.rect.Right() && centerY >= tile.rect.y && centerY < tile.rect.Bottom())
 					{
-						logger.Log("Response received from server: %s", outBuffer);
-						ParseResponse(outBuffer, size);
+						inside.push_back(entry);
 					}
-
-					delete[] outBuffer;
 				}
-			} while (size > 0);
+
+				tileCache.Insert(tile, std::move(inside));
+			}
 		}
+	}
 
-		delete blob;
+	// Sends every crop of the request over the transport and shows the merged result.
+	// Responses are parsed while they arrive, with ShowPartialResults the entries are shown as soon as they are complete.
+	// Stops early when the request gets superseded and CancelSupersededRequests is set.
+	// When the translations come from the cache, the server is only asked for those it does not know.
+	static bool SendRequest(ITransport& transport, Request& request)
+	{
+		std::vector<TranslationEntry> newEntries = request.cachedEntries;
+		bool ocrOnly = TranslatesLocally();
 
-		if (!responseReceving)
+		for (Crop& crop : request.crops)
 		{
-			logger.Log("Error has occurred: %u", GetLastError());
-			return 1;
+			if (CancelSupersededRequests && IsSuperseded(request))
+			{
+				logger.Log("Request %llu superseded, cancelling", request.sequence);
+				return false;
+			}
+
+			ResponseParser parser;
+			size_t first = newEntries.size();
+
+			ResponseSink parse = [&](const char* data, size_t size)
+			{
+				size_t parsed = newEntries.size();
+
+				if (!parser.Feed(data, size, &newEntries))
+				{
+					return false;
+				}
+
+				for (size_t i = parsed; i < newEntries.size(); i++)
+				{
+					MoveToScreen(&newEntries[i], crop);
+				}
+
+				if (ocrOnly)
+				{
+					FillFromCache(newEntries, parsed);
+				}
+
+				if (ShowPartialResults && newEntries.size() > parsed)
+				{
+					PreviewEntries(request, newEntries);
+				}
+
+				return !(CancelSupersededRequests && IsSuperseded(request));
+			};
+
+			if (!PostCrop(transport, crop, ocrOnly, parse))
+			{
+				if (parser.HasFailed())
+				{
+					logger.Log("Malformed response for request %llu", request.sequence);
+				}
+
+				return false;
+			}
+
+			if (!parser.Finish(&newEntries))
+			{
+				logger.Log("Incomplete response for request %llu", request.sequence);
+				return false;
+			}
+
+			logger.Log("Received %u entries for request %llu", UINT(newEntries.size() - first), request.sequence);
+		}
+
+		if (ocrOnly && !TranslateMissing(transport, newEntries))
+		{
+			logger.Log("Translating request %llu failed", request.sequence);
+			return false;
 		}
 
-		if (request) WinHttpCloseHandle(request);
-		if (connect) WinHttpCloseHandle(connect);
-		if (session) WinHttpCloseHandle(session);
+		if (UseTileCache)
+		{
+			CacheTiles(request, newEntries);
+		}
 
-		return 0;
+		return PushEntries(request, newEntries);
 	}
 }
\ No newline at end of file
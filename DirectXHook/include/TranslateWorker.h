@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Windows.h>
+#include <memory>
+#include <mutex>
+
+#include "Config.h"
+#include "Logger.h"
+#include "RequestSequencer.h"
+#include "TranslateClient.h"
+#include "BalancedTransport.h"
+
+// Long-lived thread that owns the connections to the servers and sends requests one after another.
+// The latest request of a kind wins (see LatestRequestQueue), superseded requests are cancelled in flight
+// with CancelSupersededRequests.
+class TranslateWorker
+{
+public:
+	// Starts the thread, the translation store is opened and the server capabilities are queried before the first request is sent
+	void Start();
+	// Queues the request, returns the number of older requests of its kind that were dropped or cancelled
+	int Post(std::unique_ptr<TranslateClient::Request> request);
+	// Requests waiting in the queue or being sent
+	int GetPendingCount();
+
+private:
+	Logger logger{ "TranslateWorker" };
+
+	std::mutex mutex;
+	bool started = false;
+
+	BalancedTransport transport;
+	LatestRequestQueue<TranslateClient::Request> queue{ &transport, CancelSupersededRequests };
+
+	static DWORD WINAPI ThreadMain(LPVOID pWorker);
+	void Run();
+};
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Translations of recognized text seen before, so repeated strings (menus, item names, dialogue shown again)
+// are not sent to the translator every scan. Keys are the recognized text with its whitespace normalized.
+// The table uses open addressing with linear probing over node indices, the nodes form an LRU list
+// and the least recently used ones are evicted once the cache holds more than maxBytes.
+// Not thread safe, the translate worker is its only user.
+class TranslationCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t insertions = 0;
+		uint64_t evictions = 0;
+	};
+
+	explicit TranslationCache(size_t maxBytes) : maxBytes(maxBytes)
+	{
+	}
+
+	// Trims the text and collapses runs of whitespace into one space, OCR output varies in both
+	static std::string Normalize(const std::string& text)
+	{
+		std::string normalized;
+		bool space = false;
+
+		normalized.reserve(text.size());
+
+		for (char character : text)
+		{
+			if (character == ' ' || (character >= '\t' && character <= '\r'))
+			{
+				space = !normalized.empty();
+				continue;
+			}
+
+			if (space)
+			{
+				normalized += ' ';
+				space = false;
+			}
+
+			normalized += character;
+		}
+
+		return normalized;
+	}
+
+	// The cached translation of the text, nullptr when there is none. A hit makes the entry the most recently used.
+	// The pointer stays valid until the next Insert.
+	const std::string* Find(const std::string& text)
+	{
+		std::string key = Normalize(text);
+		uint32_t node = FindNode(key, Hash(key));
+
+		if (node == None)
+		{
+			stats.misses++;
+			return nullptr;
+		}
+
+		stats.hits++;
+		MoveToFront(node);
+
+		return &nodes[node].translation;
+	}
+
+	// Like Find, but neither counted in the stats nor changing the eviction order
+	const std::string* Peek(const std::string& text) const
+	{
+		std::string key = Normalize(text);
+		uint32_t node = FindNode(key, Hash(key));
+
+		return node == None ? nullptr : &nodes[node].translation;
+	}
+
+	void Insert(const std::string& text, const std::string& translation)
+	{
+		std::string key = Normalize(text);
+		size_t hash = Hash(key);
+		uint32_t node = FindNode(key, hash);
+
+		if (node != None)
+		{
+			bytes -= nodes[node].translation.size();
+			nodes[node].translation = translation;
+			bytes += translation.size();
+			MoveToFront(node);
+			Evict();
+			return;
+		}
+
+		if (NodeSize(key, translation) > maxBytes)
+		{
+			return;
+		}
+
+		if ((count + 1) * 2 > table.size())
+		{
+			Grow();
+		}
+
+		node = AllocateNode();
+		nodes[node].key = std::move(key);
+		nodes[node].translation = translation;
+		nodes[node].hash = hash;
+
+		size_t slot = hash & (table.size() - 1);
+
+		while (table[slot] != None)
+		{
+			slot = (slot + 1) & (table.size() - 1);
+		}
+
+		table[slot] = node;
+		count++;
+		bytes += NodeSize(nodes[node].key, nodes[node].translation);
+		stats.insertions++;
+
+		LinkFront(node);
+		Evict();
+	}
+
+	void Clear()
+	{
+		nodes.clear();
+		table.clear();
+		head = tail = freeNodes = None;
+		count = 0;
+		bytes = 0;
+	}
+
+	size_t GetCount() const
+	{
+		return count;
+	}
+
+	// Memory held by the entries as accounted against maxBytes
+	size_t GetBytes() const
+	{
+		return bytes;
+	}
+
+	const Stats& GetStats() const
+	{
+		return stats;
+	}
+
+	// Share of lookups that were hits, 0 before the first lookup
+	double GetHitRate() const
+	{
+		uint64_t lookups = stats.hits + stats.misses;
+
+		return lookups == 0 ? 0.0 : double(stats.hits) / double(lookups);
+	}
+
+private:
+	static constexpr uint32_t None = UINT32_MAX;
+	static constexpr size_t InitialSlots = 64;
+
+	struct Node
+	{
+		std::string key;
+		std::string translation;
+		size_t hash = 0;
+		// Neighbours in the LRU list, next also links the free nodes
+		uint32_t prev = None;
+		uint32_t next = None;
+	};
+
+	size_t maxBytes;
+	std::vector<Node> nodes;
+	// Node index per slot, kept at most half full
+	std::vector<uint32_t> table;
+	uint32_t head = None;
+	uint32_t tail = None;
+	uint32_t freeNodes = None;
+	size_t count = 0;
+	size_t bytes = 0;
+	Stats stats;
+
+	static size_t Hash(const std::string& key)
+	{
+		return std::hash<std::string>()(key);
+	}
+
+	static size_t NodeSize(const std::string& key, const std::string& translation)
+	{
+		return sizeof(Node) + 2 * sizeof(uint32_t) + key.size() + translation.size();
+	}
+
+	uint32_t FindNode(const std::string& key, size_t hash) const
+	{
+		if (table.empty())
+		{
+			return None;
+		}
+
+		for (size_t slot = hash & (table.size() - 1); table[slot] != None; slot = (slot + 1) & (table.size() - 1))
+		{
+			const Node& node = nodes[table[slot]];
+
+			if (node.hash == hash && node.key == key)
+			{
+				return table[slot];
+			}
+		}
+
+		return None;
+	}
+
+	void Grow()
+	{
+		std::vector<uint32_t> old = std::move(table);
+
+		table.assign(old.empty() ? InitialSlots : old.size() * 2, None);
+
+		for (uint32_t node : old)
+		{
+			if (node == None)
+			{
+				continue;
+			}
+
+			size_t slot = nodes[node].hash & (table.size() - 1);
+
+			while (table[slot] != None)
+			{
+				slot = (slot + 1) & (table.size() - 1);
+			}
+
+			table[slot] = node;
+		}
+	}
+
+	uint32_t AllocateNode()
+	{
+		if (freeNodes == None)
+		{
+			nodes.emplace_back();
+			return uint32_t(nodes.size() - 1);
+		}
+
+		uint32_t node = freeNodes;
+		freeNodes = nodes[node].next;
+
+		return node;
+	}
+
+	// Drops the least recently used entries until the cache is within its budget
+	void Evict()
+	{
+		while (bytes > maxBytes && tail != None)
+		{
+			Remove(tail);
+			stats.evictions++;
+		}
+	}
+
+	// Takes the node out of the table by shifting the entries of its probe run back, no tombstones are left
+	void Remove(uint32_t node)
+	{
+		size_t mask = table.size() - 1;
+		size_t slot = nodes[node].hash & mask;
+
+		while (table[slot] != node)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		for (size_t next = (slot + 1) & mask; table[next] != None; next = (next + 1) & mask)
+		{
+			size_t home = nodes[table[next]].hash & mask;
+
+			// The entry may move into the hole unless its home slot lies cyclically within (slot, next]
+			bool movable = slot <= next ? (home <= slot || home > next) : (home <= slot && home > next);
+
+			if (movable)
+			{
+				table[slot] = table[next];
+				slot = next;
+			}
+		}
+
+		table[slot] = None;
+
+		Unlink(node);
+		bytes -= NodeSize(nodes[node].key, nodes[node].translation);
+		count--;
+
+		nodes[node].key = std::string();
+		nodes[node].translation = std::string();
+		nodes[node].next = freeNodes;
+		freeNodes = node;
+	}
+
+	void LinkFront(uint32_t node)
+	{
+		nodes[node].prev = None;
+		nodes[node].next = head;
+
+		if (head != None)
+		{
+			nodes[head].prev = node;
+		}
+
+		head = node;
+
+		if (tail == None)
+		{
+			tail = node;
+		}
+	}
+
+	void Unlink(uint32_t node)
+	{
+		if (nodes[node].prev != None)
+		{
+			nodes[nodes[node].prev].next = nodes[node].next;
+		}
+		else
+		{
+			head = nodes[node].next;
+		}
+
+		if (nodes[node].next != None)
+		{
+			nodes[nodes[node].next].prev = nodes[node].prev;
+		}
+		else
+		{
+			tail = nodes[node].prev;
+		}
+	}
+
+	void MoveToFront(uint32_t node)
+	{
+		if (head != node)
+		{
+			Unlink(node);
+			LinkFront(node);
+		}
+	}
+};
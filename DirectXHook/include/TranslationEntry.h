@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace TranslateClient
+{
+	// A recognized line of text and its translation, positioned in screen space
+	struct TranslationEntry {
+		int x;
+		int y;
+		float w;
+		float h;
+		std::string translation;
+		std::string message;
+	};
+}
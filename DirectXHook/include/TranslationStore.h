@@ -0,0 +1,468 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Translations kept on disk between game sessions, so a new session starts with the strings seen before.
+//
+// The file is a header, a hash index and the records written at the last compaction, followed by the records
+// appended since then:
+//   header   "IGTSTORE", u32 version, u32 index slots, u64 end of the indexed records, u64 indexed record count
+//   index    u64 file offset of a record per slot, 0 for an empty slot, linear probing by Hash of the key
+//   record   u32 key size, u32 translation size, u32 checksum of sizes, key and translation, then the bytes
+// Opening maps the file and uses the index in place, only the appended records are read, so startup does not
+// depend on the number of indexed records. A record cut short by a crash fails its checksum and is truncated
+// away on the next open, an indexed record that fails it is treated as missing. Compact rewrites the file with
+// every record indexed, flushes it to the disk and replaces the old one by rename.
+// Keys are stored as given, the client passes them normalized. Not thread safe.
+class TranslationStore
+{
+public:
+	TranslationStore() = default;
+	TranslationStore(const TranslationStore&) = delete;
+	TranslationStore& operator=(const TranslationStore&) = delete;
+
+	// Opens the store, an empty one is created when the file does not exist or is shorter than its header.
+	// False when the file is not a store or could not be opened.
+	bool Open(const std::filesystem::path& storePath)
+	{
+		Close();
+		path = storePath;
+
+		std::error_code error;
+
+		if (!std::filesystem::exists(path, error) || std::filesystem::file_size(path, error) < HeaderSize)
+		{
+			if (!WriteStore(path, {}))
+			{
+				return false;
+			}
+		}
+
+		if (!Map())
+		{
+			Close();
+			return false;
+		}
+
+		size_t end = ReadAppended();
+
+		// A crash in the middle of an append leaves a partial record behind, it is cut off before appending again
+		if (end < file.GetSize())
+		{
+			file.Close();
+			std::filesystem::resize_file(path, end, error);
+
+			if (error || !Map() || ReadAppended() != file.GetSize())
+			{
+				Close();
+				return false;
+			}
+		}
+
+		appender.open(path, std::ios::binary | std::ios::app);
+
+		if (!appender)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void Close()
+	{
+		appender.close();
+		appender.clear();
+		file.Close();
+		appended.clear();
+		indexSlots = 0;
+		indexedEnd = 0;
+		indexedCount = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return file.IsOpen();
+	}
+
+	bool Find(const std::string& key, std::string* translation) const
+	{
+		auto found = appended.find(key);
+
+		if (found != appended.end())
+		{
+			*translation = found->second;
+			return true;
+		}
+
+		if (indexSlots == 0)
+		{
+			return false;
+		}
+
+		const uint8_t* data = file.GetData();
+		size_t mask = indexSlots - 1;
+
+		size_t slot = Hash(key) & mask;
+
+		// A full index has no empty slot to stop at, a damaged file may have one, so the search ends after one round
+		for (uint32_t probe = 0; probe < indexSlots; probe++, slot = (slot + 1) & mask)
+		{
+			uint64_t offset = ReadU64(data + HeaderSize + slot * 8);
+
+			if (offset == 0)
+			{
+				return false;
+			}
+
+			Record record;
+
+			// A damaged index or record reads as a missing translation, it is asked for again
+			if (offset < HeaderSize + uint64_t(indexSlots) * 8 || !ReadRecord(offset, indexedEnd, &record))
+			{
+				return false;
+			}
+
+			if (record.keySize == key.size() && memcmp(record.bytes, key.data(), record.keySize) == 0)
+			{
+				translation->assign(record.bytes + record.keySize, record.translationSize);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Writes the record to the end of the file. A later record of the same key replaces the earlier one.
+	bool Append(const std::string& key, const std::string& translation)
+	{
+		if (!IsOpen())
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> record;
+		AppendRecord(record, key, translation);
+
+		appender.write((const char*)record.data(), record.size());
+		appender.flush();
+
+		if (!appender)
+		{
+			return false;
+		}
+
+		appended[key] = translation;
+
+		return true;
+	}
+
+	// True once enough records were appended that reading them dominates opening the store
+	bool NeedsCompaction() const
+	{
+		return appended.size() >= CompactionMinRecords && appended.size() * 4 >= indexedCount;
+	}
+
+	// Rewrites the store with all records in the index and without replaced ones
+	bool Compact()
+	{
+		if (!IsOpen())
+		{
+			return false;
+		}
+
+		std::unordered_map<std::string, std::string> records = appended;
+		uint64_t offset = HeaderSize + uint64_t(indexSlots) * 8;
+		Record record;
+
+		// The indexed records after a damaged one are lost, the rest is kept
+		while (offset < indexedEnd && ReadRecord(offset, indexedEnd, &record))
+		{
+			records.emplace(std::string(record.bytes, record.keySize), std::string(record.bytes + record.keySize, record.translationSize));
+			offset += RecordHeaderSize + uint64_t(record.keySize) + record.translationSize;
+		}
+
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+
+		if (!WriteStore(temporary, records))
+		{
+			return false;
+		}
+
+		std::filesystem::path storePath = path;
+		std::error_code error;
+
+		// The view has to go first, Windows does not replace a mapped file
+		Close();
+		std::filesystem::rename(temporary, storePath, error);
+
+		return Open(storePath) && !error;
+	}
+
+	// Records in the store, replaced records of the same key are counted until the next compaction
+	size_t GetCount() const
+	{
+		return size_t(indexedCount) + appended.size();
+	}
+
+	size_t GetAppendedCount() const
+	{
+		return appended.size();
+	}
+
+	// FNV-1a, the index is stored on disk so the hash has to be the same in every build
+	static uint64_t Hash(const std::string& key)
+	{
+		return Fnv1a(0xcbf29ce484222325ull, (const uint8_t*)key.data(), key.size());
+	}
+
+private:
+	static constexpr char Magic[] = "IGTSTORE";
+	static constexpr uint32_t Version = 1;
+	static constexpr size_t HeaderSize = 32;
+	static constexpr size_t RecordHeaderSize = 12;
+	static constexpr size_t CompactionMinRecords = 1024;
+
+	// A record of the mapped file, checked against its checksum
+	struct Record
+	{
+		uint32_t keySize = 0;
+		uint32_t translationSize = 0;
+		const char* bytes = nullptr;
+	};
+
+	std::filesystem::path path;
+	MappedFile file;
+	std::ofstream appender;
+	// Records after the indexed ones, read when the store is opened
+	std::unordered_map<std::string, std::string> appended;
+	uint32_t indexSlots = 0;
+	uint64_t indexedEnd = 0;
+	uint64_t indexedCount = 0;
+
+	static uint64_t Fnv1a(uint64_t hash, const uint8_t* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ data[i]) * 0x100000001b3ull;
+		}
+
+		return hash;
+	}
+
+	static uint32_t Checksum(const uint8_t* sizes, const char* bytes, size_t size)
+	{
+		uint64_t hash = Fnv1a(0xcbf29ce484222325ull, sizes, 8);
+		hash = Fnv1a(hash, (const uint8_t*)bytes, size);
+
+		return uint32_t(hash ^ (hash >> 32));
+	}
+
+	static uint32_t ReadU32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+	}
+
+	static uint64_t ReadU64(const uint8_t* data)
+	{
+		return uint64_t(ReadU32(data)) | uint64_t(ReadU32(data + 4)) << 32;
+	}
+
+	static void WriteU32(uint8_t* data, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			data[i] = uint8_t(value >> (i * 8));
+		}
+	}
+
+	static void WriteU64(uint8_t* data, uint64_t value)
+	{
+		WriteU32(data, uint32_t(value));
+		WriteU32(data + 4, uint32_t(value >> 32));
+	}
+
+	static void AppendRecord(std::vector<uint8_t>& target, const std::string& key, const std::string& translation)
+	{
+		size_t offset = target.size();
+
+		target.resize(offset + RecordHeaderSize);
+		WriteU32(&target[offset], uint32_t(key.size()));
+		WriteU32(&target[offset + 4], uint32_t(translation.size()));
+		target.insert(target.end(), key.begin(), key.end());
+		target.insert(target.end(), translation.begin(), translation.end());
+
+		const char* bytes = (const char*)&target[offset + RecordHeaderSize];
+		WriteU32(&target[offset + 8], Checksum(&target[offset], bytes, key.size() + translation.size()));
+	}
+
+	// Writes a complete store with every record indexed
+	static bool WriteStore(const std::filesystem::path& target, const std::unordered_map<std::string, std::string>& records)
+	{
+		uint32_t slots = 0;
+
+		if (!records.empty())
+		{
+			// At most half full
+			slots = 1;
+
+			while (slots < records.size() * 2)
+			{
+				slots *= 2;
+			}
+		}
+
+		std::vector<uint8_t> data(HeaderSize + size_t(slots) * 8, 0);
+
+		for (const auto& record : records)
+		{
+			size_t offset = data.size();
+			size_t slot = Hash(record.first) & (slots - 1);
+
+			while (ReadU64(&data[HeaderSize + slot * 8]) != 0)
+			{
+				slot = (slot + 1) & (slots - 1);
+			}
+
+			WriteU64(&data[HeaderSize + slot * 8], offset);
+			AppendRecord(data, record.first, record.second);
+		}
+
+		memcpy(data.data(), Magic, 8);
+		WriteU32(&data[8], Version);
+		WriteU32(&data[12], slots);
+		WriteU64(&data[16], data.size());
+		WriteU64(&data[24], records.size());
+
+		return WriteDurably(target, data);
+	}
+
+	// Writes the file and waits until it is on the disk, so a compacted store never replaces the old one
+	// while its bytes are still in the cache of the system
+	static bool WriteDurably(const std::filesystem::path& target, const std::vector<uint8_t>& data)
+	{
+#ifdef _WIN32
+		HANDLE output = CreateFileW(target.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+		if (output == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		DWORD written = 0;
+		bool succeeded = (data.empty() || ::WriteFile(output, data.data(), DWORD(data.size()), &written, NULL))
+			&& written == data.size()
+			&& FlushFileBuffers(output);
+
+		CloseHandle(output);
+#else
+		int output = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+		if (output < 0)
+		{
+			return false;
+		}
+
+		size_t written = 0;
+
+		while (written < data.size())
+		{
+			ssize_t count = write(output, data.data() + written, data.size() - written);
+
+			if (count <= 0)
+			{
+				break;
+			}
+
+			written += size_t(count);
+		}
+
+		bool succeeded = written == data.size() && fsync(output) == 0;
+
+		close(output);
+#endif
+
+		return succeeded;
+	}
+
+	// Maps the file and checks the header and index against its size
+	bool Map()
+	{
+		if (!file.Open(path) || file.GetSize() < HeaderSize)
+		{
+			return false;
+		}
+
+		const uint8_t* data = file.GetData();
+
+		if (memcmp(data, Magic, 8) != 0 || ReadU32(data + 8) != Version)
+		{
+			return false;
+		}
+
+		indexSlots = ReadU32(data + 12);
+		indexedEnd = ReadU64(data + 16);
+		indexedCount = ReadU64(data + 24);
+
+		bool powerOfTwo = (indexSlots & (indexSlots - 1)) == 0;
+
+		return powerOfTwo && HeaderSize + uint64_t(indexSlots) * 8 <= indexedEnd && indexedEnd <= file.GetSize();
+	}
+
+	// Reads the records appended after the indexed ones, returns where the last complete record ends
+	size_t ReadAppended()
+	{
+		size_t size = file.GetSize();
+		size_t offset = size_t(indexedEnd);
+
+		appended.clear();
+
+		Record record;
+
+		while (ReadRecord(offset, size, &record))
+		{
+			appended[std::string(record.bytes, record.keySize)] = std::string(record.bytes + record.keySize, record.translationSize);
+			offset += RecordHeaderSize + size_t(record.keySize) + record.translationSize;
+		}
+
+		return offset;
+	}
+
+	// Reads the record at offset, false when it does not end before end or fails its checksum
+	bool ReadRecord(uint64_t offset, uint64_t end, Record* record) const
+	{
+		const uint8_t* data = file.GetData();
+
+		if (offset > end || end - offset < RecordHeaderSize)
+		{
+			return false;
+		}
+
+		uint32_t keySize = ReadU32(data + offset);
+		uint32_t translationSize = ReadU32(data + offset + 4);
+		const char* bytes = (const char*)data + offset + RecordHeaderSize;
+
+		if (uint64_t(keySize) + translationSize > end - offset - RecordHeaderSize
+			|| Checksum(data + offset, bytes, size_t(keySize) + translationSize) != ReadU32(data + offset + 8))
+		{
+			return false;
+		}
+
+		record->keySize = keySize;
+		record->translationSize = translationSize;
+		record->bytes = bytes;
+
+		return true;
+	}
+};
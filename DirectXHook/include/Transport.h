@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Receives the response body chunk by chunk as it arrives, returning false aborts the transfer
+using ResponseSink = std::function<bool(const char* data, size_t size)>;
+
+// Request/response channel to the translation server. The client only talks to this interface,
+// the connection handling lives in the implementation (WinHttpTransport).
+class ITransport
+{
+public:
+	virtual ~ITransport() {}
+
+	// Sends one request and streams the body of a 200 response into sink, true when all of it was received
+	virtual bool Send(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink) = 0;
+
+	// Drops the connection, the next Send opens a new one
+	virtual void Close() = 0;
+
+	// Called by the owner before the Sends of a new request, forgets the Cancel of the previous one
+	virtual void BeginAttempt() = 0;
+
+	// Called from another thread, makes a Send in progress return false as soon as possible.
+	// It sticks until the next BeginAttempt, a Send that had not started yet returns false right away.
+	virtual void Cancel() = 0;
+};
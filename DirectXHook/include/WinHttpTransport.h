@@ -0,0 +1,283 @@
+#pragma once
+
+#include <Windows.h>
+#include <winhttp.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Logger.h"
+#include "Transport.h"
+
+#pragma comment(lib, "winhttp.lib")
+
+// Keeps one WinHTTP session and connection open for the lifetime of the client.
+// WinHTTP pools the socket behind them, so consecutive requests reuse the same keep-alive connection
+// instead of paying for a new TCP handshake each time. Owned by a single worker, only Cancel may be
+// called from other threads.
+class WinHttpTransport : public ITransport
+{
+public:
+	// timeoutMs limits connecting, sending and waiting for the response, 0 keeps the WinHTTP defaults
+	explicit WinHttpTransport(const ServerEndpoint& endpoint = Servers[0], int timeoutMs = 0)
+		: address(endpoint.address), port(endpoint.port), timeoutMs(timeoutMs)
+	{
+	}
+
+	~WinHttpTransport()
+	{
+		Close();
+	}
+
+	bool Send(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink) override
+	{
+		bool connectionFailed = false;
+
+		if (Open() && SendOnce(verb, path, headers, data, dataSize, sink, &connectionFailed))
+		{
+			return true;
+		}
+
+		// The server may have closed the idle connection, one retry on a fresh one
+		if (connectionFailed && !cancelled)
+		{
+			Close();
+
+			return Open() && SendOnce(verb, path, headers, data, dataSize, sink, &connectionFailed);
+		}
+
+		return false;
+	}
+
+	void BeginAttempt() override
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+
+		cancelled = false;
+	}
+
+	void Cancel() override
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+
+		cancelled = true;
+
+		// Closing the handle of a synchronous request makes the pending WinHTTP call fail
+		if (activeRequest)
+		{
+			WinHttpCloseHandle(activeRequest);
+			activeRequest = NULL;
+		}
+	}
+
+	void Close() override
+	{
+		if (connect) WinHttpCloseHandle(connect);
+		if (session) WinHttpCloseHandle(session);
+
+		connect = NULL;
+		session = NULL;
+	}
+
+private:
+	Logger logger{ "WinHttpTransport" };
+	std::wstring address;
+	INTERNET_PORT port;
+	int timeoutMs;
+	HINTERNET session = NULL;
+	HINTERNET connect = NULL;
+
+	std::mutex requestMutex;
+	HINTERNET activeRequest = NULL;
+	std::atomic<bool> cancelled = false;
+	std::vector<char> receiveBuffer;
+
+	bool Open()
+	{
+		if (connect)
+		{
+			return true;
+		}
+
+		session = WinHttpOpen(
+			UserAgent,
+			WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+			WINHTTP_NO_PROXY_NAME,
+			WINHTTP_NO_PROXY_BYPASS,
+			0);
+
+		if (session && timeoutMs > 0)
+		{
+			WinHttpSetTimeouts(session, timeoutMs, timeoutMs, timeoutMs, timeoutMs);
+		}
+
+		if (session)
+		{
+			connect = WinHttpConnect(
+				session,
+				address.c_str(),
+				port,
+				0);
+		}
+
+		if (!connect)
+		{
+			logger.Log("Failed to connect to %ls:%u: %u", address.c_str(), UINT(port), GetLastError());
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	bool SendOnce(
+		const wchar_t* verb,
+		const wchar_t* path,
+		const std::wstring& headers,
+		const void* data,
+		size_t dataSize,
+		const ResponseSink& sink,
+		bool* connectionFailed)
+	{
+		BOOL responseReceving = FALSE;
+		DWORD statusCode = 0;
+		DWORD statusCodeSize = sizeof(statusCode);
+
+		*connectionFailed = false;
+
+		HINTERNET request = WinHttpOpenRequest(
+			connect,
+			verb,
+			path,
+			NULL,
+			WINHTTP_NO_REFERER,
+			WINHTTP_DEFAULT_ACCEPT_TYPES,
+			NULL);
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			// Cancelled before the request existed, Cancel had nothing to close
+			if (cancelled)
+			{
+				if (request) WinHttpCloseHandle(request);
+				return false;
+			}
+
+			activeRequest = request;
+		}
+
+		if (request)
+		{
+			responseReceving = WinHttpSendRequest(
+				request,
+				headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : headers.c_str(),
+				headers.empty() ? 0 : (DWORD)-1L,
+				(LPVOID)data,
+				(DWORD)dataSize,
+				(DWORD)dataSize,
+				0);
+		}
+
+		if (responseReceving)
+		{
+			responseReceving = WinHttpReceiveResponse(
+				request,
+				NULL);
+		}
+
+		if (responseReceving)
+		{
+			responseReceving = WinHttpQueryHeaders(
+				request,
+				WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+				WINHTTP_HEADER_NAME_BY_INDEX,
+				&statusCode,
+				&statusCodeSize,
+				WINHTTP_NO_HEADER_INDEX);
+		}
+
+		if (responseReceving && statusCode != 200)
+		{
+			logger.Log("Server answered with status %u", statusCode);
+			responseReceving = FALSE;
+		}
+		else if (responseReceving)
+		{
+			responseReceving = ReadResponse(request, sink);
+		}
+		else
+		{
+			DWORD error = GetLastError();
+			logger.Log("Error has occurred: %u", error);
+
+			*connectionFailed = error == ERROR_WINHTTP_CONNECTION_ERROR ||
+				error == ERROR_WINHTTP_CANNOT_CONNECT ||
+				error == ERROR_WINHTTP_INVALID_SERVER_RESPONSE;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+
+			// A cancelled request was already closed by Cancel
+			if (activeRequest) WinHttpCloseHandle(activeRequest);
+			activeRequest = NULL;
+
+			if (cancelled)
+			{
+				return false;
+			}
+		}
+
+		return responseReceving;
+	}
+
+	// Hands every chunk to the sink as soon as WinHTTP has it, the receive buffer is reused between chunks
+	bool ReadResponse(HINTERNET request, const ResponseSink& sink)
+	{
+		DWORD size = 0;
+		DWORD received = 0;
+
+		do
+		{
+			size = 0;
+
+			if (!WinHttpQueryDataAvailable(request, &size))
+			{
+				logger.Log("Error in WinHttpQueryDataAvailable: %u", GetLastError());
+				return false;
+			}
+
+			if (size == 0)
+			{
+				break;
+			}
+
+			if (receiveBuffer.size() < size)
+			{
+				receiveBuffer.resize(size);
+			}
+
+			if (!WinHttpReadData(request, (LPVOID)receiveBuffer.data(), size, &received))
+			{
+				logger.Log("Error in WinHttpReadData: %u", GetLastError());
+				return false;
+			}
+
+			if (!sink(receiveBuffer.data(), received))
+			{
+				return false;
+			}
+		} while (size > 0);
+
+		return true;
+	}
+};
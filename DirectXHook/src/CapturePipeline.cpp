@@ -0,0 +1,689 @@
+#include "CapturePipeline.h"
+
+using namespace DirectX;
+
+void CapturePipeline::Start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (started)
+	{
+		return;
+	}
+
+	started = true;
+	translateWorker.Start();
+	CreateThread(0, 0, &CapturePipeline::ThreadMain, this, 0, NULL);
+}
+
+void CapturePipeline::Submit(CapturedFrame&& frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// Band captures arrive every frame, one of them does not push out a scan that is still waiting
+		if (!queue.empty() && frame.kind == CaptureKind::Subtitle && queue.front().kind != CaptureKind::Subtitle)
+		{
+			bufferPool.push_back(std::move(frame.pixels));
+			return;
+		}
+
+		if (!queue.empty())
+		{
+			if (queue.front().kind != CaptureKind::Subtitle)
+			{
+				logger.Log("Dropping frame %llu, a newer one arrived", queue.front().frame);
+			}
+
+			bufferPool.push_back(std::move(queue.front().pixels));
+			queue.clear();
+		}
+
+		queue.push_back(std::move(frame));
+	}
+
+	wakeUp.notify_one();
+}
+
+std::vector<uint8_t> CapturePipeline::AcquireBuffer(size_t size)
+{
+	std::vector<uint8_t> buffer;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (!bufferPool.empty())
+		{
+			buffer = std::move(bufferPool.back());
+			bufferPool.pop_back();
+		}
+	}
+
+	buffer.resize(size);
+
+	return buffer;
+}
+
+bool CapturePipeline::IsSampleDue()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return autoPolicy.ShouldSample(GetTimeMs());
+}
+
+bool CapturePipeline::GetSubtitleBand(int width, int height, ImageRect* band)
+{
+	if (SubtitleBandSource == SubtitleBandMode::Fixed)
+	{
+		*band = SubtitleBand::FromFractions(width, height, SubtitleBandTop, SubtitleBandBottom);
+		return band->Area() > 0;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	*band = detectedBand;
+
+	return detectedBand.Area() > 0;
+}
+
+uint64_t CapturePipeline::GetTimeMs()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CapturePipeline::RecycleBuffer(std::vector<uint8_t>&& buffer)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Two buffers cover the frame being processed and the one waiting for it
+	if (bufferPool.size() < 2)
+	{
+		bufferPool.push_back(std::move(buffer));
+	}
+}
+
+DWORD WINAPI CapturePipeline::ThreadMain(LPVOID pPipeline)
+{
+	// WIC encoders are created through COM
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	((CapturePipeline*)pPipeline)->Run();
+
+	return 0;
+}
+
+void CapturePipeline::Run()
+{
+	while (true)
+	{
+		CapturedFrame frame;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this] { return !queue.empty(); });
+
+			frame = std::move(queue.front());
+			queue.clear();
+		}
+
+		Process(frame);
+		RecycleBuffer(std::move(frame.pixels));
+	}
+}
+
+void CapturePipeline::Process(CapturedFrame& frame)
+{
+	Image image = {};
+	image.width = frame.width;
+	image.height = frame.height;
+	image.format = frame.format;
+	image.rowPitch = frame.rowPitch;
+	image.slicePitch = frame.rowPitch * frame.height;
+	image.pixels = frame.pixels.data();
+
+	if (frame.kind == CaptureKind::Subtitle)
+	{
+		ProcessSubtitle(&image, frame);
+		return;
+	}
+
+	if (frame.kind == CaptureKind::BandDetection)
+	{
+		DetectSubtitleBand(&image);
+		return;
+	}
+
+	std::unique_ptr<TranslateClient::Request> request = std::make_unique<TranslateClient::Request>();
+	bool automatic = frame.kind == CaptureKind::Automatic;
+	bool unchanged = false;
+
+	if (CreateRequest(&image, automatic, request.get(), &unchanged))
+	{
+		request->kind = frame.kind;
+		request->sequence = TranslateClient::NextSequence(frame.kind);
+		translateWorker.Post(std::move(request));
+		return;
+	}
+
+	if (unchanged && !automatic)
+	{
+		logger.Log("Frame did not change since the last scan");
+		TranslateClient::RestoreEntries();
+	}
+}
+
+// The band is compared with the previous capture at frame rate and sent once it stopped changing.
+// A band that settled without text clears the subtitle shown for it.
+void CapturePipeline::ProcessSubtitle(const Image* img, const CapturedFrame& frame)
+{
+	ScratchImage converted;
+	ImageView view;
+
+	if (!ConvertImage(&img, &converted, &view))
+	{
+		return;
+	}
+
+	FrameDiff::Signature signature = FrameDiff::ComputeSignature(view, FrameDiffBlockSize);
+
+	SubtitleTracker::Action action = subtitleTracker.Feed(signature, FrameDiffTolerance, [&view]
+	{
+		return !TileHashing::FindTextTiles(Preprocess::ToLuma(view)).empty();
+	});
+
+	if (action == SubtitleTracker::Action::None || (action == SubtitleTracker::Action::Clear && subtitleRegion.Area() == 0))
+	{
+		return;
+	}
+
+	std::unique_ptr<TranslateClient::Request> request = std::make_unique<TranslateClient::Request>();
+	ImageRect band = { frame.x, frame.y, view.width, view.height };
+
+	// Only the entries of the band are replaced, including those of a band that since moved
+	request->fullFrame = false;
+
+	if (subtitleRegion.Area() > 0)
+	{
+		request->regions.push_back(subtitleRegion);
+	}
+
+	if (action == SubtitleTracker::Action::Clear)
+	{
+		logger.Log("Subtitle band has no text anymore, clearing it");
+		subtitleRegion = ImageRect();
+	}
+	else
+	{
+		CaptureFormat format = TranslateClient::NegotiateFormat(PreferredCaptureFormat);
+		std::vector<TranslateClient::Crop> crops;
+
+		request->regions.push_back(band);
+		AddTextCrops(view, { 0, 0, view.width, view.height }, frame.x, frame.y, request.get(), &crops);
+
+		if (!EncodeCrops(img, frame.x, frame.y, format, crops, request.get()))
+		{
+			return;
+		}
+
+		logger.Log("Subtitle settled after %i frames, sending the band", SubtitleStableFrames);
+		subtitleRegion = band;
+	}
+
+	request->kind = CaptureKind::Subtitle;
+	request->sequence = TranslateClient::NextSequence(CaptureKind::Subtitle);
+	translateWorker.Post(std::move(request));
+}
+
+// Looks for the subtitle band in a full frame, the renderer captures just the band once it was found
+void CapturePipeline::DetectSubtitleBand(const Image* img)
+{
+	ScratchImage converted;
+	ImageView view;
+
+	if (!ConvertImage(&img, &converted, &view))
+	{
+		return;
+	}
+
+	bandDetector.Feed(Preprocess::ToLuma(view));
+
+	if (!bandDetector.IsFound())
+	{
+		return;
+	}
+
+	const ImageRect& band = bandDetector.GetBand();
+	logger.Log("Found the subtitle band at rows %i - %i", band.y, band.Bottom());
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	detectedBand = band;
+}
+
+bool CapturePipeline::CreateRequest(const Image* img, bool automatic, TranslateClient::Request* request, bool* unchanged)
+{
+	ScratchImage converted;
+
+	*unchanged = false;
+
+	// A lost request leaves regions that were never scanned, compare against nothing to send the full frame
+	if (TranslateClient::ConsumeResync())
+	{
+		lastSignature = FrameDiff::Signature();
+	}
+
+	ImageView view;
+
+	if (!ConvertImage(&img, &converted, &view))
+	{
+		return false;
+	}
+
+	FrameDiff::Signature signature = FrameDiff::ComputeSignature(view, FrameDiffBlockSize);
+
+	*unchanged = FrameDiff::IsSameFrame(signature, lastSignature, FrameDiffTolerance, FrameDiffMaxChangedBlocks);
+
+	// Automatic samples that differ from the last request still wait until the policy lets them through
+	if (automatic ? !ShouldSubmitSample(signature) : *unchanged)
+	{
+		return false;
+	}
+
+	std::vector<ImageRect> dirtyRects = SendChangedRegionsOnly
+		? FrameDiff::FindDirtyRects(signature, lastSignature, FrameDiffTolerance)
+		: std::vector<ImageRect>{ { 0, 0, view.width, view.height } };
+
+	request->fullFrame = dirtyRects.size() == 1 && dirtyRects[0].Area() == int(img->width * img->height);
+
+	CaptureFormat format = TranslateClient::NegotiateFormat(PreferredCaptureFormat);
+	std::vector<TranslateClient::Crop> crops;
+
+	for (const ImageRect& rect : dirtyRects)
+	{
+		request->regions.push_back(rect);
+		AddTextCrops(view, rect, 0, 0, request, &crops);
+	}
+
+	logger.Log("Sending %u crop(s) of %u changed region(s)", UINT(crops.size()), UINT(dirtyRects.size()));
+
+	if (!EncodeCrops(img, 0, 0, format, crops, request))
+	{
+		return false;
+	}
+
+	if (UseTileCache)
+	{
+		TileCache::Stats stats = TranslateClient::tileCache.GetStats();
+		uint64_t lines = stats.hits + stats.misses;
+		uint64_t pixels = stats.hitPixels + stats.missPixels;
+
+		logger.Log("Tile cache hit rate %.1f%%, %.1f%% of the text pixels were not uploaded, %llu key collisions",
+			lines ? 100.0 * stats.hits / lines : 0.0, pixels ? 100.0 * stats.hitPixels / pixels : 0.0, stats.collisions);
+	}
+
+	lastSignature = std::move(signature);
+
+	return true;
+}
+
+// Adds the lines of text the detector proposes in the rect to the crops, instead of all of the rect.
+// Nothing is added when the rect holds no text.
+void CapturePipeline::AddTextCrops(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, std::vector<TranslateClient::Crop>* crops)
+{
+	if (!UseTextDetector)
+	{
+		AddCrop(view, rect, originX, originY, request, crops);
+		return;
+	}
+
+	std::vector<ImageRect> lines = textDetector.Detect(Preprocess::ToLuma(CropView(view, rect)));
+
+	// Without an atlas every crop is a round trip of its own, lines close to each other are sent together
+	if (!UseCropAtlas)
+	{
+		lines = TextDetector::MergeCrops(std::move(lines), TextCropMaxWaste);
+	}
+
+	for (ImageRect line : lines)
+	{
+		line.x += rect.x;
+		line.y += rect.y;
+
+		AddCrop(view, line, originX, originY, request, crops);
+	}
+}
+
+// Adds a rect of the capture to the crops, the capture starts at originX, originY on screen.
+// Lines found in the tile cache are taken from there instead.
+void CapturePipeline::AddCrop(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, std::vector<TranslateClient::Crop>* crops)
+{
+	ImageRect send = { originX + rect.x, originY + rect.y, rect.width, rect.height };
+	std::vector<Tile> missed;
+
+	if (UseTileCache && !LookUpTiles(view, rect, originX, originY, request, &send, &missed))
+	{
+		return;
+	}
+
+	crops->emplace_back();
+
+	TranslateClient::Crop& target = crops->back();
+	target.x = send.x;
+	target.y = send.y;
+	target.width = send.width;
+	target.height = send.height;
+	target.tiles = std::move(missed);
+}
+
+// Encodes the crops into the request. With UseCropAtlas several crops are packed into one atlas,
+// so they are sent in a single round trip without the pixels between them.
+bool CapturePipeline::EncodeCrops(const Image* img, int originX, int originY, CaptureFormat format, std::vector<TranslateClient::Crop>& crops, TranslateClient::Request* request)
+{
+	size_t bytesPerPixel = BitsPerPixel(img->format) / 8;
+
+	if (UseCropAtlas && crops.size() > 1)
+	{
+		std::vector<ImageRect> rects;
+		TranslateClient::Crop atlas;
+
+		for (TranslateClient::Crop& crop : crops)
+		{
+			rects.push_back({ crop.x, crop.y, crop.width, crop.height });
+			atlas.tiles.insert(atlas.tiles.end(), std::make_move_iterator(crop.tiles.begin()), std::make_move_iterator(crop.tiles.end()));
+		}
+
+		atlas.atlas = AtlasPacker::Pack(rects, CropAtlasSpacing);
+		atlas.width = atlas.atlas.width;
+		atlas.height = atlas.atlas.height;
+		atlas.format = format;
+
+		// The space between the crops stays black
+		std::vector<uint8_t> pixels(size_t(atlas.width) * atlas.height * bytesPerPixel, 0);
+		size_t atlasPitch = size_t(atlas.width) * bytesPerPixel;
+
+		for (const AtlasPiece& piece : atlas.atlas.pieces)
+		{
+			for (int y = 0; y < piece.screen.height; y++)
+			{
+				const uint8_t* source = img->pixels + img->rowPitch * (piece.screen.y - originY + y) + bytesPerPixel * (piece.screen.x - originX);
+
+				memcpy(&pixels[atlasPitch * (piece.y + y) + bytesPerPixel * piece.x], source, bytesPerPixel * piece.screen.width);
+			}
+		}
+
+		Image image = *img;
+		image.width = atlas.width;
+		image.height = atlas.height;
+		image.rowPitch = atlasPitch;
+		image.slicePitch = pixels.size();
+		image.pixels = pixels.data();
+
+		logger.Log("Packed %u crops into a %ix%i atlas, %.0f%% of it is text",
+			UINT(crops.size()), atlas.width, atlas.height, 100.0f * atlas.atlas.GetFill());
+
+		if (!EncodeCrop(image, format, &atlas.blob, &atlas.scale))
+		{
+			return false;
+		}
+
+		request->crops.push_back(std::move(atlas));
+
+		return true;
+	}
+
+	for (TranslateClient::Crop& target : crops)
+	{
+		// Crops share the pixels of the capture, only the origin and the extent differ
+		Image crop = *img;
+		crop.width = target.width;
+		crop.height = target.height;
+		crop.slicePitch = crop.rowPitch * target.height;
+		crop.pixels = img->pixels + img->rowPitch * (target.y - originY) + bytesPerPixel * (target.x - originX);
+
+		target.format = format;
+
+		if (!EncodeCrop(crop, format, &target.blob, &target.scale))
+		{
+			return false;
+		}
+
+		request->crops.push_back(std::move(target));
+	}
+
+	return true;
+}
+
+// Asks the continuous translation policy about a sampled frame
+bool CapturePipeline::ShouldSubmitSample(const FrameDiff::Signature& signature)
+{
+	bool changed = !FrameDiff::IsSameFrame(signature, lastSampleSignature, FrameDiffTolerance, FrameDiffMaxChangedBlocks);
+	bool pending = !FrameDiff::IsSameFrame(signature, lastSignature, FrameDiffTolerance, FrameDiffMaxChangedBlocks);
+	int inFlight = translateWorker.GetPendingCount();
+
+	lastSampleSignature = signature;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	AutoTranslateDecision decision = autoPolicy.Evaluate(GetTimeMs(), changed, pending, inFlight);
+
+	if (decision == AutoTranslateDecision::Submit)
+	{
+		const AutoTranslatePolicy::Stats& stats = autoPolicy.GetStats();
+		logger.Log("Text changed, sending sample (%llu samples, %llu sent, %llu throttled)", stats.samples, stats.submissions, stats.throttled);
+	}
+
+	return decision == AutoTranslateDecision::Submit;
+}
+
+// Splits the region into lines of text and takes the entries of the lines seen before from the tile cache.
+// What has to be sent shrinks to the screen space bounds of the lines that missed, false when every line was cached.
+bool CapturePipeline::LookUpTiles(const ImageView& view, const ImageRect& rect, int originX, int originY, TranslateClient::Request* request, ImageRect* send, std::vector<Tile>* missed)
+{
+	GrayImage gray = Preprocess::ToLuma(CropView(view, rect));
+	std::vector<ImageRect> lines = TileHashing::FindTextTiles(gray);
+
+	// Sent as a whole when no line was found, text the detection missed still gets recognized
+	if (lines.empty())
+	{
+		return true;
+	}
+
+	std::vector<Tile> hits;
+	std::vector<std::vector<TranslateClient::TranslationEntry>> hitEntries;
+
+	for (const ImageRect& line : lines)
+	{
+		Tile tile;
+		tile.key = TileHashing::ComputeKey(gray, line);
+		tile.pixelHash = TileHashing::ComputePixelHash(gray, line);
+		tile.rect = { originX + rect.x + line.x, originY + rect.y + line.y, line.width, line.height };
+
+		std::vector<TranslateClient::TranslationEntry> entries;
+
+		if (TranslateClient::tileCache.Find(tile, &entries))
+		{
+			hits.push_back(std::move(tile));
+			hitEntries.push_back(std::move(entries));
+		}
+		else
+		{
+			missed->push_back(std::move(tile));
+		}
+	}
+
+	if (!missed->empty())
+	{
+		*send = missed->front().rect;
+
+		for (const Tile& tile : *missed)
+		{
+			*send = send->Union(tile.rect);
+		}
+	}
+
+	for (size_t i = 0; i < hits.size(); i++)
+	{
+		// A cached line inside the crop is recognized again anyway
+		if (missed->empty() || !hits[i].rect.Intersects(*send))
+		{
+			request->cachedEntries.insert(request->cachedEntries.end(), hitEntries[i].begin(), hitEntries[i].end());
+		}
+	}
+
+	return !missed->empty();
+}
+
+bool CapturePipeline::EncodeCrop(const Image& image, CaptureFormat format, Blob* blob, float* scale)
+{
+	ImageView view;
+	std::vector<uint8_t> encoded;
+
+	*scale = 1.0f;
+
+	if (!GetImageView(&image, &view))
+	{
+		return false;
+	}
+
+	if (PreprocessCaptures)
+	{
+		Preprocess::Options options;
+		options.downscale = Preprocess::ChooseDownscale(GameTextHeight, PreprocessTargetTextHeight);
+		options.normalizeContrast = PreprocessNormalizeContrast;
+
+		GrayImage gray = Preprocess::Run(view, options);
+
+		if (gray.width != view.width)
+		{
+			*scale = 1.0f / options.downscale;
+		}
+
+		if (format == CaptureFormat::Qoi)
+		{
+			return ImageEncoder::EncodeQoi(gray, &encoded) && CopyToBlob(encoded, blob);
+		}
+
+		Image grayImage = {};
+		grayImage.width = gray.width;
+		grayImage.height = gray.height;
+		grayImage.format = DXGI_FORMAT_R8_UNORM;
+		grayImage.rowPitch = gray.width;
+		grayImage.slicePitch = gray.pixels.size();
+		grayImage.pixels = gray.pixels.data();
+
+		return EncodeWIC(grayImage, format, blob);
+	}
+
+	if (format == CaptureFormat::Qoi)
+	{
+		return ImageEncoder::EncodeQoi(view, &encoded) && CopyToBlob(encoded, blob);
+	}
+
+	return EncodeWIC(image, format, blob);
+}
+
+bool CapturePipeline::CopyToBlob(const std::vector<uint8_t>& data, Blob* blob)
+{
+	if (FAILED(blob->Initialize(data.size())))
+	{
+		return false;
+	}
+
+	memcpy(blob->GetBufferPointer(), data.data(), data.size());
+
+	return true;
+}
+
+bool CapturePipeline::EncodeWIC(const Image& image, CaptureFormat format, Blob* blob)
+{
+	HRESULT hr = S_OK;
+
+	switch (format)
+	{
+	case CaptureFormat::Png:
+		hr = SaveToWICMemory(image, WIC_FLAGS_NONE, GUID_ContainerFormatPng, *blob, nullptr,
+			[](IPropertyBag2* props)
+			{
+				if (!PngFastFilter)
+				{
+					return;
+				}
+
+				PROPBAG2 option = {};
+				option.pstrName = const_cast<wchar_t*>(L"FilterOption");
+
+				VARIANT value;
+				VariantInit(&value);
+				value.vt = VT_UI1;
+				value.bVal = WICPngFilterNone;
+
+				props->Write(1, &option, &value);
+			});
+		break;
+	case CaptureFormat::Jpeg:
+		hr = SaveToWICMemory(image, WIC_FLAGS_NONE, GUID_ContainerFormatJpeg, *blob, nullptr,
+			[](IPropertyBag2* props)
+			{
+				PROPBAG2 option = {};
+				option.pstrName = const_cast<wchar_t*>(L"ImageQuality");
+
+				VARIANT value;
+				VariantInit(&value);
+				value.vt = VT_R4;
+				value.fltVal = JpegQuality;
+
+				props->Write(1, &option, &value);
+			});
+		break;
+	default:
+		hr = SaveToWICMemory(image, WIC_FLAGS_NONE, GUID_ContainerFormatBmp, *blob);
+		break;
+	}
+
+	return SUCCEEDED(hr);
+}
+
+// HDR and 10-bit back buffers are brought down to 8-bit for fingerprinting and encoding
+bool CapturePipeline::ConvertImage(const Image** image, ScratchImage* converted, ImageView* view)
+{
+	if (GetImageView(*image, view))
+	{
+		return true;
+	}
+
+	if (FAILED(Convert(**image, DXGI_FORMAT_R8G8B8A8_UNORM, TEX_FILTER_DEFAULT, TEX_THRESHOLD_DEFAULT, *converted)))
+	{
+		return false;
+	}
+
+	*image = converted->GetImage(0, 0, 0);
+
+	return GetImageView(*image, view);
+}
+
+bool CapturePipeline::GetImageView(const Image* image, ImageView* view)
+{
+	switch (image->format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		view->bgra = false;
+		break;
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		view->bgra = true;
+		break;
+	default:
+		return false;
+	}
+
+	view->pixels = image->pixels;
+	view->width = int(image->width);
+	view->height = int(image->height);
+	view->rowPitch = image->rowPitch;
+
+	return true;
+}
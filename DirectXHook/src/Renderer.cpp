@@ -7,6 +7,10 @@ void Renderer::Init()
 {
 	OF::InitFramework(d3d11Device, spriteBatch, window);
 	OF::LoadFont(FontPath);
+
+	readbackDevice.Init(d3d11Device.Get(), d3d11Context.Get(), &capturePipeline, ReadbackRingSize);
+	readbackRing = std::make_unique<ReadbackRing>(&readbackDevice, ReadbackRingSize, ReadbackLatency, ReadbackDrop);
+	capturePipeline.Start();
 }
 
 void Renderer::Tick()
@@ -16,24 +20,53 @@ void Renderer::Tick()
 		showTranslations = !showTranslations;
 	}
 
+	if (OF::CheckHotkey(AutoTranslateButton, AutoTranslateButtonMod))
+	{
+		autoTranslate = !autoTranslate;
+	}
+
+	if (OF::CheckHotkey(SubtitleButton, SubtitleButtonMod))
+	{
+		subtitleMode = !subtitleMode;
+	}
+
 	if (OF::CheckHotkey(TranslateButton, TranslateButtonMod))
 	{
 		if (cleanNeeded) {
 			TranslateClient::ClearEntries();
 		}
 		else {
-			Blob* blob = new Blob;
+			if (RequestScreenshot())
+			{
+				showInProgress = true;
+			}
+		}
+	}
 
-			CreateScreenshot(blob);
-			CreateThread(0, 0, &TranslateClient::SendRequest, blob, 0, NULL);
+	// Sampled frames only turn into requests when their text changed and settled, see AutoTranslatePolicy
+	bool sampleDue = (autoTranslate || subtitleMode) && capturePipeline.IsSampleDue();
 
-			showInProgress = true;
-		}
+	// The band is captured every frame, until the detector found it the samples go to the detector
+	if (subtitleMode && !RequestScreenshot(CaptureKind::Subtitle) && sampleDue)
+	{
+		RequestScreenshot(CaptureKind::BandDetection);
+	}
+	else if (autoTranslate && sampleDue)
+	{
+		RequestScreenshot(CaptureKind::Automatic);
 	}
 
-	std::vector<TranslateClient::TranslationEntry> entries;
+	readbackRing->Poll(frameCount);
+
+	// Entries are laid out when they are published, only a font change has the shown ones laid out anew
+	if (OF::ofActiveFont.get() != layoutFont)
+	{
+		layoutFont = OF::ofActiveFont.get();
+		TranslateClient::SetLayoutFont(layoutFont, OF::GetMeasureFunction());
+	}
 
-	TranslateClient::PullEntries(&entries);
+	std::shared_ptr<const TranslateClient::Snapshot> snapshot = TranslateClient::AcquireSnapshot();
+	const std::vector<TranslateClient::TranslationEntry>& entries = snapshot->entries;
 
 	bool showing = cleanNeeded = entries.size() != 0;
 
@@ -59,6 +92,24 @@ void Renderer::Tick()
 			30,
 			Colors::LightYellow);
 	}
+	else if (subtitleMode) {
+		OF::DrawText(
+			"S",
+			5,
+			5,
+			30,
+			30,
+			Colors::LightSkyBlue);
+	}
+	else if (autoTranslate) {
+		OF::DrawText(
+			"A",
+			5,
+			5,
+			30,
+			30,
+			Colors::LightSkyBlue);
+	}
 	else {
 		OF::DrawText(
 			"R",
@@ -69,15 +120,15 @@ void Renderer::Tick()
 			Colors::LightGreen);
 	}
 
-	for (auto entry = entries.begin(); entry != entries.end(); entry++)
+	// Nothing is measured here, a frame only queues the text
+	const std::vector<TextLayout>& layouts = showTranslations ? snapshot->translationLayouts : snapshot->messageLayouts;
+
+	for (size_t i = 0; i < layouts.size(); i++)
 	{
 		try {
 			OF::DrawText(
-				showTranslations ? entry->translation.c_str() : entry->message.c_str(),
-				entry->x,
-				entry->y,
-				entry->w,
-				entry->h,
+				layouts[i].text.c_str(),
+				layouts[i],
 				showTranslations ? Colors::LightSkyBlue : Colors::LightGreen);
 		}
 		catch (std::logic_error e) {
@@ -86,30 +137,50 @@ void Renderer::Tick()
 	}
 }
 
-bool Renderer::CreateScreenshot(Blob* blob)
+// Queues a copy of the back buffer, the pixels are read a few frames later by the readback ring.
+// Subtitle captures copy just the band and fail while it is not known yet.
+bool Renderer::RequestScreenshot(CaptureKind kind)
 {
-	ComPtr<ID3D11Texture2D> backBufferTex;
-	ScratchImage image;
+	ComPtr<ID3D11Texture2D> backBufferTex = GetBackBufferTexture();
 
-	HRESULT hr = swapChain->GetBuffer(bufferIndex, __uuidof(ID3D11Texture2D), (LPVOID*)&backBufferTex);
-
-	if (FAILED(hr))
+	if (backBufferTex.Get() == nullptr)
 	{
 		return false;
 	}
 
-	CaptureTexture(d3d11Device.Get(), d3d11Context.Get(), backBufferTex.Get(), image);
+	ImageRect region;
+
+	if (kind == CaptureKind::Subtitle)
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		backBufferTex->GetDesc(&desc);
+
+		if (!capturePipeline.GetSubtitleBand(int(desc.Width), int(desc.Height), &region))
+		{
+			return false;
+		}
+	}
 
-	const Image* img = image.GetImage(0, 0, 0);
+	readbackDevice.SetSource(backBufferTex, kind, region);
 
-	hr = SaveToWICMemory(*img, WIC_FLAGS_NONE, GUID_ContainerFormatBmp, *blob);
+	// The band is captured again on the next frame and a detection sample soon after, neither may push out a scan waiting for the GPU
+	return readbackRing->Request(frameCount, kind == CaptureKind::Subtitle || kind == CaptureKind::BandDetection);
+}
 
-	if (FAILED(hr))
+ComPtr<ID3D11Texture2D> Renderer::GetBackBufferTexture()
+{
+	ComPtr<ID3D11Texture2D> backBufferTex;
+
+	if (isRunningD3D12)
 	{
-		return false;
+		d3d11WrappedBackBuffers[bufferIndex].As(&backBufferTex);
+	}
+	else
+	{
+		swapChain->GetBuffer(bufferIndex, __uuidof(ID3D11Texture2D), (LPVOID*)backBufferTex.GetAddressOf());
 	}
 
-	return true;
+	return backBufferTex;
 }
 
 void Renderer::OnPresent(IDXGISwapChain* pThis, UINT syncInterval, UINT flags)
@@ -129,6 +200,13 @@ void Renderer::OnPresent(IDXGISwapChain* pThis, UINT syncInterval, UINT flags)
 void Renderer::OnResizeBuffers(IDXGISwapChain* pThis, UINT bufferCount, UINT width, UINT height, DXGI_FORMAT newFormat, UINT swapChainFlags)
 {
 	logger.Log("ResizeBuffers was called!");
+
+	if (readbackRing != nullptr)
+	{
+		readbackRing->Reset();
+		readbackDevice.Release();
+	}
+
 	ReleaseViewsBuffersAndContext();
 	mustInitializeD3DResources = true;
 }
@@ -410,7 +488,10 @@ void Renderer::Render()
 {
 	PreRender();
 	Tick();
+	OF::FlushText();
 	PostRender();
+
+	frameCount++;
 }
 
 void Renderer::PreRender()
@@ -0,0 +1,66 @@
+#include "TranslateWorker.h"
+
+void TranslateWorker::Start()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (started)
+	{
+		return;
+	}
+
+	started = true;
+	CreateThread(0, 0, &TranslateWorker::ThreadMain, this, 0, NULL);
+}
+
+int TranslateWorker::Post(std::unique_ptr<TranslateClient::Request> request)
+{
+	uint64_t sequence = request->sequence;
+	int superseded = queue.Post(std::move(request));
+
+	if (superseded > 0)
+	{
+		logger.Log("Request %llu superseded %d older requests", sequence, superseded);
+		TranslateClient::RequestResync();
+	}
+
+	return superseded;
+}
+
+int TranslateWorker::GetPendingCount()
+{
+	return queue.GetPendingCount();
+}
+
+DWORD WINAPI TranslateWorker::ThreadMain(LPVOID pWorker)
+{
+	((TranslateWorker*)pWorker)->Run();
+
+	return 0;
+}
+
+void TranslateWorker::Run()
+{
+	transport.Start();
+	TranslateClient::OpenTranslationStore();
+	TranslateClient::QueryCapabilities(transport);
+
+	while (true)
+	{
+		std::unique_ptr<TranslateClient::Request> request = queue.Take();
+		bool succeeded = TranslateClient::SendRequest(transport, *request);
+		bool idle = queue.Finish();
+
+		if (!succeeded)
+		{
+			logger.Log("Request %llu failed or was superseded", request->sequence);
+			TranslateClient::RequestResync();
+		}
+
+		// Rewriting the store takes a while, it waits until no request does
+		if (idle)
+		{
+			TranslateClient::CompactTranslationStore();
+		}
+	}
+}
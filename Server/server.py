@@ -12,21 +12,164 @@ MERGE_MAX_Y_DIFF      = 20
 REPORT_FILE_PATH      = "report.txt"
 # END OF CONFIG
 
-from http.server import BaseHTTPRequestHandler, HTTPServer
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
 from deep_translator import GoogleTranslator
 import easyocr
 import json
+import mmap
 import os
+import ipaddress
+import re
+import struct
+import threading
 
+try:
+    import qoi
+except ImportError:
+    qoi = None
+
+# Anything OpenCV decodes is passed to EasyOCR as is
+FORMATS = ["bmp", "png", "jpeg"] + (["qoi"] if qoi else [])
+
+# Binary result format, see DirectXHook/include/ResultCodec.h
+BINARY_RESULTS_TYPE = "application/x-igt-results"
+BINARY_RESULTS_VERSION = 2
+
+def encode_binary_results(entries):
+    records = []
+
+    for entry in entries:
+        message = entry["message"].encode("utf-8")
+        translation = entry["translation"].encode("utf-8")
+
+        records.append(struct.pack("<iiffII",
+            entry["x"], entry["y"], entry["w"], entry["h"],
+            len(message), len(translation)) + message + translation)
+
+    body = b"".join(records)
+    header = struct.pack("<4sHHII", b"IGTR", BINARY_RESULTS_VERSION, 0, len(entries), len(body))
+
+    return header + body
+
+# Frames of a client on the same machine can be in shared memory, see DirectXHook/include/FrameRing.h
+SHARED_HEADER = struct.Struct("<4sIIIQQ")
+SHARED_HEADER_SIZE = 64
+SHARED_DESCRIPTOR = struct.Struct("<QQ")
+SHARED_DESCRIPTOR_SIZE = 64
+SHARED_VERSION = 1
+# Only memories the client created, see SharedMemory::GetUniqueName, nothing that names a path or another object
+SHARED_NAME = re.compile(r"InGameTranslator-[0-9]+-[0-9]+")
+# Two slots of 40 MB by default, see SharedMemorySlots in DirectXHook/include/Config.h
+MAX_SHARED_BYTES = 512 * 1024 * 1024
+# Mappings by name, kept open between requests
+shared_memories = {}
+shared_memories_lock = threading.Lock()
+
+# True when a mapping of that name exists, mmap would create a new one otherwise
+def windows_shared_memory_exists(name):
+    import ctypes
+
+    FILE_MAP_READ = 4
+    kernel32 = ctypes.windll.kernel32
+    kernel32.OpenFileMappingW.restype = ctypes.c_void_p
+    kernel32.CloseHandle.argtypes = [ctypes.c_void_p]
+
+    handle = kernel32.OpenFileMappingW(FILE_MAP_READ, False, name)
+
+    if not handle:
+        return False
+
+    kernel32.CloseHandle(handle)
+
+    return True
+
+def open_shared_memory(name, size):
+    if not SHARED_NAME.fullmatch(name) or size < SHARED_HEADER_SIZE or size > MAX_SHARED_BYTES:
+        raise ValueError("not a frame ring of the client")
+
+    memory = shared_memories.get(name)
+
+    if memory is not None and len(memory) >= size:
+        return memory
+
+    if len(shared_memories) >= 8:
+        for old in shared_memories.values():
+            old.close()
+
+        shared_memories.clear()
+
+    if os.name == "nt":
+        if not windows_shared_memory_exists(name):
+            raise OSError("no shared memory named " + name)
+
+        memory = mmap.mmap(-1, size, tagname=name, access=mmap.ACCESS_READ)
+    else:
+        fd = os.open("/dev/shm/" + name, os.O_RDONLY | os.O_NOFOLLOW)
+
+        try:
+            memory = mmap.mmap(fd, size, access=mmap.ACCESS_READ)
+        finally:
+            os.close(fd)
+
+    shared_memories[name] = memory
+
+    return memory
+
+# The frame in the slot, None when the slot does not hold it anymore
+def read_shared_frame(name, size, slot, sequence):
+    # Another connection could close the mapping while it is read
+    with shared_memories_lock:
+        return read_shared_frame_locked(name, size, slot, sequence)
+
+def read_shared_frame_locked(name, size, slot, sequence):
+    memory = open_shared_memory(name, size)
+    magic, version, slot_count, _, slot_bytes, data_offset = SHARED_HEADER.unpack_from(memory, 0)
+
+    if magic != b"IGTS" or version != SHARED_VERSION or slot < 0 or slot >= slot_count or data_offset + slot_count * slot_bytes > len(memory):
+        return None
+
+    descriptor = SHARED_HEADER_SIZE + slot * SHARED_DESCRIPTOR_SIZE
+    written, frame_size = SHARED_DESCRIPTOR.unpack_from(memory, descriptor)
+
+    if written != sequence or frame_size > slot_bytes:
+        return None
+
+    start = data_offset + slot * slot_bytes
+    frame = memory[start:start + frame_size]
+
+    # The client wrote the next frame into the slot while it was copied
+    if SHARED_DESCRIPTOR.unpack_from(memory, descriptor)[0] != sequence:
+        return None
+
+    return frame
+
+# Every connection is served on a thread of its own, so a health check or a hedged request gets an answer
+# while another connection is kept open or busy. The OCR model is loaded once and used by one thread at a time.
 class TranslatorRequestHandler(BaseHTTPRequestHandler):
+    # Keeps the connection of the client open between requests, every response carries a Content-length
+    protocol_version = "HTTP/1.1"
     reader = None
+    reader_lock = threading.Lock()
     translator = None
+    translator_lock = threading.Lock()
+    report_lock = threading.Lock()
+
+    def decode_image(self, post_body):
+        content_type = self.headers.get("content-type", "")
+
+        if content_type == "image/qoi":
+            return qoi.decode(post_body)
+
+        return post_body
 
     def process_image(self, post_body):
-        if self.reader == None:
-            self.reader = easyocr.Reader([SOURCE_LANG, "en"], gpu = USE_GPU)
-        
-        return self.reader.readtext(post_body, batch_size=BATCH_SIZE, workers=WORKERS)
+        image = self.decode_image(post_body)
+
+        with TranslatorRequestHandler.reader_lock:
+            if TranslatorRequestHandler.reader == None:
+                TranslatorRequestHandler.reader = easyocr.Reader([SOURCE_LANG, "en"], gpu = USE_GPU)
+
+            return TranslatorRequestHandler.reader.readtext(image, batch_size=BATCH_SIZE, workers=WORKERS)
     
     # item = [ box [ p1 [ x, y ], p2 [ x, y ], p3 [ x, y ], p4 [ x, y ] ], text, confidence ]
     def map_item(self, item):
@@ -56,19 +199,22 @@ class TranslatorRequestHandler(BaseHTTPRequestHandler):
 
         return entry
 
+    # The translator is shared by the connection threads and not made for concurrent use
     def translate(self, text):
-        if self.translator == None:
-            self.translator = GoogleTranslator(source="auto", target=DEST_LANG)
-        
-        return self.translator.translate(text)
+        with TranslatorRequestHandler.translator_lock:
+            if TranslatorRequestHandler.translator == None:
+                TranslatorRequestHandler.translator = GoogleTranslator(source="auto", target=DEST_LANG)
 
-    def process_item(self, item):
+            return TranslatorRequestHandler.translator.translate(text)
+
+    def process_item(self, item, translate):
         x, y, w, h, source_text, confidence = self.map_item(item)
 
         if confidence < 0.2:
             return None
 
-        translated_text = self.translate(source_text)
+        # Clients with a translation cache ask for the recognized text only and translate it through /translate
+        translated_text = self.translate(source_text) if translate else ""
 
         if not translated_text or len(translated_text) <= 1:
             translated_text = ""
@@ -78,11 +224,11 @@ class TranslatorRequestHandler(BaseHTTPRequestHandler):
         
         return None
 
-    def process_items(self, items):
+    def process_items(self, items, translate):
         entries = []
 
         for item in items:
-            entry = self.process_item(item)
+            entry = self.process_item(item, translate)
 
             if entry:
                 entries.append(entry)
@@ -114,38 +260,133 @@ class TranslatorRequestHandler(BaseHTTPRequestHandler):
         return entries
     
     def dump_entries(self, entries):
+        with TranslatorRequestHandler.report_lock:
+            self.dump_entries_locked(entries)
+
+    def dump_entries_locked(self, entries):
         for entry in entries:
             with open(REPORT_FILE_PATH, "a") as f:
                 f.write("{}\n{}\n\n".format(entry["message"], entry["translation"]))
             
             print("{} -> {}".format(entry["message"], entry["translation"]))
 
-    def create_entries(self, post_body):
+    def create_entries(self, post_body, translate):
         items = self.process_image(post_body)
-        entries = self.process_items(items)
+        entries = self.process_items(items, translate)
         entries = self.merge_x_overlapping_entries(entries)
 
-        self.dump_entries(entries)
+        if translate:
+            self.dump_entries(entries)
         
         return entries
 
-    def do_GET(self):
-        self.send_response(404)
-        self.end_headers()
+    def send_capabilities(self):
+        resp_body = bytes(json.dumps({ "formats": FORMATS, "ocr_only": True }), "utf-8")
 
-    def do_PUT(self):
-        self.send_response(404)
+        self.send_response(200)
+        self.send_header("Content-type", "application/json")
+        self.send_header("Content-length", len(resp_body))
         self.end_headers()
 
-    def do_POST(self):
+        self.wfile.write(resp_body)
+
+    def send_json(self, value):
+        resp_body = bytes(json.dumps(value), "utf-8")
+
         self.send_response(200)
         self.send_header("Content-type", "application/json")
+        self.send_header("Content-length", len(resp_body))
+        self.end_headers()
+
+        self.wfile.write(resp_body)
+        self.wfile.flush()
+
+    # Body is a JSON array of texts, the answer the array of their translations in the same order
+    def send_translations(self, req_body):
+        try:
+            texts = json.loads(req_body)
+        except ValueError:
+            self.send_empty(400)
+            return
+
+        if not isinstance(texts, list) or not all(isinstance(text, str) for text in texts):
+            self.send_empty(400)
+            return
+
+        translations = []
+
+        for text in texts:
+            translated_text = self.translate(text)
+
+            if not translated_text or len(translated_text) <= 1:
+                translated_text = ""
+
+            translations.append(translated_text)
+
+        self.dump_entries([{ "message": text, "translation": translation } for text, translation in zip(texts, translations)])
+        self.send_json(translations)
+
+    def send_empty(self, code):
+        self.send_response(code)
+        self.send_header("Content-length", 0)
         self.end_headers()
 
+    def do_GET(self):
+        if self.path == "/capabilities":
+            self.send_capabilities()
+            return
+
+        self.send_empty(404)
+
+    def do_PUT(self):
+        self.send_empty(404)
+
+    def do_POST(self):
         content_len = int(self.headers.get("content-length", 0))
         req_body = self.rfile.read(content_len)
-        entries = self.create_entries(req_body)
-        resp_body = bytes(json.dumps(entries), "utf-8")
+
+        if "x-shm-name" in self.headers:
+            # The server may listen on every interface, a frame in memory can only come from this machine
+            if not ipaddress.ip_address(self.client_address[0]).is_loopback:
+                self.send_empty(403)
+                return
+
+            try:
+                req_body = read_shared_frame(
+                    self.headers["x-shm-name"],
+                    int(self.headers["x-shm-bytes"]),
+                    int(self.headers["x-shm-slot"]),
+                    int(self.headers["x-shm-sequence"]))
+            except (OSError, ValueError, KeyError, struct.error):
+                self.send_empty(400)
+                return
+
+            if req_body is None:
+                self.send_empty(409)
+                return
+
+        if self.path == "/translate":
+            self.send_translations(req_body)
+            return
+
+        if self.headers.get("content-type", "") == "image/qoi" and not qoi:
+            self.send_empty(415)
+            return
+
+        translate = self.headers.get("x-translate", "") != "no"
+        entries = self.create_entries(req_body, translate)
+
+        if BINARY_RESULTS_TYPE in self.headers.get("accept", ""):
+            content_type = BINARY_RESULTS_TYPE
+            resp_body = encode_binary_results(entries)
+        else:
+            content_type = "application/json"
+            resp_body = bytes(json.dumps(entries), "utf-8")
+
+        self.send_response(200)
+        self.send_header("Content-type", content_type)
+        self.send_header("Content-length", len(resp_body))
+        self.end_headers()
 
         self.wfile.write(resp_body)
         self.wfile.flush()
@@ -158,7 +399,9 @@ def main():
 
     print("Listennig on {}:{}".format(HOST, PORT))
 
-    HTTPServer((HOST, PORT), TranslatorRequestHandler).serve_forever()
+    server = ThreadingHTTPServer((HOST, PORT), TranslatorRequestHandler)
+    server.daemon_threads = True
+    server.serve_forever()
 
 if __name__ == "__main__":
     try:
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#include "AutoTranslatePolicy.h"
+
+// What the screen shows from a point in time on, screens with the same id show the same text
+struct ScreenChange
+{
+	uint64_t timeMs;
+	int screen;
+};
+
+// A recorded session: "time_ms screen_id" per line, sorted by time
+static std::vector<ScreenChange> LoadRecording(const char* path)
+{
+	std::vector<ScreenChange> changes;
+	std::ifstream file(path);
+	ScreenChange change;
+
+	while (file >> change.timeMs >> change.screen)
+	{
+		changes.push_back(change);
+	}
+
+	return changes;
+}
+
+// Ten minutes of a dialogue heavy game: lines typed out over a second, read for a few seconds,
+// now and then a menu that is scrolled through quickly, and idle stretches
+static std::vector<ScreenChange> MakeSession()
+{
+	std::vector<ScreenChange> changes;
+	uint64_t timeMs = 0;
+	int screen = 0;
+
+	for (int line = 0; timeMs < 600000; line++)
+	{
+		// Typed out: the text changes every 50 ms for a second
+		for (int step = 0; step < 20; step++)
+		{
+			changes.push_back({ timeMs, ++screen });
+			timeMs += 50;
+		}
+
+		timeMs += 2000 + uint64_t(line * 7919 % 4000);
+
+		if (line % 10 == 9)
+		{
+			// Scrolling through a menu, a new item every 150 ms
+			for (int item = 0; item < 12; item++)
+			{
+				changes.push_back({ timeMs, ++screen });
+				timeMs += 150;
+			}
+
+			timeMs += 5000;
+		}
+	}
+
+	return changes;
+}
+
+struct Result
+{
+	int requests = 0;
+	// Screens shown long enough to be read, 500 ms or more, and how many of them were translated
+	int readable = 0;
+	int translated = 0;
+	// Time from a readable screen appearing to its translation arriving
+	std::vector<uint64_t> latencies;
+};
+
+// Replays the session at 60 frames per second against a server answering after serverMs
+static Result Replay(const std::vector<ScreenChange>& changes, const AutoTranslateOptions& options, uint64_t serverMs)
+{
+	AutoTranslatePolicy policy(options);
+	Result result;
+
+	uint64_t endMs = changes.back().timeMs + 10000;
+	int screens = 0;
+
+	for (const ScreenChange& change : changes)
+	{
+		screens = std::max(screens, change.screen + 1);
+	}
+
+	std::vector<bool> readable(screens, false);
+	std::vector<bool> translated(screens, false);
+	std::vector<uint64_t> appearedMs(screens, 0);
+
+	for (size_t i = 0; i < changes.size(); i++)
+	{
+		uint64_t untilMs = i + 1 < changes.size() ? changes[i + 1].timeMs : endMs;
+
+		if (untilMs - changes[i].timeMs >= 500 && !readable[changes[i].screen])
+		{
+			readable[changes[i].screen] = true;
+			result.readable++;
+		}
+	}
+
+	size_t next = 0;
+	int shown = -1;
+	int previous = -1;
+	int sent = -1;
+	// The request in flight, the screen it carries and when its answer arrives
+	bool inFlight = false;
+	int inFlightScreen = -1;
+	uint64_t answerMs = 0;
+
+	for (uint64_t nowMs = changes.front().timeMs; nowMs < endMs; nowMs += 16)
+	{
+		while (next < changes.size() && changes[next].timeMs <= nowMs)
+		{
+			shown = changes[next++].screen;
+			appearedMs[shown] = nowMs;
+		}
+
+		if (inFlight && nowMs >= answerMs)
+		{
+			inFlight = false;
+
+			if (readable[inFlightScreen] && !translated[inFlightScreen])
+			{
+				translated[inFlightScreen] = true;
+				result.translated++;
+				result.latencies.push_back(nowMs - appearedMs[inFlightScreen]);
+			}
+		}
+
+		if (!policy.ShouldSample(nowMs))
+		{
+			continue;
+		}
+
+		if (policy.Evaluate(nowMs, shown != previous, shown != sent, inFlight ? 1 : 0) == AutoTranslateDecision::Submit)
+		{
+			result.requests++;
+			sent = shown;
+			inFlight = true;
+			inFlightScreen = shown;
+			answerMs = nowMs + serverMs;
+		}
+
+		previous = shown;
+	}
+
+	return result;
+}
+
+static void Print(const char* name, const Result& result, uint64_t sessionMs)
+{
+	std::vector<uint64_t> latencies = result.latencies;
+	std::sort(latencies.begin(), latencies.end());
+
+	uint64_t median = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+	uint64_t p95 = latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100];
+
+	std::printf("%-26s %6d requests (%5.1f/min)  %4d of %4d readable screens  latency median %5llu ms, p95 %5llu ms\n",
+		name, result.requests, result.requests * 60000.0 / sessionMs, result.translated, result.readable,
+		(unsigned long long)median, (unsigned long long)p95);
+}
+
+// Simulation harness for the auto translate policy: replays a recorded or generated session and reports
+// how many requests each setting sends and how long translations take to show up.
+// Usage: AutoTranslatePolicyBench [recording]
+int main(int argc, char** argv)
+{
+	std::vector<ScreenChange> changes = argc > 1 ? LoadRecording(argv[1]) : MakeSession();
+
+	if (changes.empty())
+	{
+		std::printf("Empty recording\n");
+		return 1;
+	}
+
+	uint64_t sessionMs = changes.back().timeMs - changes.front().timeMs;
+	const uint64_t serverMs = 400;
+
+	struct Setting
+	{
+		const char* name;
+		AutoTranslateOptions options;
+	};
+
+	const Setting settings[] = {
+		{ "every sample, no waiting", { 250, 0, 0, 1, 100.0f } },
+		{ "defaults", AutoTranslateOptions() },
+		{ "sample every 100 ms", { 100, 300, 500, 1, 2.0f } },
+		{ "stable for 600 ms", { 250, 600, 500, 1, 2.0f } },
+		{ "one request per second", { 250, 300, 1000, 1, 1.0f } },
+	};
+
+	std::printf("%zu screen changes over %.1f minutes, server answers after %llu ms\n",
+		changes.size(), sessionMs / 60000.0, (unsigned long long)serverMs);
+
+	for (const Setting& setting : settings)
+	{
+		Print(setting.name, Replay(changes, setting.options, serverMs), sessionMs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <cstdint>
+#include <vector>
+
+#include "AutoTranslatePolicy.h"
+#include "Check.h"
+
+// Replays a screen whose content is content(time) at 60 frames per second and returns the times frames were sent
+template <typename Content>
+static std::vector<uint64_t> Replay(AutoTranslatePolicy* policy, uint64_t endMs, Content content, int inFlight = 0)
+{
+	std::vector<uint64_t> submissions;
+	int previous = -1;
+	int sent = -1;
+
+	for (uint64_t nowMs = 1000; nowMs < endMs; nowMs += 16)
+	{
+		if (!policy->ShouldSample(nowMs))
+		{
+			continue;
+		}
+
+		int shown = content(nowMs);
+
+		if (policy->Evaluate(nowMs, shown != previous, shown != sent, inFlight) == AutoTranslateDecision::Submit)
+		{
+			submissions.push_back(nowMs);
+			sent = shown;
+		}
+
+		previous = shown;
+	}
+
+	return submissions;
+}
+
+static void TestSampling()
+{
+	AutoTranslatePolicy policy;
+
+	CHECK(policy.ShouldSample(1000));
+	CHECK(!policy.ShouldSample(1100));
+	CHECK(!policy.ShouldSample(1249));
+	CHECK(policy.ShouldSample(1250));
+	CHECK(!policy.ShouldSample(1400));
+}
+
+// Text being typed out is sent once it stopped changing, a static screen is sent once
+static void TestStability()
+{
+	AutoTranslatePolicy policy;
+	std::vector<uint64_t> submissions = Replay(&policy, 10000, [](uint64_t nowMs)
+	{
+		if (nowMs >= 5000)
+		{
+			return 100;
+		}
+
+		return nowMs > 2000 && nowMs < 2600 ? int(nowMs - 2000) / 100 : nowMs >= 2600 ? 6 : 0;
+	});
+
+	CHECK(submissions.size() == 3);
+	// Samples are 256 ms apart here: a change is seen up to one sample late and sent on the first sample
+	// after it was stable for 300 ms. The first frame has nothing to compare to and waits like a changed one.
+	CHECK(submissions[0] >= 1000 + 300 && submissions[0] <= 1000 + 300 + 256);
+	CHECK(submissions[1] >= 2600 + 300 && submissions[1] <= 2600 + 256 + 300 + 256);
+	CHECK(submissions[2] >= 5000 + 300 && submissions[2] <= 5000 + 256 + 300 + 256);
+
+	const AutoTranslatePolicy::Stats& stats = policy.GetStats();
+	CHECK(stats.submissions == 3 && stats.throttled == 0);
+	CHECK(stats.samples == (10000 - 1000) / 256 + 1);
+}
+
+// A frame waits while the previous request is in flight
+static void TestInFlight()
+{
+	AutoTranslatePolicy policy;
+	std::vector<uint64_t> submissions = Replay(&policy, 5000, [](uint64_t) { return 1; }, 1);
+
+	CHECK(submissions.empty());
+	CHECK(policy.GetStats().throttled > 0);
+}
+
+// A screen changing all the time is sent no faster than the debounce and the rate budget allow
+static void TestRate()
+{
+	AutoTranslateOptions options;
+	options.sampleIntervalMs = 0;
+	options.stabilityMs = 0;
+	options.debounceMs = 0;
+	options.maxRequestsPerSecond = 2.0f;
+
+	AutoTranslatePolicy policy(options);
+	std::vector<uint64_t> submissions = Replay(&policy, 11000, [](uint64_t nowMs) { return int(nowMs); });
+
+	// Ten seconds at two per second, plus the burst the bucket starts with
+	CHECK(submissions.size() >= 20 && submissions.size() <= 22);
+
+	options.debounceMs = 1000;
+	AutoTranslatePolicy debounced(options);
+	submissions = Replay(&debounced, 11000, [](uint64_t nowMs) { return int(nowMs); });
+
+	CHECK(submissions.size() == 10);
+
+	for (size_t i = 1; i < submissions.size(); i++)
+	{
+		CHECK(submissions[i] - submissions[i - 1] >= 1000);
+	}
+}
+
+int main()
+{
+	TestSampling();
+	TestStability();
+	TestInFlight();
+	TestRate();
+
+	return 0;
+}
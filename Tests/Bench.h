@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Mean time of one call of work in microseconds. The first call is not counted, it warms caches and
+// allocations, then work is called until at least minMs passed.
+template <typename Work>
+double MeasureUs(Work&& work, double minMs = 250.0)
+{
+	using Clock = std::chrono::steady_clock;
+
+	work();
+
+	Clock::time_point start = Clock::now();
+	double elapsedMs = 0.0;
+	int runs = 0;
+
+	do
+	{
+		work();
+		runs++;
+		elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	} while (elapsedMs < minMs);
+
+	return elapsedMs * 1000.0 / runs;
+}
+
+// Keeps the compiler from dropping a result that is not used otherwise
+inline void Consume(uint64_t value)
+{
+	static volatile uint64_t sink = 0;
+	sink = sink + value;
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "CropAtlas.h"
+
+// Packing efficiency on random scans of 1 to 40 text lines of 10 to 60 pixels height, and the time a pack takes
+int main()
+{
+	const int scans = 2000;
+	const int spacing = 8;
+	std::mt19937 random(3);
+	std::vector<std::vector<ImageRect>> corpus;
+
+	for (int scan = 0; scan < scans; scan++)
+	{
+		std::vector<ImageRect> crops;
+		int count = 1 + int(random() % 40);
+
+		for (int i = 0; i < count; i++)
+		{
+			int height = 10 + int(random() % 50);
+			int width = height + int(random() % (height * 20));
+
+			crops.push_back({ int(random() % 1920), int(random() % 1080), width, height });
+		}
+
+		corpus.push_back(crops);
+	}
+
+	double fill = 0.0;
+	double atlasPixels = 0.0;
+	double boundingPixels = 0.0;
+
+	for (const std::vector<ImageRect>& crops : corpus)
+	{
+		AtlasLayout layout = AtlasPacker::Pack(crops, spacing);
+		ImageRect bounds = crops[0];
+
+		for (const ImageRect& crop : crops)
+		{
+			bounds = bounds.Union(crop);
+		}
+
+		fill += layout.GetFill();
+		atlasPixels += double(layout.width) * layout.height;
+		boundingPixels += double(std::min(bounds.Right(), 1920) - bounds.x) * (std::min(bounds.Bottom(), 1080) - bounds.y);
+	}
+
+	size_t next = 0;
+	double packUs = MeasureUs([&]() { Consume(AtlasPacker::Pack(corpus[next++ % scans], spacing).width); }, 1000.0);
+
+	std::printf("%d scans: mean fill %.1f%%, atlas %.1f%% of the pixels of the crops' bounding box, %.1f%% of a 1080p frame\n",
+		scans, fill * 100.0 / scans, atlasPixels * 100.0 / boundingPixels, atlasPixels * 100.0 / (double(scans) * 1920 * 1080));
+	std::printf("%.1f us per pack\n", packUs);
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "CropAtlas.h"
+
+static const int Spacing = 4;
+
+// Pieces keep the order and size of their crops, stay inside the atlas and keep the spacing between each other
+static void CheckLayout(const AtlasLayout& layout, const std::vector<ImageRect>& crops)
+{
+	CHECK(layout.pieces.size() == crops.size());
+
+	for (size_t i = 0; i < crops.size(); i++)
+	{
+		const AtlasPiece& piece = layout.pieces[i];
+
+		CHECK(piece.screen.x == crops[i].x && piece.screen.y == crops[i].y);
+		CHECK(piece.screen.width == crops[i].width && piece.screen.height == crops[i].height);
+		CHECK(piece.x >= 0 && piece.y >= 0);
+		CHECK(piece.x + piece.screen.width <= layout.width && piece.y + piece.screen.height <= layout.height);
+
+		ImageRect spaced = { piece.x, piece.y, piece.screen.width + Spacing, piece.screen.height + Spacing };
+
+		for (size_t j = 0; j < i; j++)
+		{
+			const AtlasPiece& other = layout.pieces[j];
+			ImageRect otherSpaced = { other.x, other.y, other.screen.width + Spacing, other.screen.height + Spacing };
+
+			CHECK(!spaced.Intersects({ other.x, other.y, other.screen.width, other.screen.height }));
+			CHECK(!otherSpaced.Intersects({ piece.x, piece.y, piece.screen.width, piece.screen.height }));
+		}
+	}
+}
+
+static void TestPack()
+{
+	std::mt19937 random(3);
+	double fill = 0.0;
+	const int trials = 2000;
+
+	for (int trial = 0; trial < trials; trial++)
+	{
+		std::vector<ImageRect> crops(1 + random() % 40);
+
+		for (ImageRect& crop : crops)
+		{
+			int height = 10 + int(random() % 50);
+			crop = { int(random() % 1920), int(random() % 1080), height + int(random() % (height * 20)), height };
+		}
+
+		AtlasLayout layout = AtlasPacker::Pack(crops, Spacing);
+
+		CheckLayout(layout, crops);
+		fill += layout.GetFill();
+	}
+
+	// Lines of text pack densely, far better than the bounding box of the crops on screen
+	CHECK(fill / trials > 0.6);
+
+	CHECK(AtlasPacker::Pack({}, Spacing).pieces.empty());
+	CHECK(AtlasPacker::Pack({}, Spacing).GetFill() == 0.0f);
+}
+
+// Boxes recognized in the atlas land on the screen where their text was, clipped to their piece
+static void TestToScreen()
+{
+	std::vector<ImageRect> crops = { { 100, 900, 600, 30 }, { 1500, 40, 200, 20 }, { 700, 500, 300, 24 } };
+	AtlasLayout layout = AtlasPacker::Pack(crops, Spacing);
+
+	CheckLayout(layout, crops);
+
+	for (const AtlasPiece& piece : layout.pieces)
+	{
+		float x = float(piece.x + 10);
+		float y = float(piece.y + 1);
+		float w = float(piece.screen.width / 3);
+		float h = float(piece.screen.height - 2);
+
+		CHECK(layout.ToScreen(&x, &y, &w, &h));
+		CHECK(x == piece.screen.x + 10 && y == piece.screen.y + 1);
+		CHECK(w == float(piece.screen.width / 3) && h == float(piece.screen.height - 2));
+
+		// A box reaching past the right edge of its piece, towards a neighbour, is cut at the edge
+		x = float(piece.x + piece.screen.width - 20);
+		y = float(piece.y);
+		w = 30.0f;
+		h = float(piece.screen.height);
+
+		CHECK(layout.ToScreen(&x, &y, &w, &h));
+		CHECK(x == piece.screen.x + piece.screen.width - 20 && w == 20.0f);
+	}
+
+	float x = 0.0f;
+	float y = 0.0f;
+	float w = 1.0f;
+	float h = 1.0f;
+
+	CHECK(!AtlasLayout().ToScreen(&x, &y, &w, &h));
+}
+
+int main()
+{
+	TestPack();
+	TestToScreen();
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Bench.h"
+#include "FontMetrics.h"
+
+// Glyph lookup of FontMetrics against a linear scan of the glyph table, with build/font.spritefont
+int main()
+{
+	FontMetrics font;
+
+	if (!font.Load(FONT_PATH))
+	{
+		std::printf("Cannot load %s\n", FONT_PATH);
+		return 1;
+	}
+
+	// The glyphs in table order, what a linear scan walks through
+	std::vector<FontMetrics::Glyph> table;
+
+	for (uint32_t character = 0; character < 0x10000; character++)
+	{
+		if (const FontMetrics::Glyph* glyph = font.FindGlyph(character))
+		{
+			table.push_back(*glyph);
+		}
+	}
+
+	auto scan = [&table](uint32_t character) -> const FontMetrics::Glyph*
+	{
+		for (const FontMetrics::Glyph& glyph : table)
+		{
+			if (glyph.character == character)
+			{
+				return &glyph;
+			}
+		}
+
+		return nullptr;
+	};
+
+	// Mostly ASCII text with some box drawing characters from the end of the table
+	std::vector<uint32_t> text;
+
+	for (int i = 0; i < 4096; i++)
+	{
+		text.push_back(i % 16 == 15 ? 0x2500 + uint32_t(i % 0x50) : 'a' + uint32_t(i % 26));
+	}
+
+	double directUs = MeasureUs([&]()
+	{
+		for (uint32_t character : text)
+		{
+			Consume(uintptr_t(font.FindGlyph(character)));
+		}
+	});
+
+	double scanUs = MeasureUs([&]()
+	{
+		for (uint32_t character : text)
+		{
+			Consume(uintptr_t(scan(character)));
+		}
+	});
+
+	const char* line = "The quick brown fox jumps over the lazy dog";
+	double measureUs = MeasureUs([&]() { Consume(uint64_t(font.MeasureString(line).width)); });
+
+	std::printf("%zu glyphs\n", font.GetGlyphCount());
+	std::printf("lookup  table and ranges %6.2f ns  linear scan %6.2f ns\n",
+		directUs * 1000.0 / text.size(), scanUs * 1000.0 / text.size());
+	std::printf("measure 43 characters    %6.2f us\n", measureUs);
+
+	return 0;
+}
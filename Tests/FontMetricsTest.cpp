@@ -0,0 +1,253 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "Check.h"
+#include "FontMetrics.h"
+
+// Writes a .spritefont with the given glyphs and no texture
+struct FontWriter
+{
+	std::vector<uint8_t> data;
+
+	void U32(uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			data.push_back(uint8_t(value >> (8 * i)));
+		}
+	}
+
+	void F32(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		U32(bits);
+	}
+
+	// Glyph of width x height pixels with the given offsets
+	void Glyph(uint32_t character, int width, int height, float xOffset, float yOffset, float xAdvance)
+	{
+		U32(character);
+		U32(0);
+		U32(0);
+		U32(uint32_t(width));
+		U32(uint32_t(height));
+		F32(xOffset);
+		F32(yOffset);
+		F32(xAdvance);
+	}
+};
+
+// A small font: a 3x3 space, 'A', and '?' as the default character
+static std::vector<uint8_t> MakeFont(uint32_t defaultCharacter)
+{
+	FontWriter writer;
+	writer.data.assign({ 'D', 'X', 'T', 'K', 'f', 'o', 'n', 't' });
+	writer.U32(3);
+	writer.Glyph('?', 8, 20, 1.0f, 2.0f, 1.0f);
+	writer.Glyph(' ', 3, 3, 0.0f, 0.0f, 2.0f);
+	writer.Glyph('A', 10, 16, -2.0f, 4.0f, 0.0f);
+	writer.F32(18.0f);
+	writer.U32(defaultCharacter);
+	return writer.data;
+}
+
+static bool Near(float a, float b)
+{
+	return std::fabs(a - b) < 1e-3f;
+}
+
+// build/font.spritefont as MakeSpriteFont wrote it
+static void TestLoadFile()
+{
+	FontMetrics font;
+
+	CHECK(font.Load(FONT_PATH));
+	CHECK(font.IsLoaded());
+	CHECK(font.GetGlyphCount() == 332);
+	CHECK(Near(font.GetLineSpacing(), 29.052084f));
+	CHECK(font.GetDefaultCharacter() == 0);
+
+	const FontMetrics::Glyph* a = font.FindGlyph('A');
+	CHECK(a != nullptr && a->character == 'A');
+	CHECK(a->right - a->left == 14 && a->bottom - a->top == 16);
+	CHECK(a->xOffset == 3.0f && a->xAdvance == -4.0f);
+
+	// No default character, a character the font lacks cannot be drawn
+	CHECK(font.FindGlyph(0x3042) == nullptr);
+
+	FontMetrics missing;
+	CHECK(!missing.Load("does-not-exist.spritefont"));
+	CHECK(!missing.IsLoaded());
+}
+
+// The direct table and the ranges find the same glyph as a scan of the raw table, for every character
+static void TestLookupMatchesLinearScan()
+{
+	std::ifstream file(FONT_PATH, std::ios::binary);
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	FontMetrics font;
+	CHECK(font.Load(data.data(), data.size()));
+
+	uint32_t count = data[8] | data[9] << 8 | data[10] << 16 | uint32_t(data[11]) << 24;
+
+	for (uint32_t character = 0; character < 0x30000; character++)
+	{
+		const uint8_t* raw = nullptr;
+
+		for (uint32_t i = 0; i < count && raw == nullptr; i++)
+		{
+			const uint8_t* glyph = &data[12 + size_t(i) * 32];
+
+			if ((glyph[0] | glyph[1] << 8 | glyph[2] << 16 | uint32_t(glyph[3]) << 24) == character)
+			{
+				raw = glyph;
+			}
+		}
+
+		const FontMetrics::Glyph* found = font.FindGlyph(character);
+
+		CHECK((found == nullptr) == (raw == nullptr));
+		CHECK(found == nullptr || (found->character == character && found->right == int32_t(raw[12] | raw[13] << 8)));
+	}
+}
+
+// Expected sizes worked out by hand the way SpriteFont::MeasureString computes them
+static void TestMeasureFile()
+{
+	FontMetrics font;
+	CHECK(font.Load(FONT_PATH));
+
+	float lineSpacing = font.GetLineSpacing();
+
+	// 'A': x offset 3, 14 wide. Shorter than a line, so a line high.
+	TextSize size = font.MeasureString("A");
+	CHECK(Near(size.width, 17.0f) && Near(size.height, lineSpacing));
+
+	// The pen stands at 3 + 14 - 4 after 'A', 'B' adds its x offset of 5 and is 11 wide
+	size = font.MeasureString("AB");
+	CHECK(Near(size.width, 29.0f));
+
+	// The space glyph is 1x1: not measured itself, but it moves the pen by 15 + 1 - 11
+	size = font.MeasureString(" A");
+	CHECK(Near(size.width, 22.0f));
+	size = font.MeasureString("A ");
+	CHECK(Near(size.width, 17.0f));
+	size = font.MeasureString("   ");
+	CHECK(size.width == 0.0f && size.height == 0.0f);
+
+	// '\n' starts a new line at x 0, '\r' is ignored
+	size = font.MeasureString("AB\r\nA");
+	CHECK(Near(size.width, 29.0f) && Near(size.height, 2.0f * lineSpacing));
+
+	size = font.MeasureString("");
+	CHECK(size.width == 0.0f && size.height == 0.0f);
+
+	// A character without a glyph in a font without a default character, where SpriteFont throws
+	size = font.MeasureString("A\xe3\x81\x82");
+	CHECK(size.width == 0.0f && size.height == 0.0f);
+}
+
+static void TestDefaultCharacter()
+{
+	std::vector<uint8_t> data = MakeFont('?');
+	FontMetrics font;
+
+	CHECK(font.Load(data.data(), data.size()));
+	CHECK(font.GetDefaultCharacter() == '?');
+
+	// Missing characters and malformed UTF-8 are drawn with '?'
+	CHECK(font.FindGlyph(0x3042) == font.FindGlyph('?'));
+
+	TextSize question = font.MeasureString("?");
+	CHECK(Near(question.width, 9.0f) && Near(question.height, 22.0f));
+
+	TextSize missing = font.MeasureString("\xe3\x81\x82");
+	CHECK(Near(missing.width, question.width) && Near(missing.height, question.height));
+
+	missing = font.MeasureString("\xff");
+	CHECK(Near(missing.width, question.width));
+
+	// The x offset of 'A' is clamped to the left edge
+	TextSize a = font.MeasureString("A");
+	CHECK(Near(a.width, 10.0f) && Near(a.height, 20.0f));
+
+	// A space larger than 1x1 is measured, and only a line high
+	TextSize space = font.MeasureString(" ");
+	CHECK(Near(space.width, 3.0f) && Near(space.height, 18.0f));
+
+	// The trailing space counts: the pen stands at 10 after 'A', the space ends at 13
+	TextSize trailing = font.MeasureString("A ");
+	CHECK(Near(trailing.width, 13.0f));
+}
+
+// Characters outside the BMP are looked up as their two UTF-16 surrogates, as SpriteFont does
+static void TestSurrogates()
+{
+	std::vector<uint8_t> data = MakeFont('?');
+	FontMetrics font;
+
+	CHECK(font.Load(data.data(), data.size()));
+
+	// U+1F600 is drawn as two default glyphs, not one
+	TextSize twice = font.MeasureString("??");
+	TextSize emoji = font.MeasureString("\xf0\x9f\x98\x80");
+	CHECK(Near(emoji.width, twice.width) && Near(emoji.height, twice.height));
+
+	int glyphs = 0;
+	font.ForEachGlyph("A\xf0\x9f\x98\x80", [&glyphs](const FontMetrics::Glyph*, float, float) { glyphs++; });
+	CHECK(glyphs == 3);
+
+	// A font that has the surrogates draws their glyphs
+	FontWriter writer;
+	writer.data.assign({ 'D', 'X', 'T', 'K', 'f', 'o', 'n', 't' });
+	writer.U32(2);
+	writer.Glyph(0xd83d, 4, 10, 0.0f, 0.0f, 0.0f);
+	writer.Glyph(0xde00, 6, 10, 0.0f, 0.0f, 0.0f);
+	writer.F32(12.0f);
+	writer.U32(0);
+
+	FontMetrics surrogates;
+	CHECK(surrogates.Load(writer.data.data(), writer.data.size()));
+
+	TextSize drawn = surrogates.MeasureString("\xf0\x9f\x98\x80");
+	CHECK(Near(drawn.width, 10.0f) && Near(drawn.height, 12.0f));
+
+	// Without a default character a missing surrogate cannot be drawn
+	CHECK(surrogates.MeasureString("\xf0\x9f\x98\x81").width == 0.0f);
+
+	// Past U+10FFFF there is no UTF-16 form, the four bytes are one U+FFFD
+	const char* beyond = "\xf4\x90\x80\x80";
+	CHECK(FontMetrics::DecodeUtf8(&beyond) == 0xfffd && *beyond == '\0');
+}
+
+static void TestMalformedFiles()
+{
+	std::vector<uint8_t> data = MakeFont('?');
+	FontMetrics font;
+
+	// The glyph table runs past the end
+	CHECK(!font.Load(data.data(), data.size() - 1));
+	CHECK(!font.IsLoaded());
+
+	data[0] = 'X';
+	CHECK(!font.Load(data.data(), data.size()));
+	CHECK(!font.Load(data.data(), 4));
+}
+
+int main()
+{
+	TestLoadFile();
+	TestLookupMatchesLinearScan();
+	TestMeasureFile();
+	TestDefaultCharacter();
+	TestSurrogates();
+	TestMalformedFiles();
+
+	return 0;
+}
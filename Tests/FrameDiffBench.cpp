@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Bench.h"
+#include "FrameDiff.h"
+
+// A frame of game-like content: a gradient background with rows of text-sized stripes
+static std::vector<uint8_t> MakeFrame(int width, int height, uint32_t seed)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+			bool glyph = (y / 24) % 3 == 0 && ((x + seed) / 3) % 4 == 0 && y % 24 > 4;
+
+			pixel[0] = uint8_t(glyph ? 240 : x * 255 / width);
+			pixel[1] = uint8_t(glyph ? 240 : y * 255 / height);
+			pixel[2] = uint8_t(glyph ? 240 : 64);
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+static ImageView MakeView(std::vector<uint8_t>& pixels, int width, int height)
+{
+	ImageView view;
+	view.pixels = pixels.data();
+	view.width = width;
+	view.height = height;
+	view.rowPitch = size_t(width) * 4;
+	view.bgra = true;
+	return view;
+}
+
+static void Run(const char* name, int width, int height)
+{
+	std::vector<uint8_t> first = MakeFrame(width, height, 0);
+	std::vector<uint8_t> second = MakeFrame(width, height, 0);
+
+	// One line of text changed
+	for (int x = 100; x < 700; x++)
+	{
+		for (int y = 26; y < 46; y++)
+		{
+			second[(size_t(y) * width + x) * 4] ^= 0x80;
+		}
+	}
+
+	ImageView a = MakeView(first, width, height);
+	ImageView b = MakeView(second, width, height);
+	FrameDiff::Signature previous = FrameDiff::ComputeSignature(a);
+	FrameDiff::Signature current;
+
+	double signatureUs = MeasureUs([&]() { current = FrameDiff::ComputeSignature(b); });
+	double compareUs = MeasureUs([&]() { Consume(FrameDiff::IsSameFrame(current, previous, 4, 0)); });
+	double dirtyUs = MeasureUs([&]() { Consume(FrameDiff::FindDirtyRects(current, previous, 4).size()); });
+
+	double megabytes = double(width) * height * 4 / (1024.0 * 1024.0);
+
+	std::printf("%-6s signature %8.1f us (%6.0f MB/s)  compare %6.2f us  dirty rects %6.2f us\n",
+		name, signatureUs, megabytes / (signatureUs / 1e6), compareUs, dirtyUs);
+}
+
+int main()
+{
+	Run("1080p", 1920, 1080);
+	Run("4K", 3840, 2160);
+
+	return 0;
+}
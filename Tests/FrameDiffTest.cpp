@@ -0,0 +1,155 @@
+#include <cstdint>
+#include <vector>
+
+#include "Check.h"
+#include "FrameDiff.h"
+
+// A frame of one color, pixels can be changed afterwards through Set
+struct TestFrame
+{
+	std::vector<uint8_t> pixels;
+	ImageView view;
+
+	TestFrame(int width, int height, uint8_t value)
+	{
+		pixels.assign(size_t(width) * height * 4, value);
+		view.pixels = pixels.data();
+		view.width = width;
+		view.height = height;
+		view.rowPitch = size_t(width) * 4;
+		view.bgra = true;
+	}
+
+	void Fill(int x, int y, int width, int height, uint8_t value)
+	{
+		for (int row = y; row < y + height; row++)
+		{
+			for (int column = x; column < x + width; column++)
+			{
+				uint8_t* pixel = &pixels[(size_t(row) * view.width + column) * 4];
+				pixel[0] = pixel[1] = pixel[2] = value;
+			}
+		}
+	}
+};
+
+static void TestLuma()
+{
+	uint8_t white[4] = { 255, 255, 255, 255 };
+	uint8_t red[4] = { 255, 0, 0, 255 };
+
+	CHECK(FrameDiff::Luma(white, false) == 255);
+	// The channel order decides which byte is red
+	CHECK(FrameDiff::Luma(red, false) == 76);
+	CHECK(FrameDiff::Luma(red, true) == 28);
+}
+
+static void TestSignatureLayout()
+{
+	TestFrame frame(100, 40, 128);
+	FrameDiff::Signature signature = FrameDiff::ComputeSignature(frame.view, 16);
+
+	CHECK(signature.IsValid());
+	CHECK(signature.columns == 7);
+	CHECK(signature.rows == 3);
+	CHECK(signature.luma.size() == 21);
+	CHECK(signature.luma[0] == 128);
+	CHECK(signature.detail[0] == 0);
+
+	ImageView empty;
+	CHECK(!FrameDiff::ComputeSignature(empty).IsValid());
+}
+
+static void TestSameFrame()
+{
+	TestFrame a(128, 64, 50);
+	TestFrame b(128, 64, 50);
+	FrameDiff::Signature first = FrameDiff::ComputeSignature(a.view);
+
+	CHECK(FrameDiff::CountChangedBlocks(first, FrameDiff::ComputeSignature(b.view), 4) == 0);
+
+	// Noise below the tolerance is the same frame
+	b.Fill(0, 0, 128, 64, 52);
+	CHECK(FrameDiff::IsSameFrame(first, FrameDiff::ComputeSignature(b.view), 4, 0));
+
+	// Text in one block changes its detail even where the mean brightness stays about the same
+	for (int x = 2; x < 14; x += 4)
+	{
+		b.Fill(x, 0, 2, 16, 0);
+		b.Fill(x + 2, 0, 2, 16, 104);
+	}
+
+	FrameDiff::Signature second = FrameDiff::ComputeSignature(b.view);
+	CHECK(second.luma[0] == first.luma[0] + 2);
+	CHECK(FrameDiff::CountChangedBlocks(first, second, 4) == 1);
+	CHECK(!FrameDiff::IsSameFrame(first, second, 4, 0));
+	CHECK(FrameDiff::IsSameFrame(first, second, 4, 1));
+}
+
+static void TestDifferentSizes()
+{
+	TestFrame a(64, 64, 0);
+	TestFrame b(64, 32, 0);
+
+	CHECK(FrameDiff::CountChangedBlocks(FrameDiff::ComputeSignature(a.view), FrameDiff::ComputeSignature(b.view), 4) == -1);
+	CHECK(!FrameDiff::IsSameFrame(FrameDiff::ComputeSignature(a.view), FrameDiff::ComputeSignature(b.view), 4, 100));
+}
+
+static void TestDirtyRects()
+{
+	// The last column of blocks is only 10 pixels wide
+	TestFrame a(250, 128, 30);
+	TestFrame b(250, 128, 30);
+	FrameDiff::Signature previous = FrameDiff::ComputeSignature(a.view);
+
+	CHECK(FrameDiff::FindDirtyRects(FrameDiff::ComputeSignature(b.view), previous, 4).empty());
+
+	// Two separate changes give two rects, each grown by a block of padding
+	b.Fill(40, 40, 10, 10, 200);
+	b.Fill(236, 100, 14, 8, 200);
+
+	std::vector<ImageRect> rects = FrameDiff::FindDirtyRects(FrameDiff::ComputeSignature(b.view), previous, 4);
+	CHECK(rects.size() == 2);
+	CHECK(rects[0].x == 16 && rects[0].y == 16 && rects[0].width == 64 && rects[0].height == 64);
+	// Clipped to the frame
+	CHECK(rects[1].x == 208 && rects[1].y == 80 && rects[1].Right() == 250 && rects[1].Bottom() == 128);
+
+	// Padded regions that overlap are merged into one
+	b.Fill(70, 40, 10, 10, 200);
+	rects = FrameDiff::FindDirtyRects(FrameDiff::ComputeSignature(b.view), previous, 4);
+	CHECK(rects.size() == 2);
+	CHECK(rects[0].x == 16 && rects[0].width == 96);
+
+	// Most of the frame changed, a single full frame upload is cheaper
+	b.Fill(0, 0, 250, 100, 220);
+	rects = FrameDiff::FindDirtyRects(FrameDiff::ComputeSignature(b.view), previous, 4);
+	CHECK(rects.size() == 1);
+	CHECK(rects[0].x == 0 && rects[0].y == 0 && rects[0].width == 250 && rects[0].height == 128);
+
+	// Nothing to compare with
+	rects = FrameDiff::FindDirtyRects(previous, FrameDiff::Signature(), 4);
+	CHECK(rects.size() == 1 && rects[0].Area() == 250 * 128);
+}
+
+static void TestCropView()
+{
+	TestFrame frame(64, 32, 0);
+	frame.Fill(10, 5, 1, 1, 99);
+
+	ImageView crop = CropView(frame.view, { 10, 5, 20, 10 });
+	CHECK(crop.width == 20 && crop.height == 10);
+	CHECK(crop.rowPitch == frame.view.rowPitch);
+	CHECK(crop.Row(0)[0] == 99);
+}
+
+int main()
+{
+	TestLuma();
+	TestSignatureLayout();
+	TestSameFrame();
+	TestDifferentSizes();
+	TestDirtyRects();
+	TestCropView();
+
+	return 0;
+}
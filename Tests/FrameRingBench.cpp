@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Bench.h"
+#include "FrameRing.h"
+#include "SharedMemory.h"
+
+// Sends every byte, false when the connection broke
+static bool SendAll(int socket, const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t sent = send(socket, data, size, 0);
+
+		if (sent <= 0)
+		{
+			return false;
+		}
+
+		data += sent;
+		size -= size_t(sent);
+	}
+
+	return true;
+}
+
+static bool ReceiveAll(int socket, uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t received = recv(socket, data, size, 0);
+
+		if (received <= 0)
+		{
+			return false;
+		}
+
+		data += received;
+		size -= size_t(received);
+	}
+
+	return true;
+}
+
+// A 4K BMP handed to a consumer on the same machine: through the shared memory ring, where the consumer copies
+// it out of the slot, and over loopback TCP, where the consumer acknowledges it after the last byte
+int main()
+{
+	const size_t size = size_t(3840) * 2160 * 4 + 54;
+	const int slotCount = 2;
+	const size_t slotBytes = 40 * 1024 * 1024;
+	std::vector<uint8_t> frame(size);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		frame[i] = uint8_t(i * 7);
+	}
+
+	SharedMemory memory;
+
+	if (!memory.Create(SharedMemory::GetUniqueName("FrameRingBench", 0), FrameRing::GetMappingSize(slotCount, slotBytes)))
+	{
+		std::printf("Cannot create shared memory\n");
+		return 1;
+	}
+
+	FrameRing ring(memory.GetData(), slotCount, slotBytes);
+	FrameRing::Frame written;
+	std::vector<uint8_t> copy;
+
+	double writeUs = MeasureUs([&]() { Consume(ring.Write(frame.data(), size, &written)); });
+	double readUs = MeasureUs([&]() { Consume(FrameRing::Read(memory.GetData(), memory.GetSize(), written, &copy)); });
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressSize = sizeof(address);
+
+	if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0 ||
+		getsockname(listener, (sockaddr*)&address, &addressSize) != 0)
+	{
+		std::printf("Cannot listen on loopback\n");
+		return 1;
+	}
+
+	std::thread consumer([listener, size]()
+	{
+		int connection = accept(listener, nullptr, nullptr);
+		std::vector<uint8_t> received(size);
+		uint8_t ack = 1;
+
+		while (ReceiveAll(connection, received.data(), size) && SendAll(connection, &ack, 1))
+		{
+		}
+
+		close(connection);
+	});
+
+	int client = socket(AF_INET, SOCK_STREAM, 0);
+	int noDelay = 1;
+	setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+	if (connect(client, (sockaddr*)&address, sizeof(address)) != 0)
+	{
+		std::printf("Cannot connect to loopback\n");
+		return 1;
+	}
+
+	double tcpUs = MeasureUs([&]()
+	{
+		uint8_t ack = 0;
+		Consume(SendAll(client, frame.data(), size) && ReceiveAll(client, &ack, 1));
+	});
+
+	close(client);
+	consumer.join();
+	close(listener);
+
+	std::printf("%.1f MB frame: shared memory %.2f ms (write %.2f ms, read %.2f ms), loopback TCP %.2f ms\n",
+		size / (1024.0 * 1024.0), (writeUs + readUs) / 1000.0, writeUs / 1000.0, readUs / 1000.0, tcpUs / 1000.0);
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#include "Check.h"
+#include "FrameRing.h"
+#include "SharedMemory.h"
+
+static std::vector<uint8_t> CreateFrame(size_t size, uint8_t value)
+{
+	return std::vector<uint8_t>(size, value);
+}
+
+static void TestWriteRead()
+{
+	const int slotCount = 3;
+	const size_t slotBytes = 1000;
+	std::vector<uint8_t> memory(FrameRing::GetMappingSize(slotCount, slotBytes));
+	FrameRing ring(memory.data(), slotCount, slotBytes);
+	std::vector<FrameRing::Frame> frames(4);
+	std::vector<uint8_t> data;
+
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(ring.Write(CreateFrame(100 + i, uint8_t(i)).data(), 100 + i, &frames[i]));
+		CHECK(frames[i].slot == i);
+	}
+
+	CHECK(FrameRing::Read(memory.data(), memory.size(), frames[1], &data));
+	CHECK(data == CreateFrame(101, 1));
+
+	// The fourth frame reuses the first slot, the frame that was there is gone
+	CHECK(ring.Write(CreateFrame(slotBytes, 3).data(), slotBytes, &frames[3]));
+	CHECK(frames[3].slot == 0 && frames[3].sequence > frames[0].sequence);
+	CHECK(!FrameRing::Read(memory.data(), memory.size(), frames[0], &data));
+	CHECK(FrameRing::Read(memory.data(), memory.size(), frames[3], &data));
+	CHECK(data == CreateFrame(slotBytes, 3));
+
+	// Frames larger than a slot are not written
+	FrameRing::Frame tooLarge;
+	CHECK(!ring.Write(CreateFrame(slotBytes + 1, 4).data(), slotBytes + 1, &tooLarge));
+	CHECK(FrameRing::Read(memory.data(), memory.size(), frames[1], &data));
+}
+
+// The reader trusts nothing in the memory it is given
+static void TestBadMemory()
+{
+	const int slotCount = 2;
+	const size_t slotBytes = 64;
+	std::vector<uint8_t> memory(FrameRing::GetMappingSize(slotCount, slotBytes));
+	FrameRing ring(memory.data(), slotCount, slotBytes);
+	FrameRing::Frame frame;
+	std::vector<uint8_t> data;
+
+	CHECK(ring.Write("frame", 5, &frame));
+	CHECK(FrameRing::Read(memory.data(), memory.size(), frame, &data));
+
+	CHECK(!FrameRing::Read(memory.data(), FrameRing::HeaderSize - 1, frame, &data));
+	CHECK(!FrameRing::Read(memory.data(), memory.size() - 1, frame, &data));
+	CHECK(!FrameRing::Read(memory.data(), memory.size(), FrameRing::Frame{ -1, frame.sequence }, &data));
+	CHECK(!FrameRing::Read(memory.data(), memory.size(), FrameRing::Frame{ slotCount, frame.sequence }, &data));
+	CHECK(!FrameRing::Read(memory.data(), memory.size(), FrameRing::Frame{ frame.slot, frame.sequence + 2 }, &data));
+
+	std::vector<uint8_t> bad = memory;
+	bad[0] ^= 1;
+	CHECK(!FrameRing::Read(bad.data(), bad.size(), frame, &data));
+
+	// A slot count that would put the slots past the memory
+	bad = memory;
+	uint32_t slots = 1000;
+	std::memcpy(&bad[8], &slots, sizeof(slots));
+	CHECK(!FrameRing::Read(bad.data(), bad.size(), frame, &data));
+
+	// A frame size larger than its slot
+	bad = memory;
+	uint64_t size = slotBytes + 1;
+	std::memcpy(&bad[FrameRing::HeaderSize + size_t(frame.slot) * FrameRing::DescriptorSize + 8], &size, sizeof(size));
+	CHECK(!FrameRing::Read(bad.data(), bad.size(), frame, &data));
+}
+
+// A reader racing the writer gets either the whole frame it asked for or nothing
+static void TestConcurrentReads()
+{
+	const int slotCount = 2;
+	const size_t slotBytes = 64 * 1024;
+	std::vector<uint8_t> memory(FrameRing::GetMappingSize(slotCount, slotBytes));
+	FrameRing ring(memory.data(), slotCount, slotBytes);
+	std::atomic<uint64_t> published{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::thread writer([&]
+	{
+		for (int i = 0; i < 20000; i++)
+		{
+			FrameRing::Frame frame;
+			ring.Write(CreateFrame(slotBytes, uint8_t(i)).data(), slotBytes, &frame);
+			published.store(frame.sequence << 8 | uint64_t(frame.slot), std::memory_order_relaxed);
+		}
+
+		done = true;
+	});
+
+	int complete = 0;
+	std::vector<uint8_t> data;
+
+	while (!done)
+	{
+		uint64_t last = published.load(std::memory_order_relaxed);
+		FrameRing::Frame frame{ int(last & 0xff), last >> 8 };
+
+		if (frame.sequence != 0 && FrameRing::Read(memory.data(), memory.size(), frame, &data))
+		{
+			CHECK(data.size() == slotBytes);
+			CHECK(std::memcmp(data.data(), CreateFrame(slotBytes, data[0]).data(), slotBytes) == 0);
+			complete++;
+		}
+	}
+
+	writer.join();
+	CHECK(complete > 0);
+}
+
+#ifndef _WIN32
+// A frame written here is read by another process that maps the memory by its name, as the server does
+static void TestOtherProcess()
+{
+	const int slotCount = 2;
+	const size_t slotBytes = 4096;
+	SharedMemory memory;
+
+	CHECK(memory.Create(SharedMemory::GetUniqueName("FrameRingTest", 0), FrameRing::GetMappingSize(slotCount, slotBytes)));
+
+	FrameRing ring(memory.GetData(), slotCount, slotBytes);
+	FrameRing::Frame frame;
+	std::string text = "frame in shared memory";
+
+	CHECK(ring.Write(text.data(), text.size(), &frame));
+
+	pid_t child = fork();
+	CHECK(child >= 0);
+
+	if (child == 0)
+	{
+		int file = shm_open(("/" + memory.GetName()).c_str(), O_RDONLY, 0);
+		void* view = file < 0 ? MAP_FAILED : mmap(nullptr, memory.GetSize(), PROT_READ, MAP_SHARED, file, 0);
+		std::vector<uint8_t> data;
+
+		bool read = view != MAP_FAILED && FrameRing::Read(view, memory.GetSize(), frame, &data)
+			&& std::string(data.begin(), data.end()) == text;
+
+		_exit(read ? 0 : 1);
+	}
+
+	int status = 0;
+	CHECK(waitpid(child, &status, 0) == child);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	// The name is gone once the memory is closed
+	std::string name = "/" + memory.GetName();
+	memory.Close();
+	CHECK(shm_open(name.c_str(), O_RDONLY, 0) < 0);
+}
+#endif
+
+int main()
+{
+	TestWriteRead();
+	TestBadMemory();
+	TestConcurrentReads();
+#ifndef _WIN32
+	TestOtherProcess();
+#endif
+
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "HedgedTransport.h"
+#include "MockHttpServer.h"
+#include "PosixSocketTransport.h"
+
+// Hedges after 50 ms from the first request on, every request may be hedged
+static const HedgeOptions EagerHedging = { 95.0f, 0, 50, 1.0f };
+
+// Answers with its name after delayMs, after firstDelayMs spent before anything is sent
+static MockHttpServer::Handler Answering(const std::string& name, int firstDelayMs, int delayMs = 0, size_t bytesBeforeDelay = 0)
+{
+	return [name, firstDelayMs, delayMs, bytesBeforeDelay](const MockRequest&)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(firstDelayMs));
+
+		MockResponse response;
+		response.body = name;
+		response.delayMs = delayMs;
+		response.bytesBeforeDelay = bytesBeforeDelay;
+		return response;
+	};
+}
+
+// One connection per server for the worker and one for the hedge thread
+static std::unique_ptr<HedgedTransport> Connect(const std::vector<MockHttpServer*>& servers, const HedgeOptions& hedging)
+{
+	std::vector<std::unique_ptr<ITransport>> transports;
+	std::vector<std::unique_ptr<ITransport>> hedgeTransports;
+
+	for (MockHttpServer* server : servers)
+	{
+		transports.push_back(std::make_unique<PosixSocketTransport>("127.0.0.1", server->GetPort()));
+		hedgeTransports.push_back(std::make_unique<PosixSocketTransport>("127.0.0.1", server->GetPort()));
+	}
+
+	return std::make_unique<HedgedTransport>(std::move(transports), std::move(hedgeTransports), LoadBalancerOptions(), hedging);
+}
+
+// Sends one request and collects the body the sink received, elapsedMs is the time it took
+static bool Send(HedgedTransport& transport, std::string* received, int64_t* elapsedMs)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	received->clear();
+	transport.BeginAttempt();
+
+	bool succeeded = transport.Send(L"POST", L"/translate", L"", "frame", 5,
+		[received](const char* data, size_t size)
+		{
+			received->append(data, size);
+			return true;
+		});
+
+	*elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	return succeeded;
+}
+
+// A primary that does not answer within the hedge delay loses to the hedge sent to the other server
+static void TestHedgeWins()
+{
+	MockHttpServer slow(Answering("slow", 0, 2000));
+	MockHttpServer fast(Answering("fast", 0));
+	std::unique_ptr<HedgedTransport> transport = Connect({ &slow, &fast }, EagerHedging);
+	std::string received;
+	int64_t elapsedMs = 0;
+
+	transport->StartHedging();
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "fast");
+	CHECK(elapsedMs < 1000);
+	CHECK(slow.GetRequestCount() == 1);
+	CHECK(fast.GetRequestCount() == 1);
+	CHECK(transport->GetHedgeCount() == 1);
+}
+
+// A request answered within the hedge delay is sent once
+static void TestNoHedgeWhenFast()
+{
+	MockHttpServer first(Answering("first", 0));
+	MockHttpServer second(Answering("second", 0));
+	std::unique_ptr<HedgedTransport> transport = Connect({ &first, &second }, EagerHedging);
+	std::string received;
+	int64_t elapsedMs = 0;
+
+	transport->StartHedging();
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "first");
+	CHECK(second.GetRequestCount() == 0);
+	CHECK(transport->GetHedgeCount() == 0);
+}
+
+// The attempt whose response starts first wins, although the other one would end first. The primary starts
+// answering after 150 ms, after the hedge went out at 50 ms, and only ends 300 ms later. The hedge would end
+// at 250 ms, it is cancelled once the primary claimed the exchange, and its bytes never reach the sink.
+static void TestClaimHandoff()
+{
+	MockHttpServer primary(Answering("primary response", 150, 300, 7));
+	MockHttpServer hedge(Answering("hedge", 200));
+	std::unique_ptr<HedgedTransport> transport = Connect({ &primary, &hedge }, EagerHedging);
+	std::string received;
+	int64_t elapsedMs = 0;
+
+	transport->StartHedging();
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "primary response");
+	CHECK(elapsedMs >= 400);
+	CHECK(hedge.GetRequestCount() == 1);
+	CHECK(transport->GetHedgeCount() == 1);
+
+	// The same the other way round: the hedge starts answering first and the slow primary is cancelled
+	MockHttpServer stuck(Answering("stuck", 0, 2000));
+	MockHttpServer streaming(Answering("hedge response", 0, 300, 6));
+	transport = Connect({ &stuck, &streaming }, EagerHedging);
+	transport->StartHedging();
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "hedge response");
+	CHECK(elapsedMs < 2000);
+}
+
+// A request the server failed before answering is sent to the next server
+static void TestRetryOnFailure()
+{
+	MockHttpServer failing([](const MockRequest&) { MockResponse response; response.drop = true; return response; });
+	MockHttpServer working(Answering("working", 0));
+	std::unique_ptr<HedgedTransport> transport = Connect({ &failing, &working }, EagerHedging);
+	std::string received;
+	int64_t elapsedMs = 0;
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "working");
+	CHECK(failing.GetRequestCount() >= 1);
+	CHECK(working.GetRequestCount() == 1);
+}
+
+// Without budget no request is hedged, the slow primary is waited for
+static void TestNoBudget()
+{
+	HedgeOptions options = EagerHedging;
+	options.budget = 0.0f;
+
+	MockHttpServer slow(Answering("slow", 0, 300));
+	MockHttpServer fast(Answering("fast", 0));
+	std::unique_ptr<HedgedTransport> transport = Connect({ &slow, &fast }, options);
+	std::string received;
+	int64_t elapsedMs = 0;
+
+	transport->StartHedging();
+
+	CHECK(Send(*transport, &received, &elapsedMs));
+	CHECK(received == "slow");
+	CHECK(elapsedMs >= 300);
+	CHECK(fast.GetRequestCount() == 0);
+	CHECK(transport->GetHedgeCount() == 0);
+}
+
+int main()
+{
+	TestHedgeWins();
+	TestNoHedgeWhenFast();
+	TestClaimHandoff();
+	TestRetryOnFailure();
+	TestNoBudget();
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Bench.h"
+#include "ImageEncoder.h"
+
+enum class Content
+{
+	// Flat panels with lines of text, like menus and dialogue boxes
+	Interface,
+	// Smooth gradients with text, like a sky behind subtitles
+	Gradient,
+	// Textured 3D scene, every pixel differs from its neighbours
+	Scene
+};
+
+static std::vector<uint8_t> MakeFrame(int width, int height, Content content)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	std::mt19937 random(7);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+			bool glyph = (y / 32) % 4 == 1 && (x / 3) % 5 < 2 && y % 32 > 8 && y % 32 < 28;
+			int r, g, b;
+
+			switch (content)
+			{
+			case Content::Interface:
+				r = (x / 480) * 40 + 20;
+				g = (y / 270) * 30 + 20;
+				b = 60;
+				break;
+			case Content::Gradient:
+				r = x * 255 / width;
+				g = y * 255 / height;
+				b = 128;
+				break;
+			default:
+				r = int(random() & 0xff);
+				g = (r + int(random() % 64)) & 0xff;
+				b = (x ^ y) & 0xff;
+				break;
+			}
+
+			pixel[0] = uint8_t(glyph ? 250 : b);
+			pixel[1] = uint8_t(glyph ? 250 : g);
+			pixel[2] = uint8_t(glyph ? 250 : r);
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+static void Run(const char* name, int width, int height, Content content)
+{
+	std::vector<uint8_t> pixels = MakeFrame(width, height, content);
+
+	ImageView view;
+	view.pixels = pixels.data();
+	view.width = width;
+	view.height = height;
+	view.rowPitch = size_t(width) * 4;
+	view.bgra = true;
+
+	std::vector<uint8_t> encoded;
+
+	double us = MeasureUs([&]()
+	{
+		encoded.clear();
+		ImageEncoder::EncodeQoi(view, &encoded);
+	});
+
+	double megabytes = double(pixels.size()) / (1024.0 * 1024.0);
+
+	// Compared with the 32-bit BMP that was uploaded before
+	std::printf("%-18s QOI %8.1f ms %7.0f MB/s  %6.1f MB -> %6.2f MB (%5.1fx)\n",
+		name, us / 1000.0, megabytes / (us / 1e6), megabytes, encoded.size() / (1024.0 * 1024.0), pixels.size() / double(encoded.size()));
+}
+
+int main()
+{
+	Run("1080p interface", 1920, 1080, Content::Interface);
+	Run("1080p gradient", 1920, 1080, Content::Gradient);
+	Run("1080p scene", 1920, 1080, Content::Scene);
+	Run("4K interface", 3840, 2160, Content::Interface);
+	Run("4K scene", 3840, 2160, Content::Scene);
+
+	return 0;
+}
@@ -0,0 +1,223 @@
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "ImageEncoder.h"
+
+// Decoder written after the QOI specification, independent of the encoder. Returns RGBA pixels.
+static bool DecodeQoi(const std::vector<uint8_t>& data, int* width, int* height, std::vector<uint8_t>* pixels)
+{
+	if (data.size() < 22 || memcmp(data.data(), "qoif", 4) != 0)
+	{
+		return false;
+	}
+
+	auto readBigEndian = [&data](size_t offset)
+	{
+		return uint32_t(data[offset]) << 24 | uint32_t(data[offset + 1]) << 16 | uint32_t(data[offset + 2]) << 8 | data[offset + 3];
+	};
+
+	*width = int(readBigEndian(4));
+	*height = int(readBigEndian(8));
+
+	uint8_t index[64][4] = {};
+	uint8_t pixel[4] = { 0, 0, 0, 255 };
+	size_t count = size_t(*width) * *height;
+	size_t position = 14;
+	size_t end = data.size() - 8;
+	int run = 0;
+
+	pixels->clear();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (run > 0)
+		{
+			run--;
+		}
+		else if (position < end)
+		{
+			uint8_t op = data[position++];
+
+			if (op == 0xfe)
+			{
+				pixel[0] = data[position++];
+				pixel[1] = data[position++];
+				pixel[2] = data[position++];
+			}
+			else if ((op & 0xc0) == 0x00)
+			{
+				memcpy(pixel, index[op], 4);
+			}
+			else if ((op & 0xc0) == 0x40)
+			{
+				pixel[0] += ((op >> 4) & 3) - 2;
+				pixel[1] += ((op >> 2) & 3) - 2;
+				pixel[2] += (op & 3) - 2;
+			}
+			else if ((op & 0xc0) == 0x80)
+			{
+				uint8_t next = data[position++];
+				int vg = (op & 0x3f) - 32;
+
+				pixel[0] += vg - 8 + ((next >> 4) & 0x0f);
+				pixel[1] += vg;
+				pixel[2] += vg - 8 + (next & 0x0f);
+			}
+			else
+			{
+				run = op & 0x3f;
+			}
+
+			memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+		}
+		else
+		{
+			return false;
+		}
+
+		pixels->insert(pixels->end(), pixel, pixel + 4);
+	}
+
+	return position == end && memcmp(&data[end], "\0\0\0\0\0\0\0\1", 8) == 0;
+}
+
+// Runs, repeated colors, small and large steps, the kinds of pixels every QOI op is made for
+static std::vector<uint8_t> CreatePixels(int width, int height, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+	uint8_t color[4] = { 0, 0, 0, 0 };
+
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		switch (random() % 5)
+		{
+		case 0:
+			break;
+		case 1:
+			color[random() % 3] += uint8_t(random() % 3) - 1;
+			break;
+		case 2:
+			color[1] += uint8_t(random() % 40) - 20;
+			break;
+		case 3:
+			color[random() % 3] = uint8_t(random());
+			break;
+		default:
+			color[0] = color[1] = color[2] = uint8_t(random() % 4 * 85);
+			break;
+		}
+
+		// Alpha is dropped by the encoder
+		color[3] = uint8_t(random());
+		memcpy(&pixels[i], color, 4);
+	}
+
+	return pixels;
+}
+
+static void TestRoundTrip(bool bgra)
+{
+	for (unsigned seed = 0; seed < 20; seed++)
+	{
+		int width = 1 + int(seed * 37 % 200);
+		int height = 1 + int(seed * 11 % 50);
+		std::vector<uint8_t> source = CreatePixels(width, height, seed);
+
+		ImageView view;
+		view.pixels = source.data();
+		view.width = width;
+		view.height = height;
+		view.rowPitch = size_t(width) * 4;
+		view.bgra = bgra;
+
+		std::vector<uint8_t> encoded;
+		CHECK(ImageEncoder::EncodeQoi(view, &encoded));
+
+		int decodedWidth = 0;
+		int decodedHeight = 0;
+		std::vector<uint8_t> decoded;
+		CHECK(DecodeQoi(encoded, &decodedWidth, &decodedHeight, &decoded));
+		CHECK(decodedWidth == width && decodedHeight == height);
+
+		for (size_t i = 0; i < source.size(); i += 4)
+		{
+			CHECK(decoded[i] == source[i + (bgra ? 2 : 0)]);
+			CHECK(decoded[i + 1] == source[i + 1]);
+			CHECK(decoded[i + 2] == source[i + (bgra ? 0 : 2)]);
+			CHECK(decoded[i + 3] == 255);
+		}
+	}
+}
+
+static void TestLongRun()
+{
+	// Longer than a run op can hold and spanning rows
+	std::vector<uint8_t> source(300 * 3 * 4, 0);
+	ImageView view;
+	view.pixels = source.data();
+	view.width = 300;
+	view.height = 3;
+	view.rowPitch = 300 * 4;
+
+	std::vector<uint8_t> encoded;
+	CHECK(ImageEncoder::EncodeQoi(view, &encoded));
+	CHECK(encoded.size() < 14 + 20 + 8);
+
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> decoded;
+	CHECK(DecodeQoi(encoded, &width, &height, &decoded));
+	CHECK(decoded.size() == source.size());
+}
+
+static void TestGray()
+{
+	GrayImage image;
+	image.width = 33;
+	image.height = 7;
+
+	for (int i = 0; i < image.width * image.height; i++)
+	{
+		image.pixels.push_back(uint8_t(i * 7));
+	}
+
+	std::vector<uint8_t> encoded;
+	CHECK(ImageEncoder::EncodeQoi(image, &encoded));
+
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> decoded;
+	CHECK(DecodeQoi(encoded, &width, &height, &decoded));
+	CHECK(width == 33 && height == 7);
+
+	for (size_t i = 0; i < image.pixels.size(); i++)
+	{
+		CHECK(decoded[i * 4] == image.pixels[i] && decoded[i * 4 + 1] == image.pixels[i] && decoded[i * 4 + 2] == image.pixels[i]);
+	}
+
+	CHECK(!ImageEncoder::EncodeQoi(GrayImage(), &encoded));
+	CHECK(!ImageEncoder::EncodeQoi(ImageView(), &encoded));
+}
+
+static void TestNames()
+{
+	CHECK(strcmp(ImageEncoder::GetFormatName(CaptureFormat::Qoi), "qoi") == 0);
+	CHECK(strcmp(ImageEncoder::GetFormatName(CaptureFormat::Bmp), "bmp") == 0);
+	CHECK(wcscmp(ImageEncoder::GetContentType(CaptureFormat::Jpeg), L"image/jpeg") == 0);
+}
+
+int main()
+{
+	TestRoundTrip(false);
+	TestRoundTrip(true);
+	TestLongRun();
+	TestGray();
+	TestNames();
+
+	return 0;
+}
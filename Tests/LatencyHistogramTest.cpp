@@ -0,0 +1,122 @@
+#include <cstdint>
+#include <random>
+
+#include "Check.h"
+#include "LatencyHistogram.h"
+
+// Percentiles are the upper bound of their bucket, never below the latency and at most ten percent above
+static void TestPercentiles()
+{
+	LatencyHistogram histogram(100000);
+
+	CHECK(histogram.GetPercentile(50.0f) == 0);
+
+	for (uint64_t latencyMs = 1; latencyMs <= 1000; latencyMs++)
+	{
+		histogram.Add(latencyMs);
+	}
+
+	CHECK(histogram.GetCount() == 1000);
+
+	for (float percentile : { 1.0f, 50.0f, 90.0f, 95.0f, 99.0f, 100.0f })
+	{
+		uint64_t exact = uint64_t(percentile * 10);
+		uint64_t estimate = histogram.GetPercentile(percentile);
+
+		CHECK(estimate >= exact && estimate <= exact * 11 / 10 + 1);
+	}
+
+	CHECK(histogram.GetPercentile(-5.0f) == histogram.GetPercentile(0.0f));
+	CHECK(histogram.GetPercentile(200.0f) == histogram.GetPercentile(100.0f));
+
+	for (uint64_t latencyMs : { 0, 1, 2, 10, 999, 123456 })
+	{
+		int bucket = LatencyHistogram::BucketOf(latencyMs);
+
+		CHECK(LatencyHistogram::UpperBound(bucket) >= latencyMs);
+		CHECK(LatencyHistogram::UpperBound(bucket) <= latencyMs * 11 / 10 + 1);
+	}
+
+	CHECK(LatencyHistogram::BucketOf(UINT64_MAX) == LatencyHistogram::BucketCount - 1);
+}
+
+// Old latencies are halved away, the percentiles follow a server that slowed down
+static void TestAging()
+{
+	LatencyHistogram histogram(100);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		histogram.Add(100);
+	}
+
+	CHECK(histogram.GetCount() < 200);
+
+	for (int i = 0; i < 200; i++)
+	{
+		histogram.Add(1000);
+	}
+
+	CHECK(histogram.GetPercentile(50.0f) >= 1000);
+}
+
+static void TestHedgeDelay()
+{
+	HedgeOptions options;
+	options.minSamples = 20;
+	options.minDelayMs = 50;
+	HedgePolicy policy(options);
+	std::mt19937 random(1);
+
+	for (int i = 0; i < 19; i++)
+	{
+		policy.Record(L"/", 400 + random() % 100);
+	}
+
+	CHECK(policy.GetDelayMs(L"/") == -1);
+
+	policy.Record(L"/", 450);
+	int delayMs = policy.GetDelayMs(L"/");
+	CHECK(delayMs >= 450 && delayMs <= 550);
+
+	// Every kind has latencies of its own
+	CHECK(policy.GetDelayMs(L"/translate") == -1);
+
+	for (int i = 0; i < 20; i++)
+	{
+		policy.Record(L"/translate", 5);
+	}
+
+	CHECK(policy.GetDelayMs(L"/translate") == 50);
+}
+
+// At most budget hedges per request, counted over every request asked for its delay
+static void TestHedgeBudget()
+{
+	HedgeOptions options;
+	options.budget = 0.1f;
+	HedgePolicy policy(options);
+	int hedges = 0;
+
+	for (int i = 0; i < 1000; i++)
+	{
+		policy.GetDelayMs(L"/");
+		hedges += policy.TryHedge();
+	}
+
+	CHECK(hedges == 100);
+
+	HedgePolicy none(HedgeOptions{ 95.0f, 20, 50, 0.0f });
+	none.GetDelayMs(L"/");
+	CHECK(!none.TryHedge());
+}
+
+int main()
+{
+	TestPercentiles();
+	TestAging();
+	TestHedgeDelay();
+	TestHedgeBudget();
+
+	return 0;
+}
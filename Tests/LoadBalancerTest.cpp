@@ -0,0 +1,178 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "LoadBalancer.h"
+
+using Outcome = LoadBalancer::Outcome;
+
+// Servers without measurements go first, then the one with the lower latency weighted by its outstanding requests
+static void TestPeakEwma()
+{
+	LoadBalancer balancer(2);
+
+	CHECK(balancer.Acquire(0) == 0);
+	CHECK(balancer.Acquire(0) == 1);
+	balancer.Release(0, 200, Outcome::Succeeded, 200);
+	balancer.Release(1, 400, Outcome::Succeeded, 400);
+
+	CHECK(balancer.Acquire(400) == 0);
+	// 200 ms with one outstanding weighs as much as 400 ms with none, the tie goes to the first server
+	CHECK(balancer.Acquire(400) == 0);
+	CHECK(balancer.Acquire(400) == 1);
+	CHECK(balancer.GetStats(0).outstanding == 2 && balancer.GetStats(1).outstanding == 1);
+
+	// Tried servers are skipped
+	CHECK(balancer.Acquire(400, { 0 }) == 1);
+	CHECK(balancer.Acquire(400, { 0, 1 }) == -1);
+}
+
+static void TestLeastOutstanding()
+{
+	LoadBalancerOptions options;
+	options.policy = LoadBalancing::LeastOutstanding;
+	LoadBalancer balancer(2, options);
+
+	balancer.Release(balancer.Acquire(0), 100, Outcome::Succeeded, 100);
+	balancer.Release(balancer.Acquire(100), 400, Outcome::Succeeded, 300);
+
+	CHECK(balancer.Acquire(400) == 0);
+	CHECK(balancer.Acquire(400) == 1);
+	CHECK(balancer.Acquire(400) == 0);
+}
+
+// Failures in a row eject a server, health checks bring it back with the time out doubled on every failed check
+static void TestEjection()
+{
+	LoadBalancer balancer(2);
+
+	balancer.Release(balancer.Acquire(0), 100, Outcome::Succeeded, 100);
+	balancer.Release(balancer.Acquire(100), 300, Outcome::Succeeded, 200);
+
+	balancer.Release(0, 300, Outcome::Failed, 0);
+	CHECK(balancer.GetStats(0).healthy);
+	// A cancelled request says nothing about the server and does not break the run of failures
+	balancer.Release(0, 300, Outcome::Cancelled, 0);
+	CHECK(balancer.GetStats(0).failures == 1);
+	balancer.Release(0, 300, Outcome::Failed, 0);
+
+	LoadBalancer::Stats stats = balancer.GetStats(0);
+	CHECK(!stats.healthy && stats.ejections == 1 && stats.failures == 2);
+	CHECK(balancer.Acquire(300) == 1);
+
+	CHECK(balancer.GetHealthChecksDue(300 + 4999).empty());
+	CHECK((balancer.GetHealthChecksDue(300 + 5000) == std::vector<int>{ 0 }));
+
+	balancer.ReportHealthCheck(0, 5300, false);
+	CHECK(balancer.GetHealthChecksDue(5300 + 9999).empty());
+	CHECK(balancer.GetHealthChecksDue(5300 + 10000).size() == 1);
+
+	balancer.ReportHealthCheck(0, 15300, true);
+	stats = balancer.GetStats(0);
+	CHECK(stats.healthy && stats.ewmaMs == 0.0f);
+
+	// Back without measurements, so it gets the next request
+	CHECK(balancer.Acquire(15300) == 0);
+}
+
+// A server several times slower than another one is ejected after a few answers, the last healthy one never is
+static void TestSlow()
+{
+	LoadBalancer balancer(2);
+
+	for (int i = 0; i < 3; i++)
+	{
+		balancer.Acquire(0);
+		balancer.Release(0, 0, Outcome::Succeeded, 100);
+		balancer.Acquire(0);
+		balancer.Release(1, 0, Outcome::Succeeded, 1000);
+	}
+
+	CHECK(balancer.GetStats(0).healthy && !balancer.GetStats(1).healthy);
+
+	LoadBalancer alone(1);
+
+	for (int i = 0; i < 10; i++)
+	{
+		alone.Release(alone.Acquire(0), 0, Outcome::Succeeded, 5000);
+	}
+
+	CHECK(alone.GetStats(0).healthy);
+}
+
+// While every server is out, the one coming back first is used anyway
+static void TestAllEjected()
+{
+	LoadBalancer balancer(2);
+
+	balancer.Release(balancer.Acquire(0), 0, Outcome::Failed, 0);
+	balancer.Release(balancer.Acquire(0), 0, Outcome::Failed, 0);
+	balancer.Release(balancer.Acquire(0), 0, Outcome::Failed, 0);
+	balancer.Release(balancer.Acquire(1000), 1000, Outcome::Failed, 0);
+
+	CHECK(!balancer.GetStats(0).healthy && !balancer.GetStats(1).healthy);
+	CHECK(balancer.Acquire(2000) == 0);
+}
+
+// Three servers, one of them slow and another one down for twenty seconds: requests go to the fast ones
+static void TestReplay()
+{
+	LoadBalancer balancer(3);
+	std::mt19937 random(1);
+	uint64_t nowMs = 0;
+	int requests[3] = {};
+	int outageRequests = 0;
+
+	auto isDown = [](int endpoint, uint64_t nowMs)
+	{
+		return endpoint == 0 && nowMs > 20000 && nowMs < 40000;
+	};
+
+	for (int i = 0; i < 400; i++)
+	{
+		std::vector<int> tried;
+
+		for (;;)
+		{
+			int endpoint = balancer.Acquire(nowMs, tried);
+			CHECK(endpoint >= 0);
+			tried.push_back(endpoint);
+			requests[endpoint]++;
+
+			if (isDown(endpoint, nowMs))
+			{
+				nowMs += 10;
+				balancer.Release(endpoint, nowMs, Outcome::Failed, 10);
+				outageRequests++;
+				continue;
+			}
+
+			uint64_t latencyMs = endpoint == 0 ? 200 + random() % 50 : endpoint == 1 ? 1500 + random() % 300 : 250 + random() % 50;
+			nowMs += latencyMs;
+			balancer.Release(endpoint, nowMs, Outcome::Succeeded, latencyMs);
+			break;
+		}
+
+		for (int endpoint : balancer.GetHealthChecksDue(nowMs))
+		{
+			balancer.ReportHealthCheck(endpoint, nowMs, !isDown(endpoint, nowMs));
+		}
+	}
+
+	CHECK(outageRequests == 2);
+	CHECK(requests[1] < 10);
+	CHECK(requests[0] > requests[2] && requests[2] > 100);
+	CHECK(balancer.GetStats(0).healthy && balancer.GetStats(0).ejections == 1);
+}
+
+int main()
+{
+	TestPeakEwma();
+	TestLeastOutstanding();
+	TestEjection();
+	TestSlow();
+	TestAllEjected();
+	TestReplay();
+
+	return 0;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct MockRequest
+{
+	std::string method;
+	std::string path;
+	// Header lines as received, without the request line
+	std::string headers;
+	std::string body;
+	// Number of the connection it arrived on, counted from 1
+	int connection = 0;
+};
+
+struct MockResponse
+{
+	int status = 200;
+	std::string body;
+	// Waited before the rest of the answer, cut short when the server stops
+	int delayMs = 0;
+	// Body bytes sent along with the headers before the delay, without them nothing is sent before it
+	size_t bytesBeforeDelay = 0;
+	// Closes the connection after answering without saying so, like a server whose keep-alive timed out
+	bool closeAfter = false;
+	// Closes the connection instead of answering
+	bool drop = false;
+};
+
+// HTTP/1.1 server on a loopback port for the transport tests. Every connection is served on a thread of its
+// own by handler, which may be called from several threads at once.
+class MockHttpServer
+{
+public:
+	using Handler = std::function<MockResponse(const MockRequest& request)>;
+
+	explicit MockHttpServer(Handler handler)
+		: handler(std::move(handler))
+	{
+		// Writing to a connection the other side closed is an error to handle, not a reason to exit
+		std::signal(SIGPIPE, SIG_IGN);
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = 0;
+
+		socklen_t length = sizeof(address);
+
+		if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 ||
+			listen(listener, 16) != 0 ||
+			getsockname(listener, (sockaddr*)&address, &length) != 0)
+		{
+			std::abort();
+		}
+
+		port = ntohs(address.sin_port);
+		acceptThread = std::thread([this]() { Accept(); });
+	}
+
+	~MockHttpServer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			stopping = true;
+
+			for (int connection : connections)
+			{
+				shutdown(connection, SHUT_RDWR);
+			}
+		}
+
+		stopped.notify_all();
+		shutdown(listener, SHUT_RDWR);
+		close(listener);
+		acceptThread.join();
+
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	uint16_t GetPort() const
+	{
+		return port;
+	}
+
+	int GetConnectionCount() const
+	{
+		return connectionCount;
+	}
+
+	int GetRequestCount() const
+	{
+		return requestCount;
+	}
+
+	// Connections that are open right now
+	int GetOpenConnectionCount()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return int(connections.size());
+	}
+
+private:
+	Handler handler;
+	int listener = -1;
+	uint16_t port = 0;
+	std::thread acceptThread;
+	std::atomic<int> connectionCount = 0;
+	std::atomic<int> requestCount = 0;
+
+	std::mutex mutex;
+	std::condition_variable stopped;
+	bool stopping = false;
+	std::vector<int> connections;
+	std::vector<std::thread> threads;
+
+	void Accept()
+	{
+		while (true)
+		{
+			int connection = accept(listener, nullptr, nullptr);
+
+			if (connection < 0)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (stopping)
+			{
+				close(connection);
+				return;
+			}
+
+			connections.push_back(connection);
+			threads.emplace_back([this, connection, number = ++connectionCount]() { Serve(connection, number); });
+		}
+	}
+
+	void Serve(int connection, int number)
+	{
+		std::string received;
+
+		while (true)
+		{
+			MockRequest request;
+			request.connection = number;
+
+			if (!ReadRequest(connection, &received, &request))
+			{
+				break;
+			}
+
+			requestCount++;
+
+			MockResponse response = handler(request);
+
+			if (response.drop || !Answer(connection, response) || response.closeAfter)
+			{
+				break;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (size_t i = 0; i < connections.size(); i++)
+		{
+			if (connections[i] == connection)
+			{
+				connections.erase(connections.begin() + i);
+				break;
+			}
+		}
+
+		close(connection);
+	}
+
+	// Takes one request off the connection, received keeps what arrived beyond it
+	static bool ReadRequest(int connection, std::string* received, MockRequest* request)
+	{
+		size_t headEnd;
+
+		while ((headEnd = received->find("\r\n\r\n")) == std::string::npos)
+		{
+			if (!Receive(connection, received))
+			{
+				return false;
+			}
+		}
+
+		size_t lineEnd = received->find("\r\n");
+		std::string line = received->substr(0, lineEnd);
+		size_t space = line.find(' ');
+
+		request->method = line.substr(0, space);
+		request->path = line.substr(space + 1, line.find(' ', space + 1) - space - 1);
+		request->headers = received->substr(lineEnd + 2, headEnd - lineEnd - 2);
+
+		size_t length = 0;
+		size_t lengthHeader = request->headers.find("Content-Length: ");
+
+		if (lengthHeader != std::string::npos)
+		{
+			length = size_t(std::atoll(request->headers.c_str() + lengthHeader + 16));
+		}
+
+		while (received->size() < headEnd + 4 + length)
+		{
+			if (!Receive(connection, received))
+			{
+				return false;
+			}
+		}
+
+		request->body = received->substr(headEnd + 4, length);
+		received->erase(0, headEnd + 4 + length);
+
+		return true;
+	}
+
+	static bool Receive(int connection, std::string* received)
+	{
+		char buffer[16 * 1024];
+		ssize_t size = recv(connection, buffer, sizeof(buffer), 0);
+
+		if (size <= 0)
+		{
+			return false;
+		}
+
+		received->append(buffer, size_t(size));
+		return true;
+	}
+
+	bool Answer(int connection, const MockResponse& response)
+	{
+		std::string message = "HTTP/1.1 " + std::to_string(response.status) + " Mock\r\n";
+		message += "Content-Length: " + std::to_string(response.body.size()) + "\r\n\r\n";
+
+		size_t split = response.bytesBeforeDelay > 0 ? message.size() + std::min(response.bytesBeforeDelay, response.body.size()) : 0;
+		message += response.body;
+
+		if (!SendAll(connection, message.data(), split))
+		{
+			return false;
+		}
+
+		if (response.delayMs > 0)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			stopped.wait_for(lock, std::chrono::milliseconds(response.delayMs), [this]() { return stopping; });
+		}
+
+		return SendAll(connection, message.data() + split, message.size() - split);
+	}
+
+	static bool SendAll(int connection, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			ssize_t sent = send(connection, data, size, 0);
+
+			if (sent <= 0)
+			{
+				return false;
+			}
+
+			data += sent;
+			size -= size_t(sent);
+		}
+
+		return true;
+	}
+};
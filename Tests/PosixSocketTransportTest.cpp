@@ -0,0 +1,196 @@
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "MockHttpServer.h"
+#include "PosixSocketTransport.h"
+
+// Echoes the method, path and body back
+static MockResponse Echo(const MockRequest& request)
+{
+	MockResponse response;
+	response.body = request.method + " " + request.path + " " + request.body;
+	return response;
+}
+
+// Sends one request and collects the body the sink received
+static bool Send(PosixSocketTransport& transport, const std::string& body, std::string* received, const wchar_t* path = L"/")
+{
+	received->clear();
+
+	return transport.Send(L"POST", path, L"Content-Type: text/plain", body.data(), body.size(),
+		[received](const char* data, size_t size)
+		{
+			received->append(data, size);
+			return true;
+		});
+}
+
+// Consecutive requests share one connection
+static void TestKeepAlive()
+{
+	MockHttpServer server(&Echo);
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	std::string received;
+
+	transport.BeginAttempt();
+
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK(Send(transport, "frame " + std::to_string(i), &received, L"/translate"));
+		CHECK(received == "POST /translate frame " + std::to_string(i));
+	}
+
+	CHECK(server.GetConnectionCount() == 1);
+	CHECK(server.GetRequestCount() == 5);
+	CHECK(transport.GetConnectCount() == 1);
+
+	// An error status is not handed to the sink, but its body is read and the connection kept
+	MockHttpServer missing([](const MockRequest&) { MockResponse response; response.status = 404; response.body = "missing"; return response; });
+	PosixSocketTransport other("127.0.0.1", missing.GetPort());
+
+	CHECK(!Send(other, "a", &received));
+	CHECK(received.empty());
+	CHECK(!Send(other, "b", &received));
+	CHECK(missing.GetConnectionCount() == 1);
+
+	// Bodies larger than the receive buffer arrive whole
+	std::string large(300 * 1024, 'x');
+	CHECK(Send(transport, large, &received));
+	CHECK(received.size() == large.size() + 7);
+}
+
+// A connection the server closed while it was idle is replaced, the request is sent once more on the new one
+static void TestStaleConnection()
+{
+	MockHttpServer server([](const MockRequest& request)
+	{
+		MockResponse response = Echo(request);
+		response.closeAfter = true;
+		return response;
+	});
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	std::string received;
+
+	transport.BeginAttempt();
+
+	CHECK(Send(transport, "first", &received));
+
+	// Let the close arrive, the client only finds out when it uses the connection
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	CHECK(Send(transport, "second", &received));
+	CHECK(received == "POST / second");
+	CHECK(server.GetConnectionCount() == 2);
+	CHECK(server.GetRequestCount() == 2);
+}
+
+// A server that keeps dropping requests gets exactly one retry
+static void TestSingleRetry()
+{
+	MockHttpServer server([](const MockRequest&) { MockResponse response; response.drop = true; return response; });
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	std::string received;
+
+	transport.BeginAttempt();
+
+	CHECK(!Send(transport, "lost", &received));
+	CHECK(server.GetRequestCount() == 2);
+	CHECK(transport.GetConnectCount() == 2);
+
+	// Nothing listens any more, connecting fails without a retry loop
+	uint16_t port = 0;
+	{
+		MockHttpServer gone(&Echo);
+		port = gone.GetPort();
+	}
+	PosixSocketTransport unreachable("127.0.0.1", port);
+	CHECK(!Send(unreachable, "nobody", &received));
+	CHECK(unreachable.GetConnectCount() == 0);
+}
+
+// A response that already started is not sent again when the connection breaks in the middle of it
+static void TestNoRetryAfterResponse()
+{
+	MockHttpServer server([](const MockRequest&)
+	{
+		MockResponse response;
+		response.body = std::string(1000, 'y');
+		response.bytesBeforeDelay = 10;
+		response.delayMs = 10000;
+		return response;
+	});
+	PosixSocketTransport transport("127.0.0.1", server.GetPort(), 200);
+	std::string received;
+
+	transport.BeginAttempt();
+
+	CHECK(!Send(transport, "slow", &received));
+	CHECK(received.size() == 10);
+	CHECK(server.GetRequestCount() == 1);
+}
+
+// Cancel from another thread ends a request that waits for the server, and sticks until the next attempt
+static void TestCancel()
+{
+	MockHttpServer server([](const MockRequest& request)
+	{
+		MockResponse response = Echo(request);
+		response.delayMs = request.body == "slow" ? 10000 : 0;
+		return response;
+	});
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	std::string received;
+
+	transport.BeginAttempt();
+
+	std::thread canceller([&transport]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		transport.Cancel();
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	CHECK(!Send(transport, "slow", &received));
+	canceller.join();
+
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+	// Cancelled requests are not retried
+	CHECK(server.GetRequestCount() == 1);
+
+	// Still cancelled, nothing is sent
+	CHECK(!Send(transport, "fast", &received));
+	CHECK(server.GetRequestCount() == 1);
+
+	transport.BeginAttempt();
+	CHECK(Send(transport, "fast", &received));
+	CHECK(received == "POST / fast");
+}
+
+// A sink that stops the transfer leaves no half read response on the connection
+static void TestSinkAbort()
+{
+	MockHttpServer server(&Echo);
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	std::string received;
+
+	transport.BeginAttempt();
+
+	CHECK(!transport.Send(L"POST", L"/", L"", "abc", 3, [](const char*, size_t) { return false; }));
+	CHECK(Send(transport, "next", &received));
+	CHECK(received == "POST / next");
+	CHECK(transport.GetConnectCount() == 2);
+}
+
+int main()
+{
+	TestKeepAlive();
+	TestStaleConnection();
+	TestSingleRetry();
+	TestNoRetryAfterResponse();
+	TestCancel();
+	TestSinkAbort();
+
+	return 0;
+}
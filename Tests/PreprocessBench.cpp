@@ -0,0 +1,94 @@
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Bench.h"
+#include "ImageEncoder.h"
+#include "Preprocess.h"
+
+static std::vector<uint8_t> MakeFrame(int width, int height)
+{
+	std::vector<uint8_t> pixels(size_t(width) * height * 4);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			uint8_t* pixel = &pixels[(size_t(y) * width + x) * 4];
+			bool glyph = (y / 32) % 4 == 1 && (x / 3) % 5 < 2 && y % 32 > 8 && y % 32 < 28;
+
+			pixel[0] = uint8_t(glyph ? 250 : (x * 7) & 0xff);
+			pixel[1] = uint8_t(glyph ? 250 : (y * 3) & 0xff);
+			pixel[2] = uint8_t(glyph ? 250 : (x ^ y) & 0xff);
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+static void Run(const char* name, int width, int height)
+{
+	std::vector<uint8_t> pixels = MakeFrame(width, height);
+
+	ImageView view;
+	view.pixels = pixels.data();
+	view.width = width;
+	view.height = height;
+	view.rowPitch = size_t(width) * 4;
+	view.bgra = true;
+
+	double megabytes = double(pixels.size()) / (1024.0 * 1024.0);
+	const char* isaNames[] = { "scalar", "SSE2", "AVX2" };
+
+	for (Preprocess::Isa isa : { Preprocess::Isa::Scalar, Preprocess::Isa::Sse2, Preprocess::Isa::Avx2 })
+	{
+		// Only what this machine runs
+		if (int(isa) > int(Preprocess::GetIsa()))
+		{
+			break;
+		}
+
+		double us = MeasureUs([&]() { Consume(Preprocess::ToLuma(view, isa).pixels[0]); });
+
+		std::printf("%-6s luma %-6s %8.2f ms %7.0f MB/s\n", name, isaNames[int(isa)], us / 1000.0, megabytes / (us / 1e6));
+	}
+
+	GrayImage gray = Preprocess::ToLuma(view);
+
+	double downscaleUs = MeasureUs([&]() { Consume(Preprocess::Downscale(gray, 2).pixels[0]); });
+	double contrastUs = MeasureUs([&]()
+	{
+		GrayImage copy = gray;
+		Preprocess::NormalizeContrast(&copy);
+		Consume(copy.pixels[0]);
+	});
+
+	std::printf("%-6s downscale x2 %8.2f ms  contrast %8.2f ms\n", name, downscaleUs / 1000.0, contrastUs / 1000.0);
+
+	// What the upload costs with and without the grayscale step
+	std::vector<uint8_t> encoded;
+	double colorUs = MeasureUs([&]()
+	{
+		encoded.clear();
+		ImageEncoder::EncodeQoi(view, &encoded);
+	});
+	size_t colorBytes = encoded.size();
+
+	double grayUs = MeasureUs([&]()
+	{
+		encoded.clear();
+		ImageEncoder::EncodeQoi(Preprocess::Run(view, { 2, false }), &encoded);
+	});
+
+	std::printf("%-6s QOI color %8.2f ms %8zu bytes  gray x2 %8.2f ms %8zu bytes\n",
+		name, colorUs / 1000.0, colorBytes, grayUs / 1000.0, encoded.size());
+}
+
+int main()
+{
+	Run("1080p", 1920, 1080);
+	Run("4K", 3840, 2160);
+
+	return 0;
+}
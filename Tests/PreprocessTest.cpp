@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "FrameDiff.h"
+#include "Preprocess.h"
+
+static std::vector<uint8_t> CreatePixels(int width, int height, size_t rowPitch, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::vector<uint8_t> pixels(rowPitch * height);
+
+	for (uint8_t& value : pixels)
+	{
+		value = uint8_t(random());
+	}
+
+	// Extremes, where a lane could overflow
+	for (int x = 0; x < width && x < 4; x++)
+	{
+		for (int channel = 0; channel < 4; channel++)
+		{
+			pixels[size_t(x) * 4 + channel] = x % 2 == 0 ? 255 : 0;
+		}
+	}
+
+	return pixels;
+}
+
+// Every SIMD path the CPU has gives the same bytes as the scalar one, for widths around the vector sizes
+static void TestLumaPaths()
+{
+	for (int width = 1; width <= 67; width++)
+	{
+		for (bool bgra : { false, true })
+		{
+			int height = 3;
+			size_t rowPitch = size_t(width) * 4 + 12;
+			std::vector<uint8_t> pixels = CreatePixels(width, height, rowPitch, unsigned(width));
+
+			ImageView view;
+			view.pixels = pixels.data();
+			view.width = width;
+			view.height = height;
+			view.rowPitch = rowPitch;
+			view.bgra = bgra;
+
+			GrayImage scalar = Preprocess::ToLuma(view, Preprocess::Isa::Scalar);
+			CHECK(scalar.width == width && scalar.height == height);
+
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					CHECK(scalar.Row(y)[x] == FrameDiff::Luma(view.Row(y) + size_t(x) * 4, bgra));
+				}
+			}
+
+#ifdef PREPROCESS_X86
+			CHECK(Preprocess::ToLuma(view, Preprocess::Isa::Sse2).pixels == scalar.pixels);
+
+			if (Preprocess::GetIsa() == Preprocess::Isa::Avx2)
+			{
+				CHECK(Preprocess::ToLuma(view, Preprocess::Isa::Avx2).pixels == scalar.pixels);
+			}
+#endif
+		}
+	}
+}
+
+static void TestDownscale()
+{
+	GrayImage image;
+	image.width = 5;
+	image.height = 4;
+	image.pixels = {
+		0, 10, 20, 30, 99,
+		2, 12, 22, 32, 99,
+		100, 100, 0, 255, 99,
+		100, 101, 255, 255, 99,
+	};
+
+	GrayImage scaled = Preprocess::Downscale(image, 2);
+	CHECK(scaled.width == 2 && scaled.height == 2);
+	// Rounded means, the partial column at the right is dropped
+	CHECK(scaled.pixels[0] == 6);
+	CHECK(scaled.pixels[1] == 26);
+	CHECK(scaled.pixels[2] == 100);
+	CHECK(scaled.pixels[3] == 191);
+
+	CHECK(Preprocess::Downscale(image, 1).pixels == image.pixels);
+	CHECK(Preprocess::Downscale(image, 8).width == 5);
+}
+
+static void TestNormalizeContrast()
+{
+	GrayImage image;
+	image.width = 100;
+	image.height = 1;
+
+	for (int x = 0; x < 100; x++)
+	{
+		image.pixels.push_back(uint8_t(100 + x / 2));
+	}
+
+	Preprocess::NormalizeContrast(&image);
+	CHECK(image.pixels.front() == 0);
+	CHECK(image.pixels.back() == 255);
+
+	for (int x = 1; x < 100; x++)
+	{
+		CHECK(image.pixels[x] >= image.pixels[x - 1]);
+	}
+
+	// A nearly flat image stays as it is
+	GrayImage flat;
+	flat.width = 10;
+	flat.height = 1;
+	flat.pixels = { 50, 51, 52, 53, 54, 55, 56, 57, 58, 59 };
+
+	std::vector<uint8_t> before = flat.pixels;
+	Preprocess::NormalizeContrast(&flat);
+	CHECK(flat.pixels == before);
+}
+
+static void TestChooseDownscale()
+{
+	CHECK(Preprocess::ChooseDownscale(40, 16) == 2);
+	CHECK(Preprocess::ChooseDownscale(48, 16) == 3);
+	CHECK(Preprocess::ChooseDownscale(10, 16) == 1);
+	CHECK(Preprocess::ChooseDownscale(0, 16) == 1);
+}
+
+int main()
+{
+	TestLumaPaths();
+	TestDownscale();
+	TestNormalizeContrast();
+	TestChooseDownscale();
+
+	return 0;
+}
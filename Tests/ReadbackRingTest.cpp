@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Check.h"
+#include "ReadbackRing.h"
+
+// Copies finish when the test says so, reads are recorded by the frame they were queued on
+class TestDevice : public IReadbackDevice
+{
+public:
+	std::vector<bool> finished;
+	std::vector<uint64_t> read;
+	bool failCopies = false;
+
+	explicit TestDevice(int size) : finished(size, false)
+	{
+	}
+
+	bool QueueCopy(int slot) override
+	{
+		finished[slot] = false;
+		return !failCopies;
+	}
+
+	bool IsCopyFinished(int slot) override
+	{
+		return finished[slot];
+	}
+
+	bool ReadSlot(int slot, uint64_t frame) override
+	{
+		// The ring only reads slots whose copy finished
+		CHECK(finished[slot]);
+		read.push_back(frame);
+		return true;
+	}
+
+	void FinishAll()
+	{
+		finished.assign(finished.size(), true);
+	}
+};
+
+static void TestLatency()
+{
+	TestDevice device(3);
+	ReadbackRing ring(&device, 3, 2, ReadbackDropPolicy::DropNewest);
+
+	CHECK(ring.Request(10));
+	device.FinishAll();
+
+	// Not read before the latency passed, even when the GPU is done
+	CHECK(ring.Poll(11) == 0);
+	CHECK(ring.Poll(12) == 1);
+	CHECK(device.read.size() == 1 && device.read[0] == 10);
+	CHECK(ring.GetPendingCount() == 0);
+}
+
+static void TestOldestFirst()
+{
+	TestDevice device(3);
+	ReadbackRing ring(&device, 3, 0, ReadbackDropPolicy::DropNewest);
+
+	CHECK(ring.Request(1));
+	CHECK(ring.Request(2));
+	CHECK(ring.Request(3));
+
+	// A later copy that finished first waits for the older one
+	device.finished[1] = true;
+	CHECK(ring.Poll(3) == 0);
+
+	device.FinishAll();
+	CHECK(ring.Poll(3) == 3);
+	CHECK((device.read == std::vector<uint64_t>{ 1, 2, 3 }));
+}
+
+static void TestDropNewest()
+{
+	TestDevice device(2);
+	ReadbackRing ring(&device, 2, 1, ReadbackDropPolicy::DropNewest);
+
+	CHECK(ring.Request(1));
+	CHECK(ring.Request(2));
+	CHECK(!ring.Request(3));
+	CHECK(ring.GetDroppedCount() == 1);
+
+	device.FinishAll();
+	ring.Poll(4);
+	CHECK((device.read == std::vector<uint64_t>{ 1, 2 }));
+}
+
+static void TestDropOldest()
+{
+	TestDevice device(2);
+	ReadbackRing ring(&device, 2, 1, ReadbackDropPolicy::DropOldest);
+
+	CHECK(ring.Request(1));
+	CHECK(ring.Request(2));
+	CHECK(ring.Request(3));
+	CHECK(ring.GetDroppedCount() == 1);
+	CHECK(ring.GetPendingCount() == 2);
+
+	device.FinishAll();
+	ring.Poll(4);
+	CHECK((device.read == std::vector<uint64_t>{ 2, 3 }));
+}
+
+static void TestResetAndFailedCopy()
+{
+	TestDevice device(2);
+	ReadbackRing ring(&device, 2, 0, ReadbackDropPolicy::DropNewest);
+
+	CHECK(ring.Request(1));
+	ring.Reset();
+	CHECK(ring.GetPendingCount() == 0);
+
+	device.failCopies = true;
+	CHECK(!ring.Request(2));
+	CHECK(ring.GetPendingCount() == 0);
+
+	device.failCopies = false;
+	CHECK(ring.Request(3));
+	CHECK(ring.Request(4));
+
+	device.FinishAll();
+	ring.Poll(4);
+	CHECK((device.read == std::vector<uint64_t>{ 3, 4 }));
+}
+
+// Subtitle captures every frame never evict a pending scan, they only evict each other
+static void TestDroppable()
+{
+	TestDevice device(3);
+	ReadbackRing ring(&device, 3, 2, ReadbackDropPolicy::DropOldest);
+	const uint64_t scanFrame = 10;
+
+	for (uint64_t frame = 0; frame < 40; frame++)
+	{
+		if (frame == scanFrame)
+		{
+			CHECK(ring.Request(frame));
+		}
+		else
+		{
+			ring.Request(frame, true);
+		}
+
+		device.FinishAll();
+		ring.Poll(frame);
+	}
+
+	CHECK(std::count(device.read.begin(), device.read.end(), scanFrame) == 1);
+
+	// With every slot taken by a scan, a droppable request is refused and a scan evicts the oldest one
+	TestDevice full(2);
+	ReadbackRing scans(&full, 2, 5, ReadbackDropPolicy::DropOldest);
+
+	CHECK(scans.Request(0));
+	CHECK(scans.Request(1));
+	CHECK(!scans.Request(2, true));
+	CHECK(scans.Request(3));
+
+	full.FinishAll();
+	CHECK(scans.Poll(100) == 2);
+	CHECK((full.read == std::vector<uint64_t>{ 1, 3 }));
+}
+
+int main()
+{
+	TestLatency();
+	TestOldestFirst();
+	TestDropNewest();
+	TestDropOldest();
+	TestResetAndFailedCopy();
+	TestDroppable();
+
+	return 0;
+}
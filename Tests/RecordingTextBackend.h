@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "TextQueue.h"
+
+// Software stand-in for the sprite batch of the overlay, records what a flush submits
+class RecordingTextBackend : public ITextBackend
+{
+public:
+	struct Draw
+	{
+		TextCommand command;
+		std::string text;
+	};
+
+	int begins = 0;
+	int ends = 0;
+	// Draws outside Begin/End, a batch the overlay would lose
+	int unbatchedDraws = 0;
+	std::vector<Draw> draws;
+	// Glyph quads a sprite font emits for the draws, one per character that is not whitespace
+	size_t quads = 0;
+
+	void Begin() override
+	{
+		begins++;
+		open = true;
+	}
+
+	void DrawString(const TextCommand& command, const char* text) override
+	{
+		if (!open)
+		{
+			unbatchedDraws++;
+		}
+
+		draws.push_back({ command, text });
+
+		for (const char* character = text; *character != '\0'; character++)
+		{
+			if (*character != ' ' && *character != '\t' && *character != '\n' && *character != '\r')
+			{
+				quads++;
+			}
+		}
+	}
+
+	void End() override
+	{
+		ends++;
+		open = false;
+	}
+
+private:
+	bool open = false;
+};
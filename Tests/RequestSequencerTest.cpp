@@ -0,0 +1,294 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "MockHttpServer.h"
+#include "PosixSocketTransport.h"
+#include "RequestSequencer.h"
+
+struct TestRequest
+{
+	uint64_t sequence = 0;
+	CaptureKind kind = CaptureKind::Manual;
+	std::string body;
+};
+
+// Counts the calls of the sender side, nothing is sent
+class CountingTransport : public ITransport
+{
+public:
+	int attempts = 0;
+	int cancels = 0;
+
+	bool Send(const wchar_t*, const wchar_t*, const std::wstring&, const void*, size_t, const ResponseSink&) override
+	{
+		return true;
+	}
+
+	void Close() override
+	{
+	}
+
+	void BeginAttempt() override
+	{
+		attempts++;
+	}
+
+	void Cancel() override
+	{
+		cancels++;
+	}
+};
+
+// Answers "slow" after delayMs and everything else at once
+static MockHttpServer::Handler Delaying(int delayMs)
+{
+	return [delayMs](const MockRequest& request)
+	{
+		MockResponse response;
+		response.body = request.body;
+		response.delayMs = request.body.compare(0, 4, "slow") == 0 ? delayMs : 0;
+		return response;
+	};
+}
+
+static std::unique_ptr<TestRequest> MakeRequest(RequestSequencer& sequencer, CaptureKind kind, const std::string& body)
+{
+	auto request = std::make_unique<TestRequest>();
+	request->sequence = sequencer.Next(kind);
+	request->kind = kind;
+	request->body = body;
+	return request;
+}
+
+static bool WaitFor(const std::function<bool()>& condition)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+	while (!condition())
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			return false;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
+
+// The sender thread of TranslateWorker: takes count requests one after another and shows what arrives
+class Sender
+{
+public:
+	std::vector<std::string> shown;
+	std::vector<uint64_t> failed;
+
+	Sender(LatestRequestQueue<TestRequest>& queue, PosixSocketTransport& transport, RequestSequencer& sequencer, int count)
+		: thread([this, &queue, &transport, &sequencer, count]()
+		{
+			for (int i = 0; i < count; i++)
+			{
+				std::unique_ptr<TestRequest> request = queue.Take();
+				std::string received;
+
+				bool succeeded = transport.Send(L"POST", L"/translate", L"", request->body.data(), request->body.size(),
+					[&received](const char* data, size_t size)
+					{
+						received.append(data, size);
+						return true;
+					});
+
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (succeeded && sequencer.Show(request->sequence, request->kind))
+				{
+					shown.push_back(received);
+				}
+				else if (!succeeded)
+				{
+					failed.push_back(request->sequence);
+				}
+
+				queue.Finish();
+			}
+		})
+	{
+	}
+
+	void Join()
+	{
+		thread.join();
+	}
+
+private:
+	std::mutex mutex;
+	std::thread thread;
+};
+
+// A newer request of the same kind cancels the one waiting for a slow server instead of queueing behind it
+static void TestCancelOnSupersede()
+{
+	MockHttpServer server(Delaying(10000));
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	RequestSequencer sequencer;
+	LatestRequestQueue<TestRequest> queue(&transport, true);
+	Sender sender(queue, transport, sequencer, 2);
+
+	auto start = std::chrono::steady_clock::now();
+
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "slow")) == 0);
+	CHECK(WaitFor([&server]() { return server.GetRequestCount() == 1; }));
+	CHECK(queue.GetPendingCount() == 1);
+
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "fast")) == 1);
+	sender.Join();
+
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+	CHECK(sender.failed == std::vector<uint64_t>{ 1 });
+	CHECK(sender.shown == std::vector<std::string>{ "fast" });
+	CHECK(sequencer.GetShown(CaptureKind::Automatic) == 2);
+	CHECK(queue.GetPendingCount() == 0);
+}
+
+// A request of another kind neither cancels nor drops the one in flight
+static void TestKindsKeptApart()
+{
+	MockHttpServer server(Delaying(200));
+	PosixSocketTransport transport("127.0.0.1", server.GetPort());
+	RequestSequencer sequencer;
+	LatestRequestQueue<TestRequest> queue(&transport, true);
+	Sender sender(queue, transport, sequencer, 2);
+
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Manual, "slow scan")) == 0);
+	CHECK(WaitFor([&server]() { return server.GetRequestCount() == 1; }));
+
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Subtitle, "subtitle")) == 0);
+	sender.Join();
+
+	CHECK(sender.failed.empty());
+	CHECK((sender.shown == std::vector<std::string>{ "slow scan", "subtitle" }));
+	CHECK(sequencer.GetShown(CaptureKind::Manual) == 1);
+	CHECK(sequencer.GetShown(CaptureKind::Subtitle) == 2);
+}
+
+// Waiting requests are dropped by newer ones of their kind, in flight ones only cancelled when asked to
+static void TestWaitingDropped()
+{
+	CountingTransport transport;
+	RequestSequencer sequencer;
+	LatestRequestQueue<TestRequest> queue(&transport, false);
+
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "1")) == 0);
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "2")) == 1);
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Manual, "3")) == 0);
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "4")) == 1);
+	CHECK(queue.GetPendingCount() == 2);
+
+	std::unique_ptr<TestRequest> request = queue.Take();
+	CHECK(request->body == "3");
+	CHECK(transport.attempts == 1);
+	CHECK(!queue.Finish());
+
+	request = queue.Take();
+	CHECK(request->body == "4");
+	CHECK(queue.GetPendingCount() == 1);
+
+	// Without cancelInFlight the request being sent is left alone
+	CHECK(queue.Post(MakeRequest(sequencer, CaptureKind::Automatic, "5")) == 0);
+	CHECK(transport.cancels == 0);
+	CHECK(!queue.Finish());
+
+	// Neither is a request that is newer than the one posted
+	LatestRequestQueue<TestRequest> cancelling(&transport, true);
+	auto older = MakeRequest(sequencer, CaptureKind::Automatic, "6");
+	CHECK(cancelling.Post(MakeRequest(sequencer, CaptureKind::Automatic, "7")) == 0);
+	CHECK(cancelling.Take()->body == "7");
+	CHECK(cancelling.Post(std::move(older)) == 0);
+	CHECK(transport.cancels == 0);
+	CHECK(!cancelling.Finish());
+}
+
+// Responses that arrive out of order over two connections: the later request is shown, the earlier discarded
+static void TestOutOfOrderResponses()
+{
+	MockHttpServer server(Delaying(300));
+	PosixSocketTransport first("127.0.0.1", server.GetPort());
+	PosixSocketTransport second("127.0.0.1", server.GetPort());
+	RequestSequencer sequencer;
+
+	std::mutex mutex;
+	std::vector<uint64_t> arrived;
+	std::vector<uint64_t> shown;
+
+	auto send = [&](PosixSocketTransport& transport, std::unique_ptr<TestRequest> request)
+	{
+		return std::thread([&, target = &transport, request = std::move(request)]()
+		{
+			target->BeginAttempt();
+			bool succeeded = target->Send(L"POST", L"/translate", L"", request->body.data(), request->body.size(),
+				[](const char*, size_t) { return true; });
+
+			std::lock_guard<std::mutex> lock(mutex);
+			CHECK(succeeded);
+			arrived.push_back(request->sequence);
+
+			if (sequencer.Show(request->sequence, request->kind))
+			{
+				shown.push_back(request->sequence);
+			}
+		});
+	};
+
+	auto slow = MakeRequest(sequencer, CaptureKind::Automatic, "slow");
+	auto fast = MakeRequest(sequencer, CaptureKind::Automatic, "fast");
+	CHECK(sequencer.IsSuperseded(slow->sequence, CaptureKind::Automatic));
+	CHECK(!sequencer.IsSuperseded(fast->sequence, CaptureKind::Automatic));
+
+	std::thread slowThread = send(first, std::move(slow));
+	std::thread fastThread = send(second, std::move(fast));
+	slowThread.join();
+	fastThread.join();
+
+	CHECK((arrived == std::vector<uint64_t>{ 2, 1 }));
+	CHECK(shown == std::vector<uint64_t>{ 2 });
+	CHECK(sequencer.GetShown(CaptureKind::Automatic) == 2);
+	// A partial preview of the discarded response is not shown either
+	CHECK(!sequencer.IsNewerThanShown(1, CaptureKind::Automatic));
+}
+
+// Clearing the shown entries makes the responses to every request created so far stale
+static void TestClear()
+{
+	RequestSequencer sequencer;
+
+	uint64_t manual = sequencer.Next(CaptureKind::Manual);
+	uint64_t subtitle = sequencer.Next(CaptureKind::Subtitle);
+	sequencer.Clear();
+
+	CHECK(!sequencer.Show(manual, CaptureKind::Manual));
+	CHECK(!sequencer.Show(subtitle, CaptureKind::Subtitle));
+
+	uint64_t next = sequencer.Next(CaptureKind::Manual);
+	CHECK(sequencer.IsNewerThanShown(next, CaptureKind::Manual));
+	CHECK(sequencer.Show(next, CaptureKind::Manual));
+	CHECK(!sequencer.Show(next, CaptureKind::Manual));
+}
+
+int main()
+{
+	TestCancelOnSupersede();
+	TestKindsKeptApart();
+	TestWaitingDropped();
+	TestOutOfOrderResponses();
+	TestClear();
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Bench.h"
+#include "ResponseParser.h"
+
+using TranslateClient::TranslationEntry;
+
+// A response like the server sends for a screen with count boxes, escaped the way json.dumps escapes
+static std::string MakeResponse(int count)
+{
+	std::string body = "[";
+
+	for (int i = 0; i < count; i++)
+	{
+		if (i != 0)
+		{
+			body += ", ";
+		}
+
+		body += "{\"x\": " + std::to_string(i % 1900) + ", \"y\": " + std::to_string(i / 19 * 24)
+			+ ", \"w\": 312.5, \"h\": 24.0, \"message\": \"\\u3053\\u3093\\u306b\\u3061\\u306f\", "
+			+ "\"translation\": \"Hello there, item " + std::to_string(i) + "\"}";
+	}
+
+	return body + "]";
+}
+
+// What ParseResponse did before: the whole body into a DOM, then every field copied out of it
+static std::vector<TranslationEntry> ParseDom(const std::string& body)
+{
+	std::vector<TranslationEntry> entries;
+	nlohmann::json parsed = nlohmann::json::parse(body);
+
+	for (nlohmann::json& element : parsed)
+	{
+		TranslationEntry entry;
+		element.at("message").get_to(entry.message);
+		element.at("x").get_to(entry.x);
+		element.at("y").get_to(entry.y);
+		element.at("w").get_to(entry.w);
+		element.at("h").get_to(entry.h);
+		element.at("translation").get_to(entry.translation);
+		entries.push_back(std::move(entry));
+	}
+
+	return entries;
+}
+
+// Fed in chunks of the size WinHTTP typically hands out
+static std::vector<TranslationEntry> ParseStreaming(const std::string& body, size_t chunkSize)
+{
+	std::vector<TranslationEntry> entries;
+	ResponseParser parser;
+
+	for (size_t position = 0; position < body.size(); position += chunkSize)
+	{
+		parser.Feed(body.data() + position, std::min(chunkSize, body.size() - position), &entries);
+	}
+
+	parser.Finish(&entries);
+
+	return entries;
+}
+
+int main()
+{
+	std::printf("%8s %10s %12s %12s %8s\n", "entries", "bytes", "DOM us", "stream us", "speedup");
+
+	for (int count : { 10, 100, 1000, 10000 })
+	{
+		std::string body = MakeResponse(count);
+
+		if (ParseDom(body).size() != size_t(count) || ParseStreaming(body, 8192).size() != size_t(count))
+		{
+			std::printf("The parsers disagree on %d entries\n", count);
+			return 1;
+		}
+
+		double domUs = MeasureUs([&]() { Consume(ParseDom(body).size()); });
+		double streamUs = MeasureUs([&]() { Consume(ParseStreaming(body, 8192).size()); });
+
+		std::printf("%8d %10zu %12.1f %12.1f %7.1fx\n", count, body.size(), domUs, streamUs, domUs / streamUs);
+	}
+
+	return 0;
+}
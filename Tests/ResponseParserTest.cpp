@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ResponseParser.h"
+
+using TranslateClient::TranslationEntry;
+
+static const std::string Entry = "{\"x\": 12, \"y\": -3, \"w\": 40.5, \"h\": 1e1, \"message\": \"hola\", \"translation\": \"hello\"}";
+
+// Parses the body fed in chunks of chunkSize bytes, false when the parser rejected it
+static bool Parse(const std::string& body, std::vector<TranslationEntry>* entries, size_t chunkSize = 0)
+{
+	ResponseParser parser;
+	size_t step = chunkSize == 0 ? body.size() : chunkSize;
+
+	for (size_t position = 0; position < body.size(); position += step)
+	{
+		if (!parser.Feed(body.data() + position, std::min(step, body.size() - position), entries))
+		{
+			return false;
+		}
+	}
+
+	return parser.Finish(entries);
+}
+
+static bool Parse(const std::string& body)
+{
+	std::vector<TranslationEntry> entries;
+	return Parse(body, &entries);
+}
+
+static void TestEntry()
+{
+	std::vector<TranslationEntry> entries;
+
+	CHECK(Parse("[" + Entry + "]", &entries));
+	CHECK(entries.size() == 1);
+	CHECK(entries[0].x == 12 && entries[0].y == -3);
+	CHECK(entries[0].w == 40.5f && entries[0].h == 10.0f);
+	CHECK(entries[0].message == "hola" && entries[0].translation == "hello");
+}
+
+// Every split of the body into chunks gives the same entries
+static void TestChunks()
+{
+	std::string body = " [" + Entry + ",\n" + Entry + "] ";
+
+	for (size_t chunkSize = 1; chunkSize <= body.size(); chunkSize++)
+	{
+		std::vector<TranslationEntry> entries;
+
+		CHECK(Parse(body, &entries, chunkSize));
+		CHECK(entries.size() == 2);
+		CHECK(entries[1].w == 40.5f && entries[1].translation == "hello");
+	}
+}
+
+// An entry is emitted with its closing brace, before the rest of the response arrived
+static void TestIncremental()
+{
+	std::string body = "[" + Entry + "," + Entry + "]";
+	ResponseParser parser;
+	std::vector<TranslationEntry> entries;
+
+	CHECK(parser.Feed(body.data(), Entry.size() + 1, &entries));
+	CHECK(entries.size() == 1);
+	CHECK(!parser.IsComplete());
+
+	CHECK(parser.Feed(body.data() + Entry.size() + 1, body.size() - Entry.size() - 1, &entries));
+	CHECK(parser.IsComplete());
+	CHECK(entries.size() == 2);
+}
+
+static void TestEscapes()
+{
+	std::vector<TranslationEntry> entries;
+	std::string body = "[{\"x\":0,\"y\":0,\"w\":0,\"h\":0,"
+		"\"message\":\"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\",\"translation\":\"\\/\"}]";
+
+	CHECK(Parse(body, &entries));
+	CHECK(entries.size() == 1);
+	CHECK(entries[0].message == "a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80");
+	CHECK(entries[0].translation == "/");
+}
+
+static void TestUnknownKeys()
+{
+	std::vector<TranslationEntry> entries;
+	std::string body = "[{\"confidence\": 0.9, \"box\": [[1, 2], {\"a\": \"}\"}], \"flag\": true, \"none\": null,"
+		"\"x\":1,\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\",\"translation\":\"t\"}]";
+
+	CHECK(Parse(body, &entries));
+	CHECK(entries.size() == 1 && entries[0].x == 1 && entries[0].message == "m");
+}
+
+static void TestMalformed()
+{
+	CHECK(Parse("[]"));
+	// An empty body counts as an empty array
+	CHECK(Parse(""));
+
+	CHECK(!Parse("["));
+	CHECK(!Parse("[" + Entry));
+	CHECK(!Parse("{}"));
+	CHECK(!Parse("[{\"x\":1,\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\"}]"));
+	CHECK(!Parse("[{\"x\":\"1\",\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\",\"translation\":\"t\"}]"));
+	CHECK(!Parse("[" + Entry + "] x"));
+	CHECK(!Parse("[{\"x\":1,\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\",\"translation\":\"t\\q\"}]"));
+
+}
+
+// Commas separate values and members, they may neither be missing nor doubled
+static void TestCommas()
+{
+	const std::string members = "\"x\":1,\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\",\"translation\":\"t\"";
+
+	CHECK(Parse("[" + Entry + "," + Entry + "]"));
+	CHECK(!Parse("[" + Entry + " " + Entry + "]"));
+	CHECK(!Parse("[," + Entry + "]"));
+	CHECK(!Parse("[" + Entry + ",]"));
+	CHECK(!Parse("[" + Entry + ",," + Entry + "]"));
+	CHECK(!Parse("[{," + members + "}]"));
+	CHECK(!Parse("[{" + members + ",}]"));
+	CHECK(!Parse("[{\"x\":1,," + members.substr(6) + "}]"));
+	CHECK(!Parse("[{\"x\":1 " + members.substr(6) + "}]"));
+}
+
+// Values of unknown keys are skipped but still have to be well formed
+static void TestSkippedValues()
+{
+	const std::string members = "\"x\":1,\"y\":2,\"w\":3,\"h\":4,\"message\":\"m\",\"translation\":\"t\"";
+
+	CHECK(Parse("[{\"box\": [[], {}, [1, {\"a\": [true]}]], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [1,, 2], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [, 1], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [1, 2,], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [1 2], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": {\"a\": 1,}, " + members + "}]"));
+	CHECK(!Parse("[{\"box\": {\"a\" 1}, " + members + "}]"));
+	CHECK(!Parse("[{\"box\": {1: 2}, " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [1: 2], " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [1}, " + members + "}]"));
+	CHECK(!Parse("[{\"box\": [nope], " + members + "}]"));
+}
+
+// Coordinates must fit an int and sizes a float, the conversion of anything larger is undefined
+static void TestNumberRange()
+{
+	const std::string rest = "\"message\":\"m\",\"translation\":\"t\"}]";
+	std::vector<TranslationEntry> entries;
+
+	CHECK(Parse("[{\"x\":-2147483648,\"y\":2147483647,\"w\":3.4e38,\"h\":0," + rest, &entries));
+	CHECK(entries.size() == 1 && entries[0].x == INT_MIN && entries[0].y == INT_MAX);
+
+	CHECK(!Parse("[{\"x\":1e10,\"y\":2,\"w\":3,\"h\":4," + rest));
+	CHECK(!Parse("[{\"x\":1,\"y\":-2147483649,\"w\":3,\"h\":4," + rest));
+	CHECK(!Parse("[{\"x\":1,\"y\":2,\"w\":1e39,\"h\":4," + rest));
+	CHECK(!Parse("[{\"x\":1,\"y\":2,\"w\":3,\"h\":-1e999," + rest));
+	CHECK(!Parse("[{\"x\":1e999,\"y\":2,\"w\":3,\"h\":4," + rest));
+}
+
+int main()
+{
+	TestEntry();
+	TestChunks();
+	TestIncremental();
+	TestEscapes();
+	TestUnknownKeys();
+	TestMalformed();
+	TestCommas();
+	TestSkippedValues();
+	TestNumberRange();
+
+	return 0;
+}
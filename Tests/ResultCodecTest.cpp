@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ResponseParser.h"
+#include "ResultCodec.h"
+
+using TranslateClient::TranslationEntry;
+
+static std::vector<TranslationEntry> MakeEntries(std::mt19937* random)
+{
+	std::vector<TranslationEntry> entries((*random)() % 6);
+
+	for (TranslationEntry& entry : entries)
+	{
+		entry.x = int((*random)() % 1000);
+		entry.y = -int((*random)() % 50);
+		entry.w = 1.5f;
+		entry.h = float((*random)() % 100);
+		entry.message = std::string((*random)() % 40, 'm');
+		entry.translation = std::string((*random)() % 40, 't');
+	}
+
+	return entries;
+}
+
+// Encoded results fed in chunks of any size come back as they went in
+static void TestRoundTrip()
+{
+	std::mt19937 random(1);
+
+	for (int trial = 0; trial < 2000; trial++)
+	{
+		std::vector<TranslationEntry> entries = MakeEntries(&random);
+		std::vector<uint8_t> encoded;
+		ResultCodec::Encode(entries, &encoded);
+
+		ResponseParser parser;
+		std::vector<TranslationEntry> decoded;
+
+		for (size_t position = 0; position < encoded.size();)
+		{
+			size_t size = std::min<size_t>(encoded.size() - position, 1 + random() % 30);
+			CHECK(parser.Feed((const char*)encoded.data() + position, size, &decoded));
+			position += size;
+		}
+
+		CHECK(parser.Finish(&decoded));
+		CHECK(decoded.size() == entries.size());
+
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			CHECK(decoded[i].x == entries[i].x && decoded[i].y == entries[i].y);
+			CHECK(decoded[i].w == entries[i].w && decoded[i].h == entries[i].h);
+			CHECK(decoded[i].message == entries[i].message && decoded[i].translation == entries[i].translation);
+		}
+	}
+}
+
+// A record is handed out as soon as it arrived, before the rest of the response
+static void TestPartial()
+{
+	std::vector<TranslationEntry> entries(2);
+	entries[0].message = "hello";
+	entries[1].message = std::string(1000, 'x');
+
+	std::vector<uint8_t> encoded;
+	ResultCodec::Encode(entries, &encoded);
+
+	ResponseParser parser;
+	std::vector<TranslationEntry> decoded;
+
+	CHECK(parser.Feed((const char*)encoded.data(), ResultCodec::HeaderSize + ResultCodec::RecordHeaderSize + 5 + 10, &decoded));
+	CHECK(decoded.size() == 1 && decoded[0].message == "hello");
+}
+
+// Truncated responses and trailing bytes are rejected, corrupted ones at least never read out of bounds
+static void TestMalformed()
+{
+	std::mt19937 random(2);
+
+	for (int trial = 0; trial < 2000; trial++)
+	{
+		std::vector<TranslationEntry> entries = MakeEntries(&random);
+		std::vector<uint8_t> encoded;
+		ResultCodec::Encode(entries, &encoded);
+
+		{
+			ResponseParser parser;
+			std::vector<TranslationEntry> decoded;
+			size_t cut = 1 + random() % (encoded.size() - 1);
+
+			parser.Feed((const char*)encoded.data(), cut, &decoded);
+			CHECK(!parser.Finish(&decoded));
+		}
+
+		{
+			std::vector<uint8_t> corrupted = encoded;
+			corrupted[random() % corrupted.size()] ^= uint8_t(1 << (random() % 8));
+
+			ResponseParser parser;
+			std::vector<TranslationEntry> decoded;
+
+			parser.Feed((const char*)corrupted.data(), corrupted.size(), &decoded);
+			parser.Finish(&decoded);
+		}
+
+		{
+			std::vector<uint8_t> trailing = encoded;
+			trailing.push_back(0);
+
+			ResponseParser parser;
+			std::vector<TranslationEntry> decoded;
+
+			CHECK(!parser.Feed((const char*)trailing.data(), trailing.size(), &decoded));
+		}
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestPartial();
+	TestMalformed();
+
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "SnapshotSlot.h"
+#include "TranslationEntry.h"
+
+using TranslateClient::TranslationEntry;
+
+struct BenchSnapshot
+{
+	uint64_t generation = 0;
+	std::vector<TranslationEntry> entries;
+};
+
+// A screen of text, 40 lines with their translations
+static std::vector<TranslationEntry> MakeEntries()
+{
+	std::vector<TranslationEntry> entries(40);
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].x = 20;
+		entries[i].y = int(i) * 24;
+		entries[i].w = 600.0f;
+		entries[i].h = 22.0f;
+		entries[i].message = "Recognized line of dialogue number " + std::to_string(i);
+		entries[i].translation = "Translated line of dialogue number " + std::to_string(i);
+	}
+
+	return entries;
+}
+
+// What the render thread pays per frame to get the entries: the copy under the client mutex it did
+// before, against acquiring the published snapshot. Also with a writer publishing all the time.
+int main()
+{
+	std::mutex mutex;
+	std::vector<TranslationEntry> shared = MakeEntries();
+
+	double copyUs = MeasureUs([&]()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<TranslationEntry> copy = shared;
+		Consume(copy.size());
+	});
+
+	SnapshotSlot<BenchSnapshot> slot;
+	auto first = std::make_shared<BenchSnapshot>();
+	first->entries = MakeEntries();
+	slot.Publish(std::move(first));
+
+	double acquireUs = MeasureUs([&]()
+	{
+		std::shared_ptr<const BenchSnapshot> snapshot = slot.Acquire();
+		Consume(snapshot->entries.size());
+	});
+
+	// A response every millisecond is far more than the server delivers
+	std::atomic<bool> done = false;
+	std::thread writer([&]()
+	{
+		while (!done)
+		{
+			auto next = std::make_shared<BenchSnapshot>();
+			next->entries = MakeEntries();
+			slot.Publish(std::move(next));
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	uint64_t lastGeneration = 0;
+	uint64_t changes = 0;
+
+	double contendedUs = MeasureUs([&]()
+	{
+		std::shared_ptr<const BenchSnapshot> snapshot = slot.Acquire();
+
+		if (snapshot->generation != lastGeneration)
+		{
+			lastGeneration = snapshot->generation;
+			changes++;
+		}
+
+		Consume(snapshot->entries.size());
+	}, 500.0);
+
+	done = true;
+	writer.join();
+
+	std::printf("per frame, 40 entries  copy under mutex %7.1f ns  acquire snapshot %6.1f ns\n",
+		copyUs * 1000.0, acquireUs * 1000.0);
+	std::printf("acquire while publishing every 1 ms %6.1f ns, %llu generations seen\n",
+		contendedUs * 1000.0, (unsigned long long)changes);
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "SnapshotSlot.h"
+#include "TranslationEntry.h"
+
+using TranslateClient::TranslationEntry;
+
+struct TestSnapshot
+{
+	uint64_t generation = 0;
+	std::vector<TranslationEntry> entries;
+};
+
+// Every entry of a snapshot names the generation it was published as, a torn or reused snapshot shows up
+static std::vector<TranslationEntry> MakeEntries(uint64_t generation)
+{
+	std::vector<TranslationEntry> entries(generation % 8);
+
+	for (TranslationEntry& entry : entries)
+	{
+		entry.x = int(generation);
+		entry.message = "message of generation " + std::to_string(generation);
+		entry.translation = entry.message;
+	}
+
+	return entries;
+}
+
+static bool IsConsistent(const TestSnapshot& snapshot)
+{
+	if (snapshot.entries.size() != snapshot.generation % 8)
+	{
+		return false;
+	}
+
+	for (const TranslationEntry& entry : snapshot.entries)
+	{
+		if (uint64_t(entry.x) != snapshot.generation || entry.message != "message of generation " + std::to_string(snapshot.generation))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// The slot starts with an empty value, generations count the publications
+static void TestGenerations()
+{
+	SnapshotSlot<TestSnapshot> slot;
+
+	std::shared_ptr<const TestSnapshot> first = slot.Acquire();
+	CHECK(first->generation == 0 && first->entries.empty());
+
+	auto next = std::make_shared<TestSnapshot>();
+	next->entries = MakeEntries(1);
+	slot.Publish(std::move(next));
+
+	std::shared_ptr<const TestSnapshot> second = slot.Acquire();
+	CHECK(second->generation == 1 && IsConsistent(*second));
+	CHECK(slot.GetGeneration() == 1);
+
+	// A reader keeps what it acquired, also after newer values replaced it
+	slot.Publish(std::make_shared<TestSnapshot>());
+	CHECK(first->generation == 0 && second->generation == 1);
+	CHECK(slot.Acquire()->generation == 2);
+}
+
+// Writers publish under a mutex as the client does while readers spin on the slot. Readers never see a
+// generation go back or a snapshot change under them. Built with -fsanitize=thread as well.
+static void TestConcurrentPublish()
+{
+	const uint64_t publications = 4000;
+	const int writerCount = 2;
+	const int readerCount = 3;
+
+	SnapshotSlot<TestSnapshot> slot;
+	std::mutex writerMutex;
+	std::atomic<bool> done = false;
+	std::atomic<int> failures = 0;
+	std::atomic<uint64_t> reads = 0;
+
+	std::vector<std::thread> readers;
+
+	for (int i = 0; i < readerCount; i++)
+	{
+		readers.emplace_back([&]()
+		{
+			uint64_t last = 0;
+
+			while (!done)
+			{
+				std::shared_ptr<const TestSnapshot> snapshot = slot.Acquire();
+
+				if (snapshot->generation < last || !IsConsistent(*snapshot))
+				{
+					failures++;
+				}
+
+				last = snapshot->generation;
+				reads++;
+			}
+		});
+	}
+
+	std::vector<std::thread> writers;
+
+	for (int i = 0; i < writerCount; i++)
+	{
+		writers.emplace_back([&]()
+		{
+			for (uint64_t n = 0; n < publications / writerCount; n++)
+			{
+				std::lock_guard<std::mutex> lock(writerMutex);
+
+				auto next = std::make_shared<TestSnapshot>();
+				next->entries = MakeEntries(slot.GetGeneration() + 1);
+				slot.Publish(std::move(next));
+			}
+		});
+	}
+
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+
+	done = true;
+
+	for (std::thread& reader : readers)
+	{
+		reader.join();
+	}
+
+	CHECK(failures == 0);
+	CHECK(reads > 0);
+	CHECK(slot.Acquire()->generation == publications);
+	CHECK(IsConsistent(*slot.Acquire()));
+}
+
+int main()
+{
+	TestGenerations();
+	TestConcurrentPublish();
+
+	return 0;
+}
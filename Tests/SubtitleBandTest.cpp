@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "SubtitleBand.h"
+
+// A line of text across the screen, seed decides what it says
+static void DrawLine(GrayImage* image, int top, int height, int seed)
+{
+	std::mt19937 random(seed);
+
+	for (int y = top; y < top + height; y++)
+	{
+		for (int x = 100; x < image->width - 100; x++)
+		{
+			image->Row(y)[x] = (x / 3 + seed) % 5 == 0 || random() % 7 == 0 ? 230 : 20;
+		}
+	}
+}
+
+// Two lines of dialogue that change every frame vote for their rows, a static HUD in either half does not
+static void TestDetector()
+{
+	SubtitleBandDetector detector;
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		GrayImage image;
+		image.width = 640;
+		image.height = 360;
+		image.pixels.assign(size_t(image.width) * image.height, 20);
+
+		DrawLine(&image, 10, 14, 1);
+		DrawLine(&image, 200, 12, 7);
+		DrawLine(&image, 300, 14, frame);
+		DrawLine(&image, 320, 14, frame + 100);
+
+		detector.Feed(image);
+
+		// The first frame has nothing to compare to, every later one adds a vote
+		CHECK(detector.IsFound() == (frame >= SubtitleBandDetector::MinVotes));
+	}
+
+	const ImageRect& band = detector.GetBand();
+
+	CHECK(band.x == 0 && band.width == 640);
+	CHECK(band.y <= 300 && band.y > 212);
+	CHECK(band.Bottom() >= 334 && band.Bottom() <= 360);
+}
+
+static void TestFromFractions()
+{
+	ImageRect band = SubtitleBand::FromFractions(1920, 1080, 0.75f, 0.95f);
+	CHECK(band.x == 0 && band.y == 810 && band.width == 1920 && band.height == 216);
+
+	band = SubtitleBand::FromFractions(100, 100, 0.9f, 0.5f);
+	CHECK(band.y == 90 && band.height == 0);
+
+	band = SubtitleBand::FromFractions(100, 100, -1.0f, 2.0f);
+	CHECK(band.y == 0 && band.height == 100);
+}
+
+// Every value of the sequence is a band of a different brightness, 0 has no text
+static std::vector<SubtitleTracker::Action> Track(const std::vector<int>& sequence, int stableFrames)
+{
+	SubtitleTracker tracker(stableFrames);
+	std::vector<SubtitleTracker::Action> actions;
+	std::vector<uint8_t> pixels(640 * 40 * 4);
+
+	ImageView view;
+	view.pixels = pixels.data();
+	view.width = 640;
+	view.height = 40;
+	view.rowPitch = 640 * 4;
+	view.bgra = true;
+
+	for (int value : sequence)
+	{
+		std::fill(pixels.begin(), pixels.end(), uint8_t(value * 50));
+
+		FrameDiff::Signature signature = FrameDiff::ComputeSignature(view, 16);
+		actions.push_back(tracker.Feed(signature, 4, [value] { return value != 0; }));
+	}
+
+	return actions;
+}
+
+// A subtitle is sent once after it stayed for stableFrames captures, an empty band clears it
+static void TestTracker()
+{
+	using Action = SubtitleTracker::Action;
+
+	std::vector<Action> actions = Track({ 1, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0 }, 4);
+	std::vector<Action> expected(actions.size(), Action::None);
+
+	// Four captures the same as the one before
+	expected[5] = Action::Submit;
+	// 3 never settled, the 1 that follows differs from the 2 sent last
+	expected[15] = Action::Submit;
+	expected[20] = Action::Clear;
+
+	CHECK(actions == expected);
+
+	// A subtitle that comes back after something else was sent is sent again
+	actions = Track({ 1, 1, 2, 2, 1, 1 }, 1);
+	CHECK((actions == std::vector<Action>{ Action::None, Action::Submit, Action::None, Action::Submit, Action::None, Action::Submit }));
+}
+
+int main()
+{
+	TestDetector();
+	TestFromFractions();
+	TestTracker();
+
+	return 0;
+}
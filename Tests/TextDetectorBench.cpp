@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "TextDetector.h"
+
+static std::mt19937 Random(11);
+
+// Glyphs of random strokes like in TextDetectorTest, in the given luma
+static void DrawWord(GrayImage* image, int left, int top, int height, int glyphs, uint8_t luma)
+{
+	int width = height / 2;
+
+	for (int glyph = 0; glyph < glyphs; glyph++)
+	{
+		int glyphLeft = left + glyph * (height * 6 / 10);
+
+		for (int stroke = 0; stroke < 3; stroke++)
+		{
+			int kind = int(Random() % 4);
+			int thickness = std::max(2, height / 12);
+
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					bool on = kind == 0 ? x < thickness
+						: kind == 1 ? y < thickness || y >= height - thickness
+						: kind == 2 ? x >= width - thickness
+						: y >= height / 2 - thickness / 2 && y < height / 2 + (thickness + 1) / 2;
+
+					if (on)
+					{
+						image->Row(top + y)[glyphLeft + x] = luma;
+					}
+				}
+			}
+		}
+	}
+}
+
+struct Frame
+{
+	GrayImage image;
+	std::vector<ImageRect> lines;
+};
+
+// A 1080p frame: a noisy gradient, a few patches of texture, and lines of text of 10 to 48 pixels
+// that do not touch each other or the textures
+static Frame MakeFrame()
+{
+	Frame frame;
+	GrayImage& image = frame.image;
+	image.width = 1920;
+	image.height = 1080;
+	image.pixels.resize(size_t(image.width) * image.height);
+
+	for (int y = 0; y < image.height; y++)
+	{
+		for (int x = 0; x < image.width; x++)
+		{
+			image.Row(y)[x] = uint8_t(50 + (x + y) * 60 / 3000 + Random() % 6);
+		}
+	}
+
+	std::vector<ImageRect> taken;
+
+	auto isFree = [&taken](const ImageRect& rect)
+	{
+		ImageRect margin = { rect.x - 24, rect.y - 24, rect.width + 48, rect.height + 48 };
+
+		return std::none_of(taken.begin(), taken.end(), [&margin](const ImageRect& other) { return margin.Intersects(other); });
+	};
+
+	for (int patch = 0; patch < 3; patch++)
+	{
+		ImageRect rect = { int(Random() % 1500), int(Random() % 800), 200 + int(Random() % 200), 100 + int(Random() % 150) };
+
+		if (!isFree(rect))
+		{
+			continue;
+		}
+
+		for (int y = rect.y; y < rect.Bottom(); y++)
+		{
+			for (int x = rect.x; x < rect.Right(); x++)
+			{
+				image.Row(y)[x] = uint8_t(Random());
+			}
+		}
+
+		taken.push_back(rect);
+	}
+
+	for (int attempt = 0; attempt < 40 && frame.lines.size() < 12; attempt++)
+	{
+		int height = 10 + int(Random() % 39);
+		int words = 1 + int(Random() % 6);
+		std::vector<int> glyphs;
+		int width = 0;
+
+		for (int word = 0; word < words; word++)
+		{
+			glyphs.push_back(2 + int(Random() % 6));
+			width += glyphs.back() * (height * 6 / 10) + (word + 1 < words ? height / 2 : 0);
+		}
+
+		if (width >= image.width - 20)
+		{
+			continue;
+		}
+
+		ImageRect line = { 10 + int(Random() % (image.width - 20 - width)), 10 + int(Random() % (image.height - 20 - height)), width, height };
+
+		if (!isFree(line))
+		{
+			continue;
+		}
+
+		int x = line.x;
+
+		for (int count : glyphs)
+		{
+			DrawWord(&image, x, line.y, height, count, Random() % 2 ? 240 : 10);
+			x += count * (height * 6 / 10) + height / 2;
+		}
+
+		taken.push_back(line);
+		frame.lines.push_back(line);
+	}
+
+	return frame;
+}
+
+static int Overlap(const ImageRect& a, const ImageRect& b)
+{
+	int width = std::min(a.Right(), b.Right()) - std::max(a.x, b.x);
+	int height = std::min(a.Bottom(), b.Bottom()) - std::max(a.y, b.y);
+
+	return width > 0 && height > 0 ? width * height : 0;
+}
+
+// Precision and recall of the proposals on a corpus of synthetic frames, and the time per frame
+int main()
+{
+	const int frames = 30;
+	std::vector<Frame> corpus;
+
+	for (int i = 0; i < frames; i++)
+	{
+		corpus.push_back(MakeFrame());
+	}
+
+	TextDetector detector;
+
+	// A proposal is correct when most of it is text, a line is found when proposals cover most of it
+	int proposals = 0;
+	int correct = 0;
+	int lines = 0;
+	int found = 0;
+	int64_t proposedArea = 0;
+
+	for (const Frame& frame : corpus)
+	{
+		std::vector<ImageRect> detected = detector.Detect(frame.image);
+
+		for (const ImageRect& proposal : detected)
+		{
+			int text = 0;
+
+			for (const ImageRect& line : frame.lines)
+			{
+				text += Overlap(proposal, line);
+			}
+
+			proposals++;
+			correct += text * 2 > proposal.Area();
+			proposedArea += proposal.Area();
+		}
+
+		for (const ImageRect& line : frame.lines)
+		{
+			int covered = 0;
+
+			for (const ImageRect& proposal : detected)
+			{
+				covered += Overlap(proposal, line);
+			}
+
+			lines++;
+			found += covered * 10 >= line.Area() * 8;
+		}
+	}
+
+	std::printf("%d frames, %d lines: precision %.1f%%, recall %.1f%%, %.1f%% of the frame sent\n",
+		frames, lines, correct * 100.0 / std::max(1, proposals), found * 100.0 / std::max(1, lines),
+		proposedArea * 100.0 / (double(frames) * 1920 * 1080));
+
+	TextDetectorOptions single;
+	single.threads = 1;
+	TextDetector singleThreaded(single);
+
+	size_t next = 0;
+	double singleUs = MeasureUs([&]() { Consume(singleThreaded.Detect(corpus[next++ % frames].image).size()); }, 1000.0);
+	double allUs = MeasureUs([&]() { Consume(detector.Detect(corpus[next++ % frames].image).size()); }, 1000.0);
+
+	std::printf("1080p: %.2f ms on one thread, %.2f ms on %u threads\n",
+		singleUs / 1000.0, allUs / 1000.0, std::max(1u, std::thread::hardware_concurrency()));
+
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "TextDetector.h"
+
+static std::mt19937 Random(5);
+
+// A word of n glyphs made of random strokes, bars along the edges or across the middle
+static void DrawWord(GrayImage* image, int left, int top, int height, int glyphs)
+{
+	int width = height / 2;
+
+	for (int glyph = 0; glyph < glyphs; glyph++)
+	{
+		int glyphLeft = left + glyph * (height * 6 / 10);
+
+		for (int stroke = 0; stroke < 3; stroke++)
+		{
+			int kind = int(Random() % 4);
+
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					bool on = kind == 0 ? x < 2
+						: kind == 1 ? y < 2 || y >= height - 2
+						: kind == 2 ? x >= width - 2
+						: y > height / 2 - 1 && y < height / 2 + 1;
+
+					if (on)
+					{
+						image->Row(top + y)[glyphLeft + x] = 240;
+					}
+				}
+			}
+		}
+	}
+}
+
+// A line of words, returns its bounding box
+static ImageRect DrawLine(GrayImage* image, int left, int top, int height, int words)
+{
+	int x = left;
+
+	for (int word = 0; word < words; word++)
+	{
+		int glyphs = 3 + int(Random() % 5);
+
+		DrawWord(image, x, top, height, glyphs);
+		x += glyphs * (height * 6 / 10) + height / 2;
+	}
+
+	return { left, top, x - left - height / 2, height };
+}
+
+static bool Overlaps(const ImageRect& a, const ImageRect& b)
+{
+	return a.x < b.Right() && b.x < a.Right() && a.y < b.Bottom() && b.y < a.Bottom();
+}
+
+// Lines of text on a noisy gradient are found, a patch of noisy texture is not
+static void TestDetect()
+{
+	GrayImage image;
+	image.width = 1920;
+	image.height = 1080;
+	image.pixels.resize(size_t(image.width) * image.height);
+
+	for (int y = 0; y < image.height; y++)
+	{
+		for (int x = 0; x < image.width; x++)
+		{
+			image.Row(y)[x] = uint8_t(60 + (x * y) % 40 / 4 + Random() % 6);
+		}
+	}
+
+	const ImageRect texture = { 1200, 100, 500, 300 };
+
+	for (int y = texture.y; y < texture.Bottom(); y++)
+	{
+		for (int x = texture.x; x < texture.Right(); x++)
+		{
+			image.Row(y)[x] = uint8_t(Random());
+		}
+	}
+
+	std::vector<ImageRect> truth;
+	truth.push_back(DrawLine(&image, 300, 900, 28, 6));
+	truth.push_back(DrawLine(&image, 300, 945, 28, 5));
+	truth.push_back(DrawLine(&image, 50, 50, 16, 3));
+	truth.push_back(DrawLine(&image, 800, 500, 20, 4));
+	truth.push_back(DrawLine(&image, 100, 700, 40, 2));
+
+	std::vector<ImageRect> lines = TextDetector().Detect(image);
+
+	for (const ImageRect& line : lines)
+	{
+		CHECK(!Overlaps(line, texture));
+
+		bool inside = false;
+
+		for (const ImageRect& text : truth)
+		{
+			inside = inside || Overlaps(line, text);
+		}
+
+		CHECK(inside);
+	}
+
+	// Most of every line is covered, glyphs made of thin bars alone may be missed.
+	// Crops span the height of their line and are not merged with the next one.
+	for (const ImageRect& text : truth)
+	{
+		int covered = 0;
+
+		for (const ImageRect& line : lines)
+		{
+			if (Overlaps(line, text))
+			{
+				CHECK(line.y <= text.y && line.Bottom() >= text.Bottom());
+				CHECK(line.Bottom() - text.Bottom() < text.height / 2);
+
+				int left = std::max(line.x, text.x);
+				int right = std::min(line.Right(), text.Right());
+				covered += right - left;
+			}
+		}
+
+		CHECK(covered * 3 >= text.width * 2);
+	}
+
+	// Splitting the work across threads changes nothing
+	TextDetectorOptions options;
+	options.threads = 1;
+	std::vector<ImageRect> single = TextDetector(options).Detect(image);
+
+	CHECK(single.size() == lines.size());
+
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		CHECK(single[i].x == lines[i].x && single[i].y == lines[i].y);
+		CHECK(single[i].width == lines[i].width && single[i].height == lines[i].height);
+	}
+
+	GrayImage tiny;
+	tiny.width = 4;
+	tiny.height = 4;
+	tiny.pixels.assign(16, 0);
+	CHECK(TextDetector().Detect(tiny).empty());
+}
+
+// Lines close to each other share a crop while it does not waste much, distant ones keep their own
+static void TestMergeCrops()
+{
+	std::vector<ImageRect> crops = TextDetector::MergeCrops({ { 300, 900, 600, 30 }, { 300, 945, 520, 30 }, { 50, 50, 100, 20 }, { 800, 500, 220, 25 } }, 1.5f);
+
+	CHECK(crops.size() == 3);
+
+	bool merged = false;
+
+	for (const ImageRect& crop : crops)
+	{
+		merged = merged || (crop.x == 300 && crop.y == 900 && crop.width == 600 && crop.height == 75);
+	}
+
+	CHECK(merged);
+	CHECK(TextDetector::MergeCrops({}, 1.5f).empty());
+	CHECK(TextDetector::MergeCrops({ { 0, 0, 10, 10 }, { 1000, 1000, 10, 10 } }, 1.5f).size() == 2);
+}
+
+int main()
+{
+	TestDetect();
+	TestMergeCrops();
+
+	return 0;
+}
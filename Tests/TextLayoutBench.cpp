@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "FontMetrics.h"
+#include "TextLayout.h"
+
+using TranslateClient::TranslationEntry;
+
+static const char* Words[] = {
+	"the", "sword", "of", "ancient", "kings", "restores", "health", "when", "equipped", "by", "a", "knight",
+	"open", "menu", "to", "continue", "your", "journey", "through", "forgotten", "lands"
+};
+
+// A screen of count boxes with translations of 3 to 14 words
+static std::vector<TranslationEntry> MakeEntries(int count, int seed)
+{
+	std::vector<TranslationEntry> entries;
+
+	for (int i = 0; i < count; i++)
+	{
+		TranslationEntry entry;
+		int words = 3 + (i * 7 + seed) % 12;
+
+		for (int word = 0; word < words; word++)
+		{
+			entry.translation += std::string(word == 0 ? "" : " ") + Words[(i * 13 + word * 5 + seed) % 21];
+		}
+
+		entry.message = entry.translation;
+		entry.x = (i % 10) * 190;
+		entry.y = (i / 10) * 40;
+		entry.w = 180.0f + float(i % 5) * 40.0f;
+		entry.h = 30.0f + float(i % 3) * 20.0f;
+		entries.push_back(entry);
+	}
+
+	return entries;
+}
+
+// Layout time per box with build/font.spritefont, and what the layout cache saves when a snapshot is published
+int main()
+{
+	FontMetrics font;
+
+	if (!font.Load(FONT_PATH))
+	{
+		std::printf("Cannot load %s\n", FONT_PATH);
+		return 1;
+	}
+
+	LayoutCache::MeasureFunction measure = [&font](const char* text) { return font.MeasureString(text); };
+	const int count = 2000;
+	std::vector<TranslationEntry> entries = MakeEntries(count, 0);
+
+	const char* breakingNames[] = { "greedy", "balanced" };
+
+	for (LineBreaking breaking : { LineBreaking::Greedy, LineBreaking::Balanced })
+	{
+		TextFitOptions options;
+		options.breaking = breaking;
+
+		double us = MeasureUs([&]()
+		{
+			for (const TranslationEntry& entry : entries)
+			{
+				Consume(TextLayoutEngine::FitToBox(entry.translation, measure, 0.0f, 0.0f, entry.w, entry.h, options).text.size());
+			}
+		});
+
+		std::printf("FitToBox %-8s %8.1f us per box\n", breakingNames[int(breaking)], us / count);
+	}
+
+	TextFitOptions options;
+	options.breaking = LineBreaking::Balanced;
+
+	// What publishing a snapshot costs the writer, the render thread measures nothing afterwards.
+	// Every string is new, as on the first snapshot of a screen.
+	double buildUs = MeasureUs([&]()
+	{
+		LayoutCache cache(options);
+		Consume(cache.Build(&font, true, entries, measure).size());
+	});
+
+	// The layouts of the snapshot before are carried over
+	LayoutCache cache(options);
+	cache.Build(&font, true, entries, measure);
+
+	double sameUs = MeasureUs([&]() { Consume(cache.Build(&font, true, entries, measure).size()); });
+
+	// A new snapshot where one box in ten changed its text
+	std::vector<TranslationEntry> changed = MakeEntries(count, 0);
+	std::vector<TranslationEntry> fresh = MakeEntries(count, 1);
+
+	for (int i = 0; i < count; i += 10)
+	{
+		changed[i] = fresh[i];
+	}
+
+	double partialUs = MeasureUs([&]()
+	{
+		cache.Build(&font, true, entries, measure);
+		Consume(cache.Build(&font, true, changed, measure).size());
+	}) / 2.0;
+
+	std::printf("LayoutCache %d boxes on publish: new screen %8.1f ms, same text %6.2f ms, 10%% changed %8.1f ms\n",
+		count, buildUs / 1000.0, sameUs / 1000.0, partialUs / 1000.0);
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TextLayout.h"
+
+using TranslateClient::TranslationEntry;
+
+// Monospaced stand-in for a font: every character 10 pixels wide, every line 20 pixels high
+static int measureCalls = 0;
+
+static TextSize MeasureMono(const char* text)
+{
+	float width = 0.0f;
+	float widest = 0.0f;
+	int lines = 1;
+
+	measureCalls++;
+
+	for (; *text != '\0'; text++)
+	{
+		if (*text == '\n')
+		{
+			lines++;
+			width = 0.0f;
+			continue;
+		}
+
+		width += 10.0f;
+		widest = std::max(widest, width);
+	}
+
+	TextSize size;
+	size.width = widest;
+	size.height = widest > 0.0f ? lines * 20.0f : 0.0f;
+	return size;
+}
+
+static bool Near(float a, float b)
+{
+	return std::fabs(a - b) < 1e-3f;
+}
+
+static TranslationEntry MakeEntry(int x, int y, float w, float h, const std::string& message, const std::string& translation)
+{
+	TranslationEntry entry;
+	entry.x = x;
+	entry.y = y;
+	entry.w = w;
+	entry.h = h;
+	entry.message = message;
+	entry.translation = translation;
+	return entry;
+}
+
+static const TextFitOptions StretchOptions = { TextFitMode::Stretch };
+
+static void TestStretch()
+{
+	TextLayout layout = TextLayoutEngine::StretchToBox({ 40.0f, 20.0f }, 5.0f, 6.0f, 80.0f, 10.0f);
+
+	CHECK(layout.visible);
+	CHECK(layout.x == 5.0f && layout.y == 6.0f);
+	CHECK(layout.scaleX == 2.0f && layout.scaleY == 0.5f);
+
+	CHECK(!TextLayoutEngine::StretchToBox({}, 0.0f, 0.0f, 80.0f, 10.0f).visible);
+}
+
+// Layouts are built once per published snapshot, strings that stay on screen are carried over
+static void TestLayoutCache()
+{
+	LayoutCache cache(StretchOptions);
+	int font = 0;
+	std::vector<TranslationEntry> entries = {
+		MakeEntry(100, 50, 80.0f, 20.0f, "hola", "hello"),
+		MakeEntry(10, 20, 40.0f, 40.0f, "adios", "bye")
+	};
+
+	measureCalls = 0;
+
+	std::vector<TextLayout> layouts = cache.Build(&font, true, entries, &MeasureMono);
+	CHECK(layouts.size() == 2);
+	CHECK(cache.GetMeasuredCount() == 2);
+	// "hello" is 50x20, stretched over 80x20 at the position of its entry
+	CHECK(layouts[0].x == 100.0f && layouts[0].y == 50.0f);
+	CHECK(Near(layouts[0].scaleX, 1.6f) && layouts[0].scaleY == 1.0f);
+	CHECK(layouts[1].x == 10.0f && Near(layouts[1].scaleX, 40.0f / 30.0f));
+
+	// The recognized text is cached on its own, building both for every snapshot measures each string once
+	cache.Build(&font, false, entries, &MeasureMono);
+	CHECK(cache.GetMeasuredCount() == 4);
+	cache.Build(&font, true, entries, &MeasureMono);
+	cache.Build(&font, false, entries, &MeasureMono);
+	CHECK(cache.GetMeasuredCount() == 4);
+
+	// The next snapshot only measures what is new, moved entries keep their layout
+	entries[1].x = 300;
+	entries.push_back(MakeEntry(0, 0, 30.0f, 20.0f, "si", "yes"));
+
+	std::vector<TextLayout> next = cache.Build(&font, true, entries, &MeasureMono);
+	CHECK(next.size() == 3);
+	CHECK(cache.GetMeasuredCount() == 5);
+	CHECK(next[1].x == 300.0f);
+
+	// Another font is laid out anew
+	int otherFont = 0;
+	cache.Build(&otherFont, true, entries, &MeasureMono);
+	CHECK(cache.GetMeasuredCount() == 8);
+
+	// Strings that left the screen are dropped from the cache
+	entries.resize(1);
+	cache.Build(&otherFont, true, entries, &MeasureMono);
+	cache.Build(&otherFont, true, { MakeEntry(0, 0, 40.0f, 40.0f, "adios", "bye") }, &MeasureMono);
+	CHECK(cache.GetMeasuredCount() == 9);
+
+	// Text that cannot be measured is not drawn
+	std::vector<TextLayout> empty = cache.Build(&font, true, { MakeEntry(0, 0, 30.0f, 20.0f, "", "") }, &MeasureMono);
+	CHECK(empty.size() == 1 && !empty[0].visible);
+}
+
+// Line breaking alone, at a fixed line height of 20 pixels
+static void TestBreaking()
+{
+	TextFitOptions options;
+	options.minLineHeight = 20.0f;
+	options.maxLineHeight = 20.0f;
+
+	// Greedy fills the first line and leaves 4 characters of slack in the second
+	options.breaking = LineBreaking::Greedy;
+	TextLayout greedy = TextLayoutEngine::FitToBox("aaa bb cc ddddd", &MeasureMono, 0.0f, 0.0f, 60.0f, 200.0f, options);
+	CHECK(greedy.text == "aaa bb\ncc\nddddd");
+	CHECK(greedy.scaleX == 1.0f && greedy.scaleY == 1.0f);
+
+	// Balanced spreads the slack, 3 and 1 squared is less than 0 and 4 squared
+	options.breaking = LineBreaking::Balanced;
+	TextLayout balanced = TextLayoutEngine::FitToBox("aaa bb cc ddddd", &MeasureMono, 0.0f, 0.0f, 60.0f, 200.0f, options);
+	CHECK(balanced.text == "aaa\nbb cc\nddddd");
+
+	// The block is centered, the lines within it left aligned
+	CHECK(balanced.x == 5.0f && balanced.y == 70.0f);
+
+	// The last line does not count, it may stay short
+	balanced = TextLayoutEngine::FitToBox("aaaa bbbb c", &MeasureMono, 0.0f, 0.0f, 100.0f, 200.0f, options);
+	CHECK(balanced.text == "aaaa bbbb\nc");
+
+	// Line breaks of the text are kept, runs of spaces collapse, a word wider than the box gets a line of its own
+	balanced = TextLayoutEngine::FitToBox("ab  cd\nefghijklmnop q", &MeasureMono, 0.0f, 0.0f, 60.0f, 200.0f, options);
+	CHECK(balanced.text == "ab cd\nefghijklmnop\nq");
+}
+
+// The scale is the largest that fits, within the line heights of the options
+static void TestScale()
+{
+	TextFitOptions options;
+
+	// Short text grows up to the largest line height, 48 / 20
+	TextLayout layout = TextLayoutEngine::FitToBox("Hi", &MeasureMono, 0.0f, 0.0f, 200.0f, 100.0f, options);
+	CHECK(Near(layout.scaleX, 2.4f) && layout.scaleX == layout.scaleY);
+	CHECK(Near(layout.x, 76.0f) && Near(layout.y, 26.0f));
+	CHECK(layout.text == "Hi");
+
+	// A low box limits the line height
+	layout = TextLayoutEngine::FitToBox("Hello", &MeasureMono, 10.0f, 20.0f, 300.0f, 30.0f, options);
+	CHECK(Near(layout.scaleY, 1.5f) && Near(layout.y, 20.0f));
+
+	// In between the binary search ends within half a pixel of line height of the best fit
+	const char* text = "one two three four five six seven eight nine ten";
+	layout = TextLayoutEngine::FitToBox(text, &MeasureMono, 0.0f, 0.0f, 200.0f, 40.0f, options);
+
+	TextSize size = MeasureMono(layout.text.c_str());
+	float lineHeight = 20.0f * layout.scaleY;
+
+	CHECK(layout.text == "one two three four five\nsix seven eight nine ten");
+	CHECK(size.width * layout.scaleX <= 200.0f && size.height * layout.scaleY <= 40.0f);
+	CHECK(lineHeight >= options.minLineHeight && lineHeight < options.maxLineHeight);
+	// Two lines fit while the longer one, 24 characters, fits the width
+	CHECK(lineHeight > 200.0f / 240.0f * 20.0f - 0.5f);
+
+	// Stretch keeps the old behaviour
+	layout = TextLayoutEngine::FitToBox("abcd", &MeasureMono, 0.0f, 0.0f, 80.0f, 40.0f, StretchOptions);
+	CHECK(layout.scaleX == 2.0f && layout.scaleY == 2.0f && layout.text == "abcd");
+
+	CHECK(!TextLayoutEngine::FitToBox("", &MeasureMono, 0.0f, 0.0f, 80.0f, 40.0f, options).visible);
+}
+
+// Text that does not fit at the smallest line height, 12 pixels, in a box of 100x20
+static void TestSpill()
+{
+	const char* text = "one two three four five six seven eight nine ten";
+	const std::string wrapped = "one two three\nfour five six\nseven eight nine\nten";
+	TextFitOptions options;
+
+	// Drawn at the smallest size, running past the box
+	options.spill = TextSpill::Overflow;
+	TextLayout layout = TextLayoutEngine::FitToBox(text, &MeasureMono, 0.0f, 0.0f, 100.0f, 20.0f, options);
+	CHECK(layout.text == wrapped);
+	CHECK(Near(layout.scaleY, 0.6f) && layout.y == 0.0f);
+
+	// Shrunk until the 160x80 block fits the height
+	options.spill = TextSpill::Shrink;
+	layout = TextLayoutEngine::FitToBox(text, &MeasureMono, 0.0f, 0.0f, 100.0f, 20.0f, options);
+	CHECK(layout.text == wrapped);
+	CHECK(Near(layout.scaleX, 0.25f) && Near(layout.scaleY, 0.25f));
+	CHECK(Near(layout.x, 30.0f) && Near(layout.y, 0.0f));
+
+	// Cut after the lines that fit, the last one shown ends with "..."
+	options.spill = TextSpill::Ellipsis;
+	layout = TextLayoutEngine::FitToBox(text, &MeasureMono, 0.0f, 0.0f, 100.0f, 20.0f, options);
+	CHECK(layout.text == "one two three...");
+	CHECK(Near(layout.scaleY, 0.6f) && Near(layout.y, 4.0f));
+
+	layout = TextLayoutEngine::FitToBox(text, &MeasureMono, 0.0f, 0.0f, 100.0f, 30.0f, options);
+	CHECK(layout.text == "one two three\nfour five six...");
+
+	// Words are dropped until the ellipsis fits the width
+	layout = TextLayoutEngine::FitToBox("aaaaaa bbbbbbbb cc dd", &MeasureMono, 0.0f, 0.0f, 100.0f, 12.0f, options);
+	CHECK(layout.text == "aaaaaa...");
+}
+
+int main()
+{
+	TestStretch();
+	TestLayoutCache();
+	TestBreaking();
+	TestScale();
+	TestSpill();
+
+	return 0;
+}
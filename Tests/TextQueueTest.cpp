@@ -0,0 +1,118 @@
+#include <string>
+
+#include "Check.h"
+#include "RecordingTextBackend.h"
+#include "TextQueue.h"
+
+static TextCommand MakeCommand(TextQueue& queue, const void* font, const char* text, float x)
+{
+	TextCommand command;
+	command.font = font;
+	command.textOffset = queue.AddText(text);
+	command.x = x;
+	return command;
+}
+
+// A frame of many labels is a single batch
+static void TestOneBatchPerFrame()
+{
+	TextQueue queue;
+	RecordingTextBackend backend;
+	int font = 0;
+
+	for (int i = 0; i < 200; i++)
+	{
+		queue.Push(MakeCommand(queue, &font, ("label " + std::to_string(i)).c_str(), float(i)));
+	}
+
+	CHECK(queue.GetCount() == 200);
+
+	queue.Flush(backend);
+
+	CHECK(backend.begins == 1 && backend.ends == 1);
+	CHECK(backend.unbatchedDraws == 0);
+	CHECK(backend.draws.size() == 200);
+	CHECK(backend.draws[0].text == "label 0" && backend.draws[199].text == "label 199");
+	CHECK(queue.GetCount() == 0);
+
+	// An empty frame does not open a batch
+	queue.Flush(backend);
+	CHECK(backend.begins == 1);
+}
+
+// Draws are grouped by font, within a font they keep the order they were queued in
+static void TestSortedByFont()
+{
+	TextQueue queue;
+	RecordingTextBackend backend;
+	int fonts[2] = {};
+
+	queue.Push(MakeCommand(queue, &fonts[1], "a", 0.0f));
+	queue.Push(MakeCommand(queue, &fonts[0], "b", 1.0f));
+	queue.Push(MakeCommand(queue, &fonts[1], "c", 2.0f));
+	queue.Push(MakeCommand(queue, &fonts[0], "d", 3.0f));
+	queue.Push(MakeCommand(queue, &fonts[1], "e", 4.0f));
+	queue.Flush(backend);
+
+	CHECK(backend.begins == 1);
+	CHECK(backend.draws.size() == 5);
+
+	std::string order;
+
+	for (const RecordingTextBackend::Draw& draw : backend.draws)
+	{
+		order += draw.text;
+	}
+
+	CHECK(order == "bdace");
+	CHECK(backend.draws[0].command.font == &fonts[0] && backend.draws[4].command.font == &fonts[1]);
+}
+
+// One copy of the text serves every command that refers to it, like the shadow copies of a label
+static void TestSharedText()
+{
+	TextQueue queue;
+	RecordingTextBackend backend;
+	int font = 0;
+
+	TextCommand command = MakeCommand(queue, &font, "shared", 0.0f);
+
+	for (int i = 0; i < 4; i++)
+	{
+		command.x = float(i);
+		queue.Push(command);
+	}
+
+	queue.Flush(backend);
+
+	CHECK(backend.draws.size() == 4);
+	CHECK(backend.draws[3].text == "shared" && backend.draws[3].command.x == 3.0f);
+	CHECK(backend.quads == 4 * 6);
+}
+
+// Nothing of a frame leaks into the next one
+static void TestFramesAreIndependent()
+{
+	TextQueue queue;
+	RecordingTextBackend first;
+	RecordingTextBackend second;
+	int font = 0;
+
+	queue.Push(MakeCommand(queue, &font, "first", 0.0f));
+	queue.Flush(first);
+	queue.Push(MakeCommand(queue, &font, "second", 0.0f));
+	queue.Flush(second);
+
+	CHECK(first.draws.size() == 1 && second.draws.size() == 1);
+	CHECK(second.draws[0].text == "second");
+}
+
+int main()
+{
+	TestOneBatchPerFrame();
+	TestSortedByFont();
+	TestSharedText();
+	TestFramesAreIndependent();
+
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <cstdio>
+#include <vector>
+
+#include "Bench.h"
+#include "RecordingTextBackend.h"
+#include "TextQueue.h"
+#include "TextShadow.h"
+
+// Counts what a flush submits without keeping it, so the queue is what gets measured
+class CountingTextBackend : public ITextBackend
+{
+public:
+	size_t draws = 0;
+
+	void Begin() override
+	{
+	}
+
+	void DrawString(const TextCommand&, const char*) override
+	{
+		draws++;
+	}
+
+	void End() override
+	{
+	}
+};
+
+// Quads and queue time of a text heavy frame, 200 labels of 17 glyphs, per shadow quality
+int main()
+{
+	const int labels = 200;
+	const char* label = "Equip the iron sword";
+	const float radius = 5.0f;
+	int font = 0;
+
+	const char* names[] = { "off", "low", "medium", "high" };
+
+	std::printf("%-8s %8s %10s %12s\n", "quality", "copies", "quads", "frame us");
+
+	for (ShadowQuality quality : { ShadowQuality::Off, ShadowQuality::Low, ShadowQuality::Medium, ShadowQuality::High })
+	{
+		std::vector<TextShadow::Offset> offsets = TextShadow::ComputeOffsets(radius, quality);
+		TextQueue queue;
+
+		auto queueFrame = [&]()
+		{
+			for (int i = 0; i < labels; i++)
+			{
+				TextCommand command;
+				command.font = &font;
+				command.textOffset = queue.AddText(label);
+
+				for (const TextShadow::Offset& offset : offsets)
+				{
+					command.x = offset.x;
+					command.y = offset.y;
+					queue.Push(command);
+				}
+
+				command.x = 0.0f;
+				command.y = 0.0f;
+				queue.Push(command);
+			}
+		};
+
+		RecordingTextBackend recording;
+		queueFrame();
+		queue.Flush(recording);
+
+		CountingTextBackend counting;
+		double us = MeasureUs([&]()
+		{
+			queueFrame();
+			queue.Flush(counting);
+		});
+
+		std::printf("%-8s %8zu %10zu %12.1f\n", names[int(quality)], offsets.size() + 1, recording.quads, us);
+	}
+
+	// What one shadow copy per degree from 0 to 360 drew before, plus the text
+	std::printf("%-8s %8d %10zu\n", "360 deg", 362, size_t(labels) * 362 * 17);
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <cmath>
+#include <vector>
+
+#include "Check.h"
+#include "RecordingTextBackend.h"
+#include "TextQueue.h"
+#include "TextShadow.h"
+
+// Queues a label the way the overlay does, the shadow copies first and the text on top
+static void QueueLabel(TextQueue& queue, const void* font, const char* text, const std::vector<TextShadow::Offset>& offsets)
+{
+	TextCommand command;
+	command.font = font;
+	command.textOffset = queue.AddText(text);
+	command.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	for (const TextShadow::Offset& offset : offsets)
+	{
+		command.x = offset.x;
+		command.y = offset.y;
+		queue.Push(command);
+	}
+
+	command.x = 0.0f;
+	command.y = 0.0f;
+	command.color = {};
+	queue.Push(command);
+}
+
+static void TestSampleCounts()
+{
+	CHECK(TextShadow::GetSampleCount(5.0f, ShadowQuality::Off) == 0);
+	CHECK(TextShadow::GetSampleCount(5.0f, ShadowQuality::Low) == 4);
+	CHECK(TextShadow::GetSampleCount(5.0f, ShadowQuality::Medium) == 8);
+	// 2 pi 5 / 1.5 = 20.9
+	CHECK(TextShadow::GetSampleCount(5.0f, ShadowQuality::High) == 21);
+	CHECK(TextShadow::GetSampleCount(0.5f, ShadowQuality::High) == 8);
+	CHECK(TextShadow::GetSampleCount(100.0f, ShadowQuality::High) == TextShadow::MaxSamples);
+
+	CHECK(TextShadow::ComputeOffsets(0.0f, ShadowQuality::High).empty());
+}
+
+static void TestOffsets()
+{
+	for (ShadowQuality quality : { ShadowQuality::Low, ShadowQuality::Medium, ShadowQuality::High })
+	{
+		std::vector<TextShadow::Offset> offsets = TextShadow::ComputeOffsets(5.0f, quality);
+
+		CHECK(int(offsets.size()) == TextShadow::GetSampleCount(5.0f, quality));
+
+		for (const TextShadow::Offset& offset : offsets)
+		{
+			CHECK(std::fabs(std::hypot(offset.x, offset.y) - 5.0f) < 1e-4f);
+		}
+	}
+
+	// Low sits on the diagonals
+	std::vector<TextShadow::Offset> low = TextShadow::ComputeOffsets(2.0f, ShadowQuality::Low);
+	CHECK(std::fabs(std::fabs(low[0].x) - std::fabs(low[0].y)) < 1e-4f);
+
+	// Medium on the compass directions
+	std::vector<TextShadow::Offset> medium = TextShadow::ComputeOffsets(2.0f, ShadowQuality::Medium);
+	CHECK(std::fabs(medium[0].x - 2.0f) < 1e-4f && std::fabs(medium[2].x) < 1e-4f);
+}
+
+// Quads a frame of labels emits per quality, counted by the recording backend
+static void TestQuadCounts()
+{
+	const char* label = "Open the door";
+	const size_t glyphs = 11;
+	const int labels = 200;
+	int font = 0;
+
+	for (ShadowQuality quality : { ShadowQuality::Off, ShadowQuality::Low, ShadowQuality::Medium, ShadowQuality::High })
+	{
+		std::vector<TextShadow::Offset> offsets = TextShadow::ComputeOffsets(5.0f, quality);
+		TextQueue queue;
+		RecordingTextBackend backend;
+
+		for (int i = 0; i < labels; i++)
+		{
+			QueueLabel(queue, &font, label, offsets);
+		}
+
+		queue.Flush(backend);
+
+		size_t copies = TextShadow::GetSampleCount(5.0f, quality) + 1;
+
+		CHECK(backend.begins == 1);
+		CHECK(backend.draws.size() == labels * copies);
+		CHECK(backend.quads == labels * copies * glyphs);
+
+		// The text is drawn after its shadow
+		CHECK(backend.draws[copies - 1].command.color.r == 1.0f);
+		CHECK(copies == 1 || backend.draws[0].command.color.r == 0.0f);
+
+		// One copy per degree drew 361 strings per label
+		CHECK(backend.quads < labels * 361 * glyphs / 15);
+	}
+}
+
+int main()
+{
+	TestSampleCounts();
+	TestOffsets();
+	TestQuadCounts();
+
+	return 0;
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "TileCache.h"
+
+using TranslateClient::TranslationEntry;
+
+// Stripes of bright strokes on a dark background, enough horizontal detail to count as a line of text
+static void DrawText(GrayImage* image, int left, int top, int width, int height, std::mt19937* random)
+{
+	for (int y = top; y < top + height; y++)
+	{
+		for (int x = left; x < left + width; x++)
+		{
+			if ((x / 3 + y / 5 + ((*random)() % 3 == 0)) % 2 != 0)
+			{
+				image->Row(y)[x] = 220;
+			}
+		}
+	}
+}
+
+static GrayImage CreateImage()
+{
+	std::mt19937 random(3);
+	GrayImage image;
+
+	image.width = 640;
+	image.height = 200;
+	image.pixels.assign(size_t(image.width) * image.height, 40);
+
+	DrawText(&image, 10, 20, 200, 14, &random);
+	DrawText(&image, 400, 22, 100, 14, &random);
+	DrawText(&image, 30, 100, 300, 20, &random);
+
+	return image;
+}
+
+static bool Contains(const ImageRect& outer, int x, int y, int width, int height)
+{
+	return outer.x <= x && outer.y <= y && outer.Right() >= x + width && outer.Bottom() >= y + height;
+}
+
+// Two labels on one line are separate tiles, every tile covers its text with a small margin
+static void TestTiles()
+{
+	GrayImage image = CreateImage();
+	std::vector<ImageRect> tiles = TileHashing::FindTextTiles(image, Preprocess::Isa::Scalar);
+
+	CHECK(tiles.size() == 3);
+	CHECK(Contains(tiles[0], 10, 20, 200, 14) && tiles[0].width < 220);
+	CHECK(Contains(tiles[1], 400, 22, 100, 14) && tiles[1].width < 120);
+	CHECK(Contains(tiles[2], 30, 100, 300, 20) && tiles[2].height < 30);
+
+	GrayImage empty;
+	empty.width = 640;
+	empty.height = 200;
+	empty.pixels.assign(size_t(empty.width) * empty.height, 40);
+	CHECK(TileHashing::FindTextTiles(empty, Preprocess::Isa::Scalar).empty());
+
+#ifdef PREPROCESS_X86
+	std::vector<ImageRect> simd = TileHashing::FindTextTiles(image, Preprocess::Isa::Sse2);
+
+	CHECK(simd.size() == tiles.size());
+
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		CHECK(simd[i].x == tiles[i].x && simd[i].y == tiles[i].y);
+		CHECK(simd[i].width == tiles[i].width && simd[i].height == tiles[i].height);
+		CHECK(TileHashing::ComputeKey(image, tiles[i], Preprocess::Isa::Sse2) == TileHashing::ComputeKey(image, tiles[i], Preprocess::Isa::Scalar));
+	}
+#endif
+}
+
+// Keys ignore a change of brightness but not a changed character
+static void TestKeys()
+{
+	GrayImage image = CreateImage();
+	std::vector<ImageRect> tiles = TileHashing::FindTextTiles(image);
+
+	GrayImage brighter = image;
+
+	for (uint8_t& pixel : brighter.pixels)
+	{
+		pixel = uint8_t(pixel + 10);
+	}
+
+	for (const ImageRect& tile : tiles)
+	{
+		CHECK(TileHashing::ComputeKey(brighter, tile) == TileHashing::ComputeKey(image, tile));
+	}
+
+	GrayImage changed = image;
+
+	for (int y = tiles[0].y; y < tiles[0].Bottom(); y++)
+	{
+		for (int x = tiles[0].x + 40; x < tiles[0].x + 52; x++)
+		{
+			changed.Row(y)[x] = 40;
+		}
+	}
+
+	CHECK(!(TileHashing::ComputeKey(changed, tiles[0]) == TileHashing::ComputeKey(image, tiles[0])));
+	CHECK(TileHashing::ComputeKey(changed, tiles[1]) == TileHashing::ComputeKey(image, tiles[1]));
+}
+
+// Entries are kept relative to their tile and come back at the position of the tile they are found for
+static void TestCache()
+{
+	GrayImage image = CreateImage();
+	std::vector<ImageRect> rects = TileHashing::FindTextTiles(image);
+	std::vector<Tile> tiles;
+
+	for (const ImageRect& rect : rects)
+	{
+		tiles.push_back(Tile{ rect, TileHashing::ComputeKey(image, rect), TileHashing::ComputePixelHash(image, rect) });
+	}
+
+	TileCache cache(2);
+	std::vector<TranslationEntry> entries;
+
+	CHECK(!cache.Find(tiles[0], &entries));
+
+	TranslationEntry entry{ tiles[0].rect.x + 5, tiles[0].rect.y + 2, 50.0f, 10.0f, "translation", "message" };
+	cache.Insert(tiles[0], { entry });
+
+	CHECK(cache.Find(tiles[0], &entries));
+	CHECK(entries.size() == 1 && entries[0].x == entry.x && entries[0].y == entry.y && entries[0].translation == "translation");
+
+	// The same line moved elsewhere on screen
+	Tile moved = tiles[0];
+	moved.rect.x += 100;
+	moved.rect.y += 30;
+	entries.clear();
+	CHECK(cache.Find(moved, &entries));
+	CHECK(entries.size() == 1 && entries[0].x == entry.x + 100 && entries[0].y == entry.y + 30);
+
+	// A tile without text is cached as well
+	cache.Insert(tiles[1], {});
+	entries.clear();
+	CHECK(cache.Find(tiles[1], &entries) && entries.empty());
+
+	// Tile 0 was used more recently than tile 1, so tile 1 makes room for tile 2
+	CHECK(cache.Find(tiles[0], &entries));
+	cache.Insert(tiles[2], {});
+	CHECK(!cache.Find(tiles[1], &entries));
+	CHECK(cache.Find(tiles[0], &entries) && cache.Find(tiles[2], &entries));
+
+	TileCache::Stats stats = cache.GetStats();
+	CHECK(stats.misses == 2 && stats.hits == 6);
+	CHECK(stats.missPixels == uint64_t(tiles[0].rect.Area() + tiles[1].rect.Area()));
+}
+
+// Two lines of the same size whose strokes differ only inside the cells share a key, the pixel hash keeps
+// the cache from answering one with the entries of the other
+static void TestCollision()
+{
+	GrayImage image = CreateImage();
+	ImageRect rect = TileHashing::FindTextTiles(image)[0];
+
+	// Every group of four pixels mirrored, the mean of every cell stays the same
+	GrayImage other = image;
+
+	for (int y = rect.y; y < rect.Bottom(); y++)
+	{
+		uint8_t* row = other.Row(y) + rect.x;
+
+		for (int x = 0; x + 4 <= rect.width; x += 4)
+		{
+			std::reverse(row + x, row + x + 4);
+		}
+	}
+
+	Tile first{ rect, TileHashing::ComputeKey(image, rect), TileHashing::ComputePixelHash(image, rect) };
+	Tile second{ rect, TileHashing::ComputeKey(other, rect), TileHashing::ComputePixelHash(other, rect) };
+
+	CHECK(first.key == second.key);
+	CHECK(first.pixelHash != second.pixelHash);
+
+	TileCache cache(4);
+	std::vector<TranslationEntry> entries;
+
+	cache.Insert(first, { TranslationEntry{ rect.x, rect.y, 50.0f, 10.0f, "first", "first" } });
+	CHECK(!cache.Find(second, &entries) && entries.empty());
+	CHECK(cache.GetStats().collisions == 1 && cache.GetStats().misses == 1);
+
+	// The entry of the line sent last replaces the other one
+	cache.Insert(second, { TranslationEntry{ rect.x, rect.y, 50.0f, 10.0f, "second", "second" } });
+	CHECK(cache.Find(second, &entries) && entries.size() == 1 && entries[0].translation == "second");
+	CHECK(!cache.Find(first, &entries));
+
+	// A brighter frame of the same line still hits
+	GrayImage brighter = other;
+
+	for (uint8_t& pixel : brighter.pixels)
+	{
+		pixel = uint8_t(pixel + 10);
+	}
+
+	CHECK(TileHashing::ComputePixelHash(brighter, rect) == second.pixelHash);
+}
+
+int main()
+{
+	TestTiles();
+	TestKeys();
+	TestCache();
+	TestCollision();
+
+	return 0;
+}
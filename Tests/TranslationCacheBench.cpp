@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Bench.h"
+#include "TranslationCache.h"
+
+// The obvious LRU built from the standard containers, for comparison
+class StdLruCache
+{
+public:
+	explicit StdLruCache(size_t maxCount) : maxCount(maxCount)
+	{
+	}
+
+	const std::string* Find(const std::string& text)
+	{
+		auto found = index.find(text);
+
+		if (found == index.end())
+		{
+			return nullptr;
+		}
+
+		order.splice(order.begin(), order, found->second);
+		return &found->second->second;
+	}
+
+	void Insert(const std::string& text, const std::string& translation)
+	{
+		order.emplace_front(text, translation);
+		index[text] = order.begin();
+
+		if (order.size() > maxCount)
+		{
+			index.erase(order.back().first);
+			order.pop_back();
+		}
+	}
+
+private:
+	size_t maxCount;
+	std::list<std::pair<std::string, std::string>> order;
+	std::unordered_map<std::string, std::list<std::pair<std::string, std::string>>::iterator> index;
+};
+
+// Screens of game text: a working set of strings that keep coming back, and some that are seen once
+int main()
+{
+	const int distinct = 20000;
+	std::vector<std::string> texts;
+	std::vector<std::string> translations;
+
+	for (int i = 0; i < distinct; i++)
+	{
+		texts.push_back("  Item name number " + std::to_string(i) + " of the  inventory ");
+		translations.push_back("Translated item " + std::to_string(i));
+	}
+
+	// Zipf-like: most lookups hit a few hundred menu strings
+	std::mt19937 random(3);
+	std::vector<int> lookups;
+
+	for (int i = 0; i < 200000; i++)
+	{
+		double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+		lookups.push_back(int(distinct * u * u * u));
+	}
+
+	std::vector<std::string> keys;
+
+	for (const std::string& text : texts)
+	{
+		keys.push_back(TranslationCache::Normalize(text));
+	}
+
+	double normalizeUs = MeasureUs([&]() { Consume(TranslationCache::Normalize(texts[7]).size()); });
+
+	TranslationCache cache(1024 * 1024);
+
+	double cacheUs = MeasureUs([&]()
+	{
+		for (int text : lookups)
+		{
+			if (cache.Find(keys[text]) == nullptr)
+			{
+				cache.Insert(keys[text], translations[text]);
+			}
+		}
+	});
+
+	// About as many entries as the byte budget holds
+	StdLruCache reference(cache.GetCount());
+
+	double referenceUs = MeasureUs([&]()
+	{
+		for (int text : lookups)
+		{
+			if (reference.Find(keys[text]) == nullptr)
+			{
+				reference.Insert(keys[text], translations[text]);
+			}
+		}
+	});
+
+	const TranslationCache::Stats& stats = cache.GetStats();
+	double hitRate = cache.GetHitRate();
+	uint64_t evictions = stats.evictions;
+
+	// Only hits, a menu that stays on screen
+	TranslationCache menu(1024 * 1024);
+
+	for (int text = 0; text < 1000; text++)
+	{
+		menu.Insert(keys[text], translations[text]);
+	}
+
+	double hitUs = MeasureUs([&]()
+	{
+		for (int text = 0; text < 1000; text++)
+		{
+			Consume(menu.Find(keys[text])->size());
+		}
+	});
+
+	std::printf("normalize %6.1f ns\n", normalizeUs * 1000.0);
+	std::printf("find or insert  TranslationCache %6.1f ns  list + unordered_map %6.1f ns\n",
+		cacheUs * 1000.0 / lookups.size(), referenceUs * 1000.0 / lookups.size());
+	std::printf("%zu entries in %zu bytes, hit rate %.1f%%, %llu evictions\n",
+		cache.GetCount(), cache.GetBytes(), hitRate * 100.0, (unsigned long long)evictions);
+	std::printf("hit %6.1f ns\n", hitUs);
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "Check.h"
+#include "TranslationCache.h"
+
+static void TestNormalize()
+{
+	CHECK(TranslationCache::Normalize("  Start \t\n game  ") == "Start game");
+	CHECK(TranslationCache::Normalize("\r\n") == "");
+
+	TranslationCache cache(1 << 20);
+	cache.Insert(" New\tgame ", "Nueva partida");
+
+	CHECK(cache.Find("New game") != nullptr && *cache.Find("New game") == "Nueva partida");
+	CHECK(cache.Find("New  game\n") != nullptr);
+	CHECK(cache.Find("Newgame") == nullptr);
+}
+
+// The least recently used entry goes first, a hit counts as a use
+static void TestEviction()
+{
+	TranslationCache probe(1 << 20);
+	probe.Insert("key 0", "value");
+	size_t entryBytes = probe.GetBytes();
+
+	TranslationCache cache(3 * entryBytes);
+	cache.Insert("key 0", "value");
+	cache.Insert("key 1", "value");
+	cache.Insert("key 2", "value");
+	CHECK(cache.GetCount() == 3);
+
+	CHECK(cache.Find("key 0") != nullptr);
+	cache.Insert("key 3", "value");
+
+	CHECK(cache.GetCount() == 3 && cache.GetBytes() == 3 * entryBytes);
+	CHECK(cache.Peek("key 1") == nullptr);
+	CHECK(cache.Peek("key 0") != nullptr && cache.Peek("key 2") != nullptr && cache.Peek("key 3") != nullptr);
+	CHECK(cache.GetStats().evictions == 1);
+
+	// Peek neither counts nor refreshes, so key 2 is the next to go
+	cache.Peek("key 2");
+	cache.Insert("key 4", "value");
+	CHECK(cache.Peek("key 2") == nullptr && cache.Peek("key 0") != nullptr);
+
+	// Replacing a translation keeps a single entry and accounts for its new size
+	cache.Insert("key 0", "longer value");
+	CHECK(cache.GetCount() <= 3 && cache.GetBytes() <= 3 * entryBytes);
+	CHECK(*cache.Peek("key 0") == "longer value");
+
+	// An entry larger than the whole cache is not stored
+	cache.Insert("key 5", std::string(4 * entryBytes, 'x'));
+	CHECK(cache.Peek("key 5") == nullptr && cache.Peek("key 0") != nullptr);
+}
+
+// Against a map of every insertion: found values are current and the budget always holds
+static void TestBudget()
+{
+	const size_t maxBytes = 20000;
+	std::mt19937 random(1);
+	TranslationCache cache(maxBytes);
+	std::unordered_map<std::string, std::string> reference;
+
+	for (int i = 0; i < 200000; i++)
+	{
+		std::string key = "key " + std::to_string(random() % 2000);
+
+		if (random() % 3 == 0)
+		{
+			std::string translation = "translation " + std::to_string(i);
+			cache.Insert(" " + key + "  ", translation);
+			reference[key] = translation;
+		}
+		else
+		{
+			const std::string* translation = cache.Find(key);
+			CHECK(translation == nullptr || *translation == reference[key]);
+		}
+
+		CHECK(cache.GetBytes() <= maxBytes);
+	}
+
+	size_t found = 0;
+
+	for (int i = 0; i < 2000; i++)
+	{
+		found += cache.Peek("key " + std::to_string(i)) != nullptr;
+	}
+
+	const TranslationCache::Stats& stats = cache.GetStats();
+
+	CHECK(found == cache.GetCount());
+	CHECK(stats.insertions - stats.evictions == cache.GetCount());
+	CHECK(cache.GetHitRate() == double(stats.hits) / double(stats.hits + stats.misses));
+
+	cache.Clear();
+	CHECK(cache.GetCount() == 0 && cache.GetBytes() == 0 && cache.Peek("key 1") == nullptr);
+	cache.Insert("key 1", "value");
+	CHECK(cache.Peek("key 1") != nullptr);
+}
+
+int main()
+{
+	TestNormalize();
+	TestEviction();
+	TestBudget();
+
+	return 0;
+}
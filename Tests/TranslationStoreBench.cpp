@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "Bench.h"
+#include "TranslationStore.h"
+
+static const std::filesystem::path StorePath = std::filesystem::temp_directory_path() / "TranslationStoreBench.bin";
+
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Opening a store of 1M translations, as it was left by compaction and with appended records still to read
+int main()
+{
+	const int count = 1000000;
+	const int appended = 2000;
+
+	std::filesystem::remove(StorePath);
+
+	{
+		TranslationStore store;
+
+		if (!store.Open(StorePath))
+		{
+			std::printf("Cannot create %s\n", StorePath.string().c_str());
+			return 1;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < count; i++)
+		{
+			store.Append("Source text of line " + std::to_string(i), "Translation of line " + std::to_string(i));
+		}
+
+		double appendMs = ElapsedMs(start);
+		start = std::chrono::steady_clock::now();
+		store.Compact();
+
+		std::printf("append %.2f us per record, compact %.0f ms, %.0f MB\n",
+			appendMs * 1000.0 / count, ElapsedMs(start), std::filesystem::file_size(StorePath) / (1024.0 * 1024.0));
+	}
+
+	double openUs = MeasureUs([]()
+	{
+		TranslationStore store;
+		Consume(store.Open(StorePath));
+	});
+
+	{
+		TranslationStore store;
+		store.Open(StorePath);
+
+		for (int i = 0; i < appended; i++)
+		{
+			store.Append("Appended line " + std::to_string(i), "Appended translation " + std::to_string(i));
+		}
+	}
+
+	double openAppendedUs = MeasureUs([]()
+	{
+		TranslationStore store;
+		Consume(store.Open(StorePath));
+	});
+
+	TranslationStore store;
+	store.Open(StorePath);
+
+	std::string translation;
+	int next = 0;
+
+	double hitUs = MeasureUs([&]()
+	{
+		next = (next + 7919) % count;
+		Consume(store.Find("Source text of line " + std::to_string(next), &translation));
+	});
+
+	double missUs = MeasureUs([&]()
+	{
+		next = (next + 7919) % count;
+		Consume(store.Find("Unknown line " + std::to_string(next), &translation));
+	});
+
+	std::printf("open %d records %.3f ms, with %d appended %.3f ms\n", count, openUs / 1000.0, appended, openAppendedUs / 1000.0);
+	std::printf("find hit %.2f us, miss %.2f us\n", hitUs, missUs);
+
+	store.Close();
+	std::filesystem::remove(StorePath);
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "TranslationStore.h"
+
+static const std::filesystem::path StorePath = std::filesystem::temp_directory_path() / "TranslationStoreTest.bin";
+
+static std::string Key(int i)
+{
+	return "k" + std::to_string(i);
+}
+
+static std::string Value(int i)
+{
+	return "v" + std::to_string(i);
+}
+
+static bool FindsValue(const TranslationStore& store, const std::string& key, const std::string& expected)
+{
+	std::string translation;
+	return store.Find(key, &translation) && translation == expected;
+}
+
+static void WriteCompactedStore(int count)
+{
+	std::filesystem::remove(StorePath);
+
+	TranslationStore store;
+	CHECK(store.Open(StorePath));
+
+	for (int i = 0; i < count; i++)
+	{
+		CHECK(store.Append(Key(i), Value(i)));
+	}
+
+	CHECK(store.NeedsCompaction());
+	CHECK(store.Compact());
+	CHECK(store.GetAppendedCount() == 0 && store.GetCount() == size_t(count));
+}
+
+// Records appended after the last compaction are found after reopening, a torn last append is cut off
+static void TestTornAppend()
+{
+	WriteCompactedStore(3000);
+
+	{
+		TranslationStore store;
+		CHECK(store.Open(StorePath));
+		CHECK(FindsValue(store, Key(42), Value(42)));
+		CHECK(store.Append(Key(5), "new5"));
+		CHECK(store.Append("extra", "x"));
+		CHECK(FindsValue(store, Key(5), "new5"));
+	}
+
+	{
+		std::ofstream file(StorePath, std::ios::binary | std::ios::app);
+		file.write("\x05\0\0\0\x09\0\0\0garbage", 15);
+	}
+
+	uintmax_t tornSize = std::filesystem::file_size(StorePath);
+
+	{
+		TranslationStore store;
+		std::string translation;
+
+		CHECK(store.Open(StorePath));
+		CHECK(std::filesystem::file_size(StorePath) == tornSize - 15);
+		CHECK(FindsValue(store, Key(5), "new5"));
+		CHECK(FindsValue(store, Key(2999), Value(2999)));
+		CHECK(FindsValue(store, "extra", "x"));
+		CHECK(!store.Find("missing", &translation));
+		CHECK(store.Append("after", "crash"));
+	}
+
+	{
+		TranslationStore store;
+		CHECK(store.Open(StorePath));
+		CHECK(FindsValue(store, "after", "crash"));
+
+		CHECK(store.Compact());
+		CHECK(FindsValue(store, "after", "crash"));
+		CHECK(FindsValue(store, Key(5), "new5"));
+		CHECK(FindsValue(store, Key(6), Value(6)));
+	}
+}
+
+// Whatever the damage to the file, a lookup either misses or returns the value that was stored
+static void TestCorruption()
+{
+	WriteCompactedStore(3000);
+
+	std::vector<char> original(size_t(std::filesystem::file_size(StorePath)));
+	{
+		std::ifstream file(StorePath, std::ios::binary);
+		file.read(original.data(), std::streamsize(original.size()));
+	}
+
+	std::mt19937 random(1);
+	const size_t headerSize = 32;
+
+	for (int trial = 0; trial < 1000; trial++)
+	{
+		std::vector<char> damaged = original;
+		int changes = 1 + int(random() % 8);
+
+		for (int i = 0; i < changes; i++)
+		{
+			damaged[headerSize + random() % (damaged.size() - headerSize)] = char(random());
+		}
+
+		if (trial % 5 == 0)
+		{
+			damaged.resize(headerSize + random() % (damaged.size() - headerSize));
+		}
+
+		{
+			std::ofstream file(StorePath, std::ios::binary | std::ios::trunc);
+			file.write(damaged.data(), std::streamsize(damaged.size()));
+		}
+
+		TranslationStore store;
+
+		if (!store.Open(StorePath))
+		{
+			continue;
+		}
+
+		for (int i = 0; i < 3000; i += 37)
+		{
+			std::string translation;
+			CHECK(!store.Find(Key(i), &translation) || translation == Value(i));
+		}
+
+		store.Append("new", "x");
+		store.Compact();
+		CHECK(FindsValue(store, "new", "x"));
+	}
+}
+
+// An index without an empty slot, every slot pointing to a record of another key. The lookup of a missing key
+// has nothing to stop at and must give up after one round instead of probing forever.
+static void TestFullIndex()
+{
+	WriteCompactedStore(3000);
+
+	std::vector<char> data(size_t(std::filesystem::file_size(StorePath)));
+	{
+		std::ifstream file(StorePath, std::ios::binary);
+		file.read(data.data(), std::streamsize(data.size()));
+	}
+
+	const size_t headerSize = 32;
+	uint32_t slots = 0;
+	memcpy(&slots, data.data() + 12, sizeof(slots));
+
+	uint64_t record = 0;
+
+	for (uint32_t slot = 0; slot < slots && record == 0; slot++)
+	{
+		memcpy(&record, data.data() + headerSize + slot * 8, sizeof(record));
+	}
+
+	CHECK(record != 0);
+
+	for (uint32_t slot = 0; slot < slots; slot++)
+	{
+		memcpy(data.data() + headerSize + slot * 8, &record, sizeof(record));
+	}
+
+	{
+		std::ofstream file(StorePath, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), std::streamsize(data.size()));
+	}
+
+	TranslationStore store;
+	CHECK(store.Open(StorePath));
+
+	std::string translation;
+	CHECK(!store.Find("missing", &translation));
+
+	// The key of the record every slot points to is still found
+	int found = 0;
+
+	for (int i = 0; i < 3000; i++)
+	{
+		found += store.Find(Key(i), &translation) ? 1 : 0;
+	}
+
+	CHECK(found == 1);
+}
+
+int main()
+{
+	TestTornAppend();
+	TestCorruption();
+	TestFullIndex();
+
+	std::filesystem::remove(StorePath);
+
+	return 0;
+}